@@ -0,0 +1,25 @@
+#include "ColourPacking.h"
+
+
+void packColours(const float* r, const float* g, const float* b, const float* a, int count, DWORD* colours)
+{
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i colour = packColours(_mm_loadu_ps(r + i), _mm_loadu_ps(g + i), _mm_loadu_ps(b + i), _mm_loadu_ps(a + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(colours + i), colour);
+	}
+
+	for (; i < count; ++i)
+	{
+		colours[i] = packColour(r[i], g[i], b[i], a[i]);
+	}
+}
+
+void packColoursScalar(const float* r, const float* g, const float* b, const float* a, int count, DWORD* colours)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		colours[i] = packColour(r[i], g[i], b[i], a[i]);
+	}
+}
@@ -0,0 +1,49 @@
+/*
+Conversion of float colours (one array per channel, as in the ParticleStore) to the packed 32 bit colours of the
+vertices (A8R8G8B8, a D3DCOLOR, so blue, green, red and alpha in memory). The result is exactly the one of the DWORD
+conversion of D3DXCOLOR: every channel is clamped to [0, 1], scaled by 255 and rounded (by adding 0.5 and truncating).
+The vectorised conversion does the same operations on 4 colours at once with SSE2.
+*/
+
+#ifndef COLOUR_PACKING_H
+#define COLOUR_PACKING_H
+
+#include "Direct3DTypes.h"
+#include <emmintrin.h>	// SSE2
+
+// a single channel, as D3DXCOLOR converts it (NaN gives 0)
+inline DWORD packChannel(float c)
+{
+	return c >= 1.0f ? 0xff : c > 0.0f ? static_cast<DWORD>(c * 255.0f + 0.5f) : 0x00;
+}
+
+inline DWORD packColour(float r, float g, float b, float a)
+{
+	return (packChannel(a) << 24) | (packChannel(r) << 16) | (packChannel(g) << 8) | packChannel(b);
+}
+
+// 4 channels at once, as 32 bit integers from 0 to 255
+inline __m128i packChannels(__m128 c)
+{
+	// 1 * 255 + 0.5 is truncated to 255, so clamping to 1 before scaling gives 0xff for all values from 1 on (and NaNs
+	// become 1 as well, the minimum returns its second operand then), the mask of the positive values does the rest
+	__m128 scaled = _mm_add_ps(_mm_mul_ps(_mm_min_ps(c, _mm_set1_ps(1.0f)), _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f));
+	return _mm_and_si128(_mm_cvttps_epi32(scaled), _mm_castps_si128(_mm_cmpgt_ps(c, _mm_setzero_ps())));
+}
+
+// 4 colours at once
+inline __m128i packColours(__m128 r, __m128 g, __m128 b, __m128 a)
+{
+	__m128i colour = _mm_slli_epi32(packChannels(a), 24);
+	colour = _mm_or_si128(colour, _mm_slli_epi32(packChannels(r), 16));
+	colour = _mm_or_si128(colour, _mm_slli_epi32(packChannels(g), 8));
+	return _mm_or_si128(colour, packChannels(b));
+}
+
+// converts 'count' colours given by their channels into 'colours' (the arrays need no particular alignment)
+void packColours(const float* r, const float* g, const float* b, const float* a, int count, DWORD* colours);
+
+// the same without any vectorisation, used as the reference
+void packColoursScalar(const float* r, const float* g, const float* b, const float* a, int count, DWORD* colours);
+
+#endif
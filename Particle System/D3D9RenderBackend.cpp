@@ -0,0 +1,124 @@
+#include "D3D9RenderBackend.h"
+#include "Helpers.h"
+
+
+D3D9RenderBackend::D3D9RenderBackend(LPDIRECT3DDEVICE9 device) : device_(device), buffer_(NULL)
+{
+}
+
+D3D9RenderBackend::~D3D9RenderBackend(void)
+{
+	releaseVertexStream();
+}
+
+RenderTexture D3D9RenderBackend::loadTexture(const char* file)
+{
+	LPDIRECT3DTEXTURE9 texture = NULL;
+	if (FAILED(D3DXCreateTextureFromFile(device_, file, &texture))) return NULL;
+	return texture;
+}
+
+void D3D9RenderBackend::releaseTexture(RenderTexture texture)
+{
+	if (texture) static_cast<LPDIRECT3DTEXTURE9>(texture) -> Release();
+}
+
+HRESULT D3D9RenderBackend::createVertexStream(int capacity)
+{
+	releaseVertexStream();
+
+	if (FAILED(device_ -> CreateVertexBuffer(capacity * sizeof(POINTVERTEX), D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY | D3DUSAGE_POINTS,
+											 D3DFVF_POINTVERTEX, D3DPOOL_DEFAULT, &buffer_, NULL)))
+	{
+		return E_FAIL; // Return if the vertex buffer culd not be created.
+	}
+
+	return S_OK;
+}
+
+void D3D9RenderBackend::releaseVertexStream(void)
+{
+	SAFE_RELEASE(buffer_);
+}
+
+POINTVERTEX* D3D9RenderBackend::lockVertices(int first, int count, bool discard)
+{
+	if (buffer_ == NULL) return NULL;
+
+	// a discarded buffer is locked as a whole (the driver hands out fresh memory for all of it)
+	UINT start = discard ? 0 : first;
+	UINT size = discard ? 0 : count;
+
+	void* memory;
+	if (FAILED(buffer_ -> Lock(start * sizeof(POINTVERTEX), size * sizeof(POINTVERTEX), &memory, discard ? D3DLOCK_DISCARD : D3DLOCK_NOOVERWRITE))) return NULL;
+	return static_cast<POINTVERTEX*>(memory) + (first - start);
+}
+
+void D3D9RenderBackend::unlockVertices(int written)
+{
+	buffer_ -> Unlock();
+}
+
+void D3D9RenderBackend::bindPoints(PointShading shading, RenderTexture texture, float size)
+{
+	// Enable point sprites, and set the size of the point.
+	device_ -> SetRenderState(D3DRS_POINTSPRITEENABLE, true);
+	device_ -> SetRenderState(D3DRS_POINTSCALEENABLE,  true);
+
+	// Disable z buffer while rendering the particles. Makes rendering quicker and
+	// stops any visual (alpha) 'artefacts' on screen while rendering.
+	device_ -> SetRenderState(D3DRS_ZENABLE, false);
+
+	// Scale the points according to distance...
+	if (size > 0) device_ -> SetRenderState(D3DRS_POINTSIZE, FtoDW(size));
+	device_ -> SetRenderState(D3DRS_POINTSIZE_MIN, FtoDW(0.00f));
+	device_ -> SetRenderState(D3DRS_POINTSCALE_A,  FtoDW(0.00f));
+	device_ -> SetRenderState(D3DRS_POINTSCALE_B,  FtoDW(0.00f));
+	device_ -> SetRenderState(D3DRS_POINTSCALE_C,  FtoDW(1.00f));
+
+	// Now select the texture for the points...
+	device_ -> SetTexture(0, static_cast<LPDIRECT3DTEXTURE9>(texture));
+	device_ -> SetRenderState(D3DRS_ALPHABLENDENABLE, true);
+	device_ -> SetRenderState(D3DRS_SRCBLEND,  D3DBLEND_SRCALPHA);
+	device_ -> SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+
+	switch (shading)
+	{
+	case TexturedPoints:
+		// Use texture colour and alpha components.
+		device_ -> SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+		device_ -> SetTextureStageState(0, D3DTSS_COLOROP,	D3DTOP_SELECTARG1);
+
+		device_ -> SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+		device_ -> SetTextureStageState(0, D3DTSS_ALPHAOP,   D3DTOP_SELECTARG1);
+		break;
+	case ColouredPoints:
+		// use the colour of the vertices
+		device_ -> SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+		device_ -> SetTextureStageState(0, D3DTSS_COLOROP,	D3DTOP_SELECTARG1);
+
+		// combine the alpha values of the texture and the vertices
+		device_ -> SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+		device_ -> SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+		device_ -> SetTextureStageState(0, D3DTSS_ALPHAOP,   D3DTOP_MODULATE);
+		break;
+	}
+}
+
+void D3D9RenderBackend::unbindPoints(void)
+{
+	// Reset the render states.
+	device_ -> SetRenderState(D3DRS_POINTSPRITEENABLE, false);
+	device_ -> SetRenderState(D3DRS_POINTSCALEENABLE,  false);
+	device_ -> SetRenderState(D3DRS_ALPHABLENDENABLE,  false);
+	device_ -> SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+	device_ -> SetRenderState(D3DRS_ZENABLE, D3DZB_TRUE);
+}
+
+void D3D9RenderBackend::drawPoints(int first, int count)
+{
+	// Render the contents of the vertex buffer.
+	device_ -> SetStreamSource(0, buffer_, 0, sizeof(POINTVERTEX));
+	device_ -> SetFVF(D3DFVF_POINTVERTEX);
+	device_ -> DrawPrimitive(D3DPT_POINTLIST, first, count);
+}
@@ -0,0 +1,37 @@
+/*
+Draws the particle systems with Direct 3D 9: the vertex stream is a dynamic vertex buffer, the points are drawn as
+point sprites with alpha blending and without the Z buffer.
+*/
+
+#ifndef D3D9_RENDER_BACKEND_H
+#define D3D9_RENDER_BACKEND_H
+
+#include "RenderBackend.h"
+
+class D3D9RenderBackend : public RenderBackend
+{
+public:
+	D3D9RenderBackend(LPDIRECT3DDEVICE9 device);		// the device is not owned by the backend
+	virtual ~D3D9RenderBackend(void);
+
+	virtual RenderTexture loadTexture(const char* file);
+	virtual void releaseTexture(RenderTexture texture);
+
+	virtual HRESULT createVertexStream(int capacity);
+	virtual void releaseVertexStream(void);
+	virtual POINTVERTEX* lockVertices(int first, int count, bool discard);
+	virtual void unlockVertices(int written);
+
+	virtual void bindPoints(PointShading shading, RenderTexture texture, float size);
+	virtual void unbindPoints(void);
+	virtual void drawPoints(int first, int count);
+
+private:
+	LPDIRECT3DDEVICE9 device_;
+	LPDIRECT3DVERTEXBUFFER9 buffer_;
+
+	D3D9RenderBackend(const D3D9RenderBackend&);
+	D3D9RenderBackend& operator=(const D3D9RenderBackend&);
+};
+
+#endif
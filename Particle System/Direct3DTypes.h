@@ -0,0 +1,140 @@
+/*
+The Direct 3D and Windows types the simulation, the show files and the CPU render backends use: vectors, colours,
+DWORD and HRESULT. On Windows they come from the D3DX library. Elsewhere (the headless driver on the Linux build
+agents) the same types are defined here with the same layout and arithmetic, so the simulation builds without the
+DirectX SDK. Only the D3D9 render backend and the application need the Direct 3D device itself.
+*/
+
+#ifndef DIRECT3D_TYPES_H
+#define DIRECT3D_TYPES_H
+
+#ifdef _WIN32
+
+#include <d3dx9.h>		// Direct 3D library (for all Direct 3D funtions).
+
+#else
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+typedef unsigned int DWORD;
+typedef long HRESULT;
+
+#define S_OK			((HRESULT)0L)
+#define E_FAIL			((HRESULT)0x80004005L)
+#define E_INVALIDARG	((HRESULT)0x80070057L)
+#define SUCCEEDED(hr)	(((HRESULT)(hr)) >= 0)
+#define FAILED(hr)		(((HRESULT)(hr)) < 0)
+
+#define ZeroMemory(destination, length)			memset((destination), 0, (length))
+#define SecureZeroMemory(destination, length)	memset((destination), 0, (length))
+
+#define D3DX_PI					(3.14159265358979323846f)
+#define D3DXToRadian(degree)	((degree) * (D3DX_PI / 180.0f))
+
+// the vertex format flags of the point vertices
+#define D3DFVF_XYZ		0x002
+#define D3DFVF_PSIZE	0x020
+#define D3DFVF_DIFFUSE	0x040
+
+struct D3DXVECTOR3
+{
+	float x, y, z;
+
+	D3DXVECTOR3(void) {}
+	D3DXVECTOR3(const float* f) : x(f[0]), y(f[1]), z(f[2]) {}
+	D3DXVECTOR3(float fx, float fy, float fz) : x(fx), y(fy), z(fz) {}
+
+	operator float*(void) {return &x;}
+	operator const float*(void) const {return &x;}
+
+	D3DXVECTOR3& operator+=(const D3DXVECTOR3& v) {x += v.x; y += v.y; z += v.z; return *this;}
+	D3DXVECTOR3& operator-=(const D3DXVECTOR3& v) {x -= v.x; y -= v.y; z -= v.z; return *this;}
+	D3DXVECTOR3& operator*=(float f) {x *= f; y *= f; z *= f; return *this;}
+	D3DXVECTOR3& operator/=(float f) {float i = 1.0f / f; x *= i; y *= i; z *= i; return *this;}
+
+	D3DXVECTOR3 operator+(void) const {return *this;}
+	D3DXVECTOR3 operator-(void) const {return D3DXVECTOR3(-x, -y, -z);}
+
+	D3DXVECTOR3 operator+(const D3DXVECTOR3& v) const {return D3DXVECTOR3(x + v.x, y + v.y, z + v.z);}
+	D3DXVECTOR3 operator-(const D3DXVECTOR3& v) const {return D3DXVECTOR3(x - v.x, y - v.y, z - v.z);}
+	D3DXVECTOR3 operator*(float f) const {return D3DXVECTOR3(x * f, y * f, z * f);}
+	D3DXVECTOR3 operator/(float f) const {float i = 1.0f / f; return D3DXVECTOR3(x * i, y * i, z * i);}
+
+	friend D3DXVECTOR3 operator*(float f, const D3DXVECTOR3& v) {return D3DXVECTOR3(f * v.x, f * v.y, f * v.z);}
+
+	bool operator==(const D3DXVECTOR3& v) const {return x == v.x && y == v.y && z == v.z;}
+	bool operator!=(const D3DXVECTOR3& v) const {return x != v.x || y != v.y || z != v.z;}
+};
+
+struct D3DXCOLOR
+{
+	float r, g, b, a;
+
+	D3DXCOLOR(void) {}
+	D3DXCOLOR(DWORD argb) : r((1.0f / 255.0f) * ((argb >> 16) & 0xff)), g((1.0f / 255.0f) * ((argb >> 8) & 0xff)),
+		b((1.0f / 255.0f) * (argb & 0xff)), a((1.0f / 255.0f) * ((argb >> 24) & 0xff)) {}
+	D3DXCOLOR(const float* f) : r(f[0]), g(f[1]), b(f[2]), a(f[3]) {}
+	D3DXCOLOR(float fr, float fg, float fb, float fa) : r(fr), g(fg), b(fb), a(fa) {}
+
+	// every channel is clamped to [0, 1], scaled by 255 and rounded
+	operator DWORD(void) const
+	{
+		DWORD dwR = r >= 1.0f ? 0xff : r <= 0.0f ? 0x00 : static_cast<DWORD>(r * 255.0f + 0.5f);
+		DWORD dwG = g >= 1.0f ? 0xff : g <= 0.0f ? 0x00 : static_cast<DWORD>(g * 255.0f + 0.5f);
+		DWORD dwB = b >= 1.0f ? 0xff : b <= 0.0f ? 0x00 : static_cast<DWORD>(b * 255.0f + 0.5f);
+		DWORD dwA = a >= 1.0f ? 0xff : a <= 0.0f ? 0x00 : static_cast<DWORD>(a * 255.0f + 0.5f);
+
+		return (dwA << 24) | (dwR << 16) | (dwG << 8) | dwB;
+	}
+
+	operator float*(void) {return &r;}
+	operator const float*(void) const {return &r;}
+
+	D3DXCOLOR& operator+=(const D3DXCOLOR& c) {r += c.r; g += c.g; b += c.b; a += c.a; return *this;}
+	D3DXCOLOR& operator-=(const D3DXCOLOR& c) {r -= c.r; g -= c.g; b -= c.b; a -= c.a; return *this;}
+	D3DXCOLOR& operator*=(float f) {r *= f; g *= f; b *= f; a *= f; return *this;}
+	D3DXCOLOR& operator/=(float f) {float i = 1.0f / f; r *= i; g *= i; b *= i; a *= i; return *this;}
+
+	D3DXCOLOR operator+(const D3DXCOLOR& c) const {return D3DXCOLOR(r + c.r, g + c.g, b + c.b, a + c.a);}
+	D3DXCOLOR operator-(const D3DXCOLOR& c) const {return D3DXCOLOR(r - c.r, g - c.g, b - c.b, a - c.a);}
+	D3DXCOLOR operator*(float f) const {return D3DXCOLOR(r * f, g * f, b * f, a * f);}
+	D3DXCOLOR operator/(float f) const {float i = 1.0f / f; return D3DXCOLOR(r * i, g * i, b * i, a * i);}
+
+	friend D3DXCOLOR operator*(float f, const D3DXCOLOR& c) {return D3DXCOLOR(f * c.r, f * c.g, f * c.b, f * c.a);}
+
+	bool operator==(const D3DXCOLOR& c) const {return r == c.r && g == c.g && b == c.b && a == c.a;}
+	bool operator!=(const D3DXCOLOR& c) const {return r != c.r || g != c.g || b != c.b || a != c.a;}
+};
+
+inline float D3DXVec3Length(const D3DXVECTOR3* v)
+{
+	return sqrtf(v->x * v->x + v->y * v->y + v->z * v->z);
+}
+
+inline float D3DXVec3Dot(const D3DXVECTOR3* v1, const D3DXVECTOR3* v2)
+{
+	return v1->x * v2->x + v1->y * v2->y + v1->z * v2->z;
+}
+
+inline D3DXVECTOR3* D3DXVec3Cross(D3DXVECTOR3* out, const D3DXVECTOR3* v1, const D3DXVECTOR3* v2)
+{
+	D3DXVECTOR3 cross(v1->y * v2->z - v1->z * v2->y, v1->z * v2->x - v1->x * v2->z, v1->x * v2->y - v1->y * v2->x);
+	*out = cross;
+	return out;
+}
+
+// a vector of length 0 gives the zero vector
+inline D3DXVECTOR3* D3DXVec3Normalize(D3DXVECTOR3* out, const D3DXVECTOR3* v)
+{
+	float length = D3DXVec3Length(v);
+
+	if (length == 0.0f) *out = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
+	else *out = D3DXVECTOR3(v->x / length, v->y / length, v->z / length);
+	return out;
+}
+
+#endif
+
+#endif
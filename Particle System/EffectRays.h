@@ -6,11 +6,12 @@ Particle system that emits particles in all directions with each of these partic
 #define EFFECT_RAYS_H
 
 #include "FireworkParticleSystem.h"
+#include <algorithm>
 
 class EffectRays : public FireworkParticleSystem
 {
 public:
-	EffectRays() : FireworkParticleSystem()
+	EffectRays() : FireworkParticleSystem(), exploded_(false)
 	{
 	}
 
@@ -29,78 +30,27 @@ public:
 		}
 
 		// Update the particles that are still alive...
-		for (std::vector<Particle>::iterator p(particles_.begin()); p != particles_.end(); ++p)
+		stepParticles();
+
+		// sub particles shrink over their lifetime (a lifetime shorter than half a step is one step)
+		float shrink = static_cast<float>(1) / std::max(1, secondsToSteps(subParticleMaxLifetime_));
+		for (int i = 0; i < particlesAlive_; ++i)
 		{
-			if (p -> lifetime_ > 0)	// Update only if this particle is alive.
+			if (particles_.id_[i] == 1)
 			{
-				// Calculate the new position of the particle...
-
-				p -> position_.y +=	p -> velocity_.y * timeIncrement_;
-				p -> position_.x += p -> velocity_.x * timeIncrement_;
-				p -> position_.z += p -> velocity_.z * timeIncrement_;
-
-				// update acceleration/velocity of the particle
-
-				// update velocity
-				p -> velocity_.x += p -> acceleration_.x * timeIncrement_;
-				p -> velocity_.y += p -> acceleration_.y * timeIncrement_;
-				p -> velocity_.z += p -> acceleration_.z * timeIncrement_;
-
-				// update acceleration (this is not physically correct but takes air drag into account to some extent)
-				p -> acceleration_.x = AIR_DRAG * p -> velocity_.x;
-				p -> acceleration_.y = AIR_DRAG * p -> velocity_.y + EARTH_GRAVITY;
-				p -> acceleration_.z = AIR_DRAG * p -> velocity_.z;
-
-				p -> time_ += timeIncrement_;
-				--(p -> lifetime_);
-
-				// update alpha value
-				if(p->lifetime_ < fadeOutTime_)
-				{
-					p->colour_.a -= static_cast<float>(1)/fadeOutTime_;
-				}
-
-				if(p->id_ == 1)
-				{
-					p->size_ -= static_cast<float>(1)/subParticleMaxLifetime_;
-				}
-
-
-				if (p -> lifetime_ == 0)	// Has this particle come to the end of it's life?
-				{
-					--particlesAlive_;		// If so, terminate it.
-				}else if(p ->id_ == 0)
-				{
-					startSingleSubParticle(findNextDeadParticle(), p);
-				}
+				particles_.size_[i] -= shrink;
 			}
 		}
 
-		// Create a pointer to the first vertex in the buffer
-		// Also lock it, so nothing else can touch it while the values are being inserted.
-		POINTVERTEX *points;
-		points_ -> Lock(0, 0, (void**)&points, 0);
-
-		// Fill the vertex buffers with data...
-		int P(0);
-
-		// Now update the vertex buffer - after the update has been
-		// performed, just in case this particle has died in the process.
-
-		for (std::vector<Particle>::iterator p(particles_.begin()); p != particles_.end(); ++p)
+		// every main particle that is still alive leaves a sub particle behind (the new sub particles are appended
+		// behind the particles that existed before, so they are not visited here)
+		for (int i = 0, alive = particlesAlive_; i < alive; ++i)
 		{
-			if (p -> lifetime_ > 0)
+			if (particles_.id_[i] == 0)
 			{
-				points[P].position_.y = p -> position_.y;
-				points[P].position_.x = p -> position_.x;
-				points[P].position_.z = p -> position_.z;
-
-				points[P].color_ = p -> colour_;
-				++P;
+				startSingleSubParticle(allocateParticle(), i);
 			}
 		}
-
-		points_ -> Unlock();
 	}
 
 	bool exploded_;	 //particles already started?
@@ -108,12 +58,12 @@ public:
 	float subParticleMaxSize_;
 	float subParticleLaunchVelocity_;
 	D3DXCOLOR subParticleBaseColour_;				// the base colour of the particles for this system
-	int subParticleFadeOutTime_;					// the particel should start fading out when there is only this much lifetime left
+	float subParticleFadeOutTime_;					// the particel should start fading out when there is only this much lifetime left (in seconds)
 	D3DXVECTOR3 subParticleMaxColourDivergence_;	// the colour of single particles can divert this much from the base colour (r,g,b)
-	float subParticleMaxLifetimeDivergence_;		// the actual lifetime of the particles can divert this much from the maximal lifetime value
+	float subParticleMaxLifetimeDivergence_;		// the actual lifetime of the particles can divert this much from the maximal lifetime value (in seconds)
 	float subParticleMaxSizeDivergence_;			// the actual size of the particles can divert this much from the base size value
 	float subParticleMaxVelocityDivergence_;		// the actual launch velocity of the particles can divert this much from the base value
-	int subParticleMaxLifetime_;
+	float subParticleMaxLifetime_;					// in seconds
 
 	virtual void reset(void)
 	{
@@ -121,105 +71,109 @@ public:
 		exploded_ = false;
 	}
 
+	// the main particles are started once (the sub particles only while there are main particles)
+	virtual bool startsParticles(void) const
+	{
+		return !exploded_;
+	}
+
+	virtual void saveState(Snapshot& snapshot) const
+	{
+		FireworkParticleSystem::saveState(snapshot);
+		snapshot.write(exploded_);
+	}
+
+	virtual void restoreState(Snapshot& snapshot)
+	{
+		FireworkParticleSystem::restoreState(snapshot);
+		snapshot.read(&exploded_);
+	}
+
 
 private:
-	virtual void startSingleParticle(std::vector<Particle>::iterator& p)
+	virtual void startParticleBatch(int first, int count)
 	{
-		if (p == particles_.end()) return;	// Safety net - if there are no dead particles, don't start any new ones...
+		// pick the directions of the whole batch at once
+		startDirections(first, count);
+		FireworkParticleSystem::startParticleBatch(first, count);
+	}
 
-		p -> id_ = 0;
+	virtual void startSingleParticle(int p)
+	{
+		if (p < 0) return;	// Safety net - if there are no dead particles, don't start any new ones...
 
-		// Reset the particle's time (for calculating it's position with s = ut+0.5t*t)
-		p -> time_ = 0;
+		particles_.id_[p] = 0;
 
-		// Calculate random angles that will determine the direction in which to emit the particles
-		float angleHorizontal = (float)(D3DXToRadian(random_number()));
-		float angleVertical = (float)(D3DXToRadian(random_number()));
+		// Reset the particle's time (for calculating it's position with s = ut+0.5t*t)
+		particles_.time_[p] = 0;
 
 		// set particle starting positions to the origin
-		p -> position_.x = origin_.x;
-		p -> position_.y = origin_.y;
-		p -> position_.z = origin_.z;
+		particles_.setPosition(p, origin_);
 
 		float particleLaunchVelocity = getRandomVelocity();
 
-		// Calculate start velocity for the particle using the previously calculated angles
-		p->velocity_.x = particleLaunchVelocity * (float)sin(angleVertical) * (float)cos(angleHorizontal);
-		p->velocity_.y = particleLaunchVelocity * (float)cos(angleVertical);
-		p->velocity_.z = particleLaunchVelocity * (float)sin(angleVertical) * (float)sin(angleHorizontal);
+		// Calculate start velocity for the particle, its direction has already been written by startParticleBatch
+		particles_.setVelocity(p, particleLaunchVelocity * particles_.getVelocity(p));
 		
 		// Calculate start acceleration
-		p -> acceleration_.x = AIR_DRAG * p -> velocity_.x;
-		p -> acceleration_.y = AIR_DRAG * p -> velocity_.y + EARTH_GRAVITY;
-		p -> acceleration_.z = AIR_DRAG * p -> velocity_.z;
+		particles_.resetAcceleration(p);
 
 		// set the colour for the particle
-		getRandomColour(&(p->colour_));
+		D3DXCOLOR colour;
+		getRandomColour(&colour);
+		particles_.setColour(p, colour);
 		// set lifetime 
-		p -> lifetime_ = getRandomLifetime();
+		particles_.lifetime_[p] = getRandomLifetime();
 		// set particle size
-		p -> size_ = getRandomSize();
-
-		++particlesAlive_;
+		particles_.size_[p] = getRandomSize();
 	}
 
 	virtual void startParticles()
 	{
 		// Number of particles to start in this batch...
-		for (int i(0); i < startParticles_; ++i)
-		{
-			if (particlesAlive_ < maxParticles_) startSingleParticle(findNextDeadParticle());
-		}
+		int first = particlesAlive_;
+		startBatch(first, allocateParticles(startParticles_));
 	}
 
-	void startSingleSubParticle(std::vector<Particle>::iterator& p, std::vector<Particle>::iterator& sourceParticle)
+	void startSingleSubParticle(int p, int sourceParticle)
 	{
-		if (p == particles_.end()) return;	// Safety net - if there are no dead particles, don't start any new ones...
+		if (p < 0) return;	// Safety net - if there are no dead particles, don't start any new ones...
 
-		p -> id_ = 1;	// sub particle
+		particles_.id_[p] = 1;	// sub particle
 
 		// Reset the particle's time (for calculating it's position with s = ut+0.5t*t)
-		p -> time_ = 0;
+		particles_.time_[p] = 0;
 
 		// set particle starting positions to the origin
-		p -> position_.x = sourceParticle->position_.x;
-		p -> position_.y = sourceParticle->position_.y;
-		p -> position_.z = sourceParticle->position_.z;
+		particles_.setPosition(p, particles_.getPosition(sourceParticle));
 
-		float particleLaunchVelocity = subParticleLaunchVelocity_ - (static_cast<float>(random_number(0, 200)) - 100.0f) * 0.01f * subParticleMaxVelocityDivergence_;
+		float particleLaunchVelocity = subParticleLaunchVelocity_ - (static_cast<float>(random_.number(0, 200)) - 100.0f) * 0.01f * subParticleMaxVelocityDivergence_;
 
 		// Calculate start velocity for the particle using the previously calculated angles
 		
 		D3DXVECTOR3 normalisedSourceVelocity;
-		D3DXVec3Normalize(&normalisedSourceVelocity, &(sourceParticle->velocity_));
+		D3DXVECTOR3 sourceVelocity(particles_.getVelocity(sourceParticle));
+		D3DXVec3Normalize(&normalisedSourceVelocity, &sourceVelocity);
 
 		// these sub particles don't have a velocity of their own, they simply get placed at the current position of the respective main
 		// particle and are subject to environmental influence from there on
-		p->velocity_.x = 0;
-		p->velocity_.y = 0;
-		p->velocity_.z = 0;
+		particles_.setVelocity(p, D3DXVECTOR3(0, 0, 0));
 
 		// Calculate start acceleration
-		p -> acceleration_.x = AIR_DRAG * p -> velocity_.x;
-		p -> acceleration_.y = AIR_DRAG * p -> velocity_.y + EARTH_GRAVITY;
-		p -> acceleration_.z = AIR_DRAG * p -> velocity_.z;
+		particles_.resetAcceleration(p);
 
 		// set the colour for the particle
-		p->colour_.a = subParticleBaseColour_.a;
-		p->colour_.r = subParticleBaseColour_.r;
-		p->colour_.g = subParticleBaseColour_.g;
-		p->colour_.b = subParticleBaseColour_.b;
+		particles_.setColour(p, subParticleBaseColour_);
 
 		// set the lifetime for the sub particle
-		if(sourceParticle->lifetime_ >= subParticleMaxLifetime_)
-			p -> lifetime_ = subParticleMaxLifetime_;
+		int subParticleLifetime = secondsToSteps(subParticleMaxLifetime_);
+		if(particles_.lifetime_[sourceParticle] >= subParticleLifetime)
+			particles_.lifetime_[p] = subParticleLifetime;
 		else
-			p -> lifetime_ = sourceParticle->lifetime_;	// it looks better when the sub paticle does not live longer than the source particle
+			particles_.lifetime_[p] = particles_.lifetime_[sourceParticle];	// it looks better when the sub paticle does not live longer than the source particle
 		
 		// set particle size
-		p -> size_ = subParticleMaxSize_ - static_cast<float>(random_number(0, 100)) * 0.01f * subParticleMaxSizeDivergence_; 
-
-		++particlesAlive_;
+		particles_.size_[p] = subParticleMaxSize_ - static_cast<float>(random_.number(0, 100)) * 0.01f * subParticleMaxSizeDivergence_; 
 	}
 };
 
@@ -0,0 +1,62 @@
+#include "EmitterDirections.h"
+#include <math.h>
+
+
+// number of angles around the y axis (a power of two, so a random number can be turned into an index by shifting)
+static const int DIRECTION_TABLE_BITS = 10;
+static const int DIRECTION_TABLE_SIZE = 1 << DIRECTION_TABLE_BITS;
+
+struct DirectionTable
+{
+	float cos_[DIRECTION_TABLE_SIZE];
+	float sin_[DIRECTION_TABLE_SIZE];
+
+	DirectionTable()
+	{
+		for (int i = 0; i < DIRECTION_TABLE_SIZE; ++i)
+		{
+			// the centre of each slice, so the table is symmetric
+			float angle = (i + 0.5f) * 2.0f * D3DX_PI / DIRECTION_TABLE_SIZE;
+			cos_[i] = cosf(angle);
+			sin_[i] = sinf(angle);
+		}
+	}
+};
+
+// created on first use
+static const DirectionTable& directionTable()
+{
+	static const DirectionTable table;
+	return table;
+}
+
+void sphereDirections(RandomEngine& random, float* x, float* y, float* z, int n)
+{
+	if (n <= 0) return;
+
+	const DirectionTable& table = directionTable();
+
+	// the heights go straight into 'y', 'x' is used for the angles until it is overwritten below
+	random.fill(y, n, -1.0f, 1.0f);
+	random.fill(x, n, 0.0f, static_cast<float>(DIRECTION_TABLE_SIZE));
+
+	for (int i = 0; i < n; ++i)
+	{
+		int angle = static_cast<int>(x[i]) & (DIRECTION_TABLE_SIZE - 1);
+		float radius = sqrtf(1.0f - y[i] * y[i]);
+
+		x[i] = radius * table.cos_[angle];
+		z[i] = radius * table.sin_[angle];
+	}
+}
+
+D3DXVECTOR3 sphereDirection(RandomEngine& random)
+{
+	const DirectionTable& table = directionTable();
+
+	float y = random.uniform(-1.0f, 1.0f);
+	int angle = random.next() >> (32 - DIRECTION_TABLE_BITS);
+	float radius = sqrtf(1.0f - y * y);
+
+	return D3DXVECTOR3(radius * table.cos_[angle], y, radius * table.sin_[angle]);
+}
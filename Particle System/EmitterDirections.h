@@ -0,0 +1,19 @@
+/*
+Directions for emitting particles: unit vectors spread uniformly over the whole sphere (y pointing up).
+The height is picked uniformly in [-1, 1] and the angle around the y axis is looked up in a precomputed table, so no
+rejection and no trigonometric functions are needed per particle.
+*/
+
+#ifndef EMITTER_DIRECTIONS_H
+#define EMITTER_DIRECTIONS_H
+
+#include "Direct3DTypes.h"
+#include "RandomEngine.h"
+
+// writes 'n' random directions into the three arrays (one per component)
+void sphereDirections(RandomEngine& random, float* x, float* y, float* z, int n);
+
+// returns a single random direction
+D3DXVECTOR3 sphereDirection(RandomEngine& random);
+
+#endif
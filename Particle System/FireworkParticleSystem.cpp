@@ -1,4 +1,16 @@
 #include "FireworkParticleSystem.h"
+#include "ParticleIntegrator.h"
+#include "EmitterDirections.h"
+#include <algorithm>
+#include <emmintrin.h>	// SSE2 (store fence)
+
+
+// number of particles stepped by a single job (a multiple of the SIMD width, so every chunk starts aligned)
+static const int STEP_CHUNK_SIZE = 4096;
+
+// number of particles stepped before their points are written, so all of their arrays are still in the L1 cache
+// (21 arrays of 1 kB plus the flicker, a multiple of the SIMD width as well)
+static const int EMIT_TILE_SIZE = 256;
 
 
 FireworkParticleSystem::FireworkParticleSystem(void) : ParticleSystem(), 
@@ -8,7 +20,10 @@ FireworkParticleSystem::FireworkParticleSystem(void) : ParticleSystem(),
 	maxLifetimeDivergence_(0),
 	maxSizeDivergence_(0),
 	maxVelocityDivergence_(0),
-	launchVelocity_(0)
+	launchVelocity_(0),
+	sourceObject_(NULL),
+	motion_(EulerMotion),
+	emitAlpha_(-1.0f)
 {
 }
 
@@ -20,65 +35,110 @@ FireworkParticleSystem::~FireworkParticleSystem(void)
 // virtual function
 void FireworkParticleSystem::render(void)
 {
-	// Enable point sprites, and set the size of the point.
-	renderTarget_  -> SetRenderState(D3DRS_POINTSPRITEENABLE, true);
-	renderTarget_  -> SetRenderState(D3DRS_POINTSCALEENABLE,  true);
-
-	// Disable z buffer while rendering the particles. Makes rendering quicker and
-	// stops any visual (alpha) 'artefacts' on screen while rendering.
-	renderTarget_ -> SetRenderState(D3DRS_ZENABLE, false);
-		    
-	// Scale the points according to distance...
-	renderTarget_ -> SetRenderState(D3DRS_POINTSIZE,     FtoDW(maxParticleSize_));
-
-	renderTarget_ -> SetRenderState(D3DRS_POINTSIZE_MIN, FtoDW(0.00f));
-	renderTarget_ -> SetRenderState(D3DRS_POINTSCALE_A,  FtoDW(0.00f));
-	renderTarget_ -> SetRenderState(D3DRS_POINTSCALE_B,  FtoDW(0.00f));
-	renderTarget_ -> SetRenderState(D3DRS_POINTSCALE_C,  FtoDW(1.00f));
-
-	// Now select the texture for the points...
-	// Use texture colour and alpha components.
-	renderTarget_ -> SetTexture(0, particleTexture_);
-	renderTarget_ -> SetRenderState(D3DRS_ALPHABLENDENABLE, true);
-	renderTarget_ -> SetRenderState(D3DRS_SRCBLEND,  D3DBLEND_SRCALPHA);
-	renderTarget_ -> SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
-	
-	// use the diffuse color of the particle
-	renderTarget_ -> SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
-	renderTarget_ -> SetTextureStageState(0, D3DTSS_COLOROP,	D3DTOP_SELECTARG1);
-
-	// modulate the alpha values of the particle and the texture 
-	renderTarget_ -> SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
-	renderTarget_ -> SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
-	renderTarget_ -> SetTextureStageState(0, D3DTSS_ALPHAOP,   D3DTOP_MODULATE);
-	
-	// Render the contents of the vertex buffer.
-	renderTarget_ -> SetStreamSource(0, points_, 0, sizeof(POINTVERTEX));
-	renderTarget_ -> SetFVF(D3DFVF_POINTVERTEX);
-
-	for(unsigned int i = 0; i < particles_.size(); ++i)
+	// nothing to draw, don't bind anything either
+	if (!hasVertices()) return;
+
+	// use the diffuse colour of the particles, modulate the alpha values of the particles and the texture
+	// (the size of each point is part of its vertex)
+	renderBackend_ -> bindPoints(ColouredPoints, particleTexture_, 0);
+
+	// Render the range of the shared vertex buffer written during the update.
+	// all particles are drawn at once, each one in its specific size
+	renderBackend_ -> drawPoints(vertexOffset_, vertexCount_);
+	renderBackend_ -> unbindPoints();
+}
+
+void FireworkParticleSystem::setMotion(ParticleMotion motion)
+{
+	motion_ = motion == ExactMotion && hasExactMotion() ? ExactMotion : EulerMotion;
+}
+
+void FireworkParticleSystem::updateAndEmit(float alpha)
+{
+	emitAlpha_ = emitsWhileStepping() ? alpha : -1.0f;
+	step();
+	emitAlpha_ = -1.0f;
+}
+
+int FireworkParticleSystem::stepRange(int (*step)(ParticleStore&, int, int, float, int, int*), int begin, int end,
+									  int fadeOutSteps, int* died, POINTVERTEX* points)
+{
+	if (points == NULL) return step(particles_, begin, end, timeIncrement_, fadeOutSteps, died);
+
+	int count = 0;
+	for (int tile = begin; tile < end; tile += EMIT_TILE_SIZE)
+	{
+		int tileEnd = std::min(tile + EMIT_TILE_SIZE, end);
+		count += step(particles_, tile, tileEnd, timeIncrement_, fadeOutSteps, died + count);
+		writePoints(points, tile, tileEnd - tile, emitAlpha_);
+	}
+
+	// the points have to be in memory before the stream is unlocked
+	_mm_sfence();
+	return count;
+}
+
+void FireworkParticleSystem::stepParticles(void)
+{
+	// only the living particles at the front of the store need to be visited
+	int died = 0;
+	int fadeOutSteps = secondsToSteps(fadeOutTime_);
+	int (*step)(ParticleStore&, int, int, float, int, int*) = motion_ == ExactMotion ? evaluateParticles : integrateParticles;
+
+	// in the last step of a frame the points of all particles stepped are written as well (if there is room for them)
+	POINTVERTEX* points = NULL;
+	if (emitAlpha_ >= 0 && particlesAlive_ > 0) points = reservePoints(particlesAlive_);
+
+	if (jobSystem_ == NULL || particlesAlive_ <= STEP_CHUNK_SIZE)
+	{
+		died = stepRange(step, 0, particlesAlive_, fadeOutSteps, &diedParticles_[0], points);
+	}
+	else
 	{
-		if(particles_[i].lifetime_ > 0)
+		// every chunk writes the particles that died into its own part of the list (there can't be more than the chunk holds)
+		int chunks = (particlesAlive_ + STEP_CHUNK_SIZE - 1) / STEP_CHUNK_SIZE;
+		chunkDied_.resize(chunks);
+
+		JobSystem::Counter counter(0);
+		for (int c = 0; c < chunks; ++c)
 		{
-			// render the particle in its specific size
-			renderTarget_ -> SetRenderState(D3DRS_POINTSIZE, FtoDW(static_cast<float>(random_number(0, 100)) * 0.01f * particles_[i].size_));
-			renderTarget_ -> DrawPrimitive(D3DPT_POINTLIST, i, 1);
+			jobSystem_ -> submit([this, c, fadeOutSteps, step, points] {
+				int begin = c * STEP_CHUNK_SIZE;
+				int end = std::min(begin + STEP_CHUNK_SIZE, particlesAlive_);
+				chunkDied_[c] = stepRange(step, begin, end, fadeOutSteps, &diedParticles_[begin], points);
+			}, &counter);
 		}
+		jobSystem_ -> wait(&counter);
+
+		// join the lists in the order of the chunks, so the particles are handled as if they had been stepped at once
+		int* diedList = &diedParticles_[0];
+		for (int c = 0; c < chunks; ++c)
+		{
+			int* chunkBegin = diedList + c * STEP_CHUNK_SIZE;
+			std::copy(chunkBegin, chunkBegin + chunkDied_[c], diedList + died);
+			died += chunkDied_[c];
+		}
+	}
+
+	// let the effect react to the dead particles first (new particles are appended behind all existing ones),
+	// then close the gaps
+	for (int i = 0; i < died; ++i)
+	{
+		particleDied(diedParticles_[i]);
 	}
 
-	// Reset the render states.
-	renderTarget_ -> SetRenderState(D3DRS_POINTSPRITEENABLE, false);
-	renderTarget_ -> SetRenderState(D3DRS_POINTSCALEENABLE,  false);
-	renderTarget_ -> SetRenderState(D3DRS_ALPHABLENDENABLE,  false);
-	renderTarget_ -> SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+	releaseParticles(&diedParticles_[0], died);
+}
 
-	renderTarget_ -> SetRenderState(D3DRS_ZENABLE, D3DZB_TRUE);
+void FireworkParticleSystem::startDirections(int first, int count)
+{
+	sphereDirections(random_, particles_.velocityX_ + first, particles_.velocityY_ + first, particles_.velocityZ_ + first, count);
 }
 
-// returns the lifetime for a particle taking the allowed divergence into account
+// returns the lifetime for a particle taking the allowed divergence into account (counted in simulation steps)
 int FireworkParticleSystem::getRandomLifetime(void)
 {
-	return maxLifetime_ - random_number(0, static_cast<unsigned int>(maxLifetimeDivergence_));
+	return secondsToSteps(maxLifetime_ - random_.uniform(0.0f, maxLifetimeDivergence_));
 }
 
 // sets the colour for a particle using the set values for divergence
@@ -86,9 +146,9 @@ void FireworkParticleSystem::getRandomColour(D3DXCOLOR* particleColour)
 {
 	particleColour -> a = baseColour_.a;
 
-	particleColour -> r = baseColour_.r + (static_cast<float>(random_number(0, 200)) - 100.0f) * 0.01f * maxColourDivergence_.x;
-	particleColour -> g = baseColour_.g + (static_cast<float>(random_number(0, 200)) - 100.0f) * 0.01f * maxColourDivergence_.y;
-	particleColour -> b = baseColour_.b + (static_cast<float>(random_number(0, 200)) - 100.0f) * 0.01f * maxColourDivergence_.z;
+	particleColour -> r = baseColour_.r + (static_cast<float>(random_.number(0, 200)) - 100.0f) * 0.01f * maxColourDivergence_.x;
+	particleColour -> g = baseColour_.g + (static_cast<float>(random_.number(0, 200)) - 100.0f) * 0.01f * maxColourDivergence_.y;
+	particleColour -> b = baseColour_.b + (static_cast<float>(random_.number(0, 200)) - 100.0f) * 0.01f * maxColourDivergence_.z;
 
 	if(particleColour -> r > 1.0f)
 		particleColour -> r = 1.0f;
@@ -109,17 +169,23 @@ void FireworkParticleSystem::getRandomColour(D3DXCOLOR* particleColour)
 // sets the size for a particle taking the allowed divergence into account
 float FireworkParticleSystem::getRandomSize(void)
 {
-	return maxParticleSize_ - static_cast<float>(random_number(0, 100)) * 0.01f * maxSizeDivergence_; 
+	return maxParticleSize_ - static_cast<float>(random_.number(0, 100)) * 0.01f * maxSizeDivergence_; 
 }
 
 // sets the launch velocity for a particle taking the allowed divergence into account
 float FireworkParticleSystem::getRandomVelocity(void)
 {
-	return launchVelocity_ - (static_cast<float>(random_number(0, 200)) - 100.0f) * 0.01f * maxVelocityDivergence_; 
+	return launchVelocity_ - (static_cast<float>(random_.number(0, 200)) - 100.0f) * 0.01f * maxVelocityDivergence_; 
 }
 
 void FireworkParticleSystem::reset(void)
 {
-	particlesAlive_ = 0;
-	startTimer_ = 0;
+	waitForPrebuild();
+	discardPrebuiltBatch();
+
+	// Giving the lease back kills all living particles at once (whatever lifetime they had left). It happens right
+	// away rather than in the next step, so a rocket fired again at the time it is reset still prebuilds its explosion
+	// (a batch is only prebuilt while the system holds no particles).
+	returnParticles();
+	startCountdown_ = 0;
 }
\ No newline at end of file
@@ -8,6 +8,7 @@ Adds randomization of particles, a new render implementation and a reset functio
 
 #include "ParticleSystem.h"
 #include "EnvironmentalConstants.h"
+#include "ParticleIntegrator.h"
 
 class Projectile; // forward declaration
 
@@ -16,15 +17,15 @@ class FireworkParticleSystem : public ParticleSystem
 {
 public:
 	FireworkParticleSystem(void);
-	~FireworkParticleSystem(void);
+	virtual ~FireworkParticleSystem(void);
 	
 	virtual void render(void);	
 	virtual void reset(void);
 
 	D3DXCOLOR baseColour_;				// the base colour of the particles for this system
-	int fadeOutTime_;					// the particel should start fading out when there is only this much lifetime left
+	float fadeOutTime_;					// the particel should start fading out when there is only this much lifetime left (in seconds)
 	D3DXVECTOR3 maxColourDivergence_;	// the colour of single particles can divert this much from the base colour (r,g,b)
-	float maxLifetimeDivergence_;		// the actual lifetime of the particles can divert this much from the maximal lifetime value
+	float maxLifetimeDivergence_;		// the actual lifetime of the particles can divert this much from the maximal lifetime value (in seconds)
 	float maxSizeDivergence_;			// the actual size of the particles can divert this much from the base size value
 	float maxVelocityDivergence_;		// the actual launch velocity of the particles can divert this much from the base value
 	float launchVelocity_;				// the base velocity with which a particle is launched
@@ -32,14 +33,51 @@ public:
 	// for particle systems depending on position/velocity of the projectile
 	void setProjectile(Projectile* projectile){sourceObject_ = projectile;}
 
+	// The last simulation step of a frame: the particles are stepped and written to the vertex ring in the same pass
+	// ('alpha' as for emitVertices, which skips the system afterwards), tile by tile while they are in the cache. The
+	// order of the points differs from emitVertices, as the particles that died are only removed afterwards. Systems
+	// that can't do this are just updated.
+	void updateAndEmit(float alpha);
+
+	// how stepParticles moves the particles, systems without a closed form always stay with the Euler integrator
+	void setMotion(ParticleMotion motion);
+	ParticleMotion motion(void) const {return motion_;}
+
 protected:
+	// advances all particles by one time step and releases the ones that died (large systems are split into chunks
+	// that are stepped in parallel, the result does not depend on the number of threads)
+	void stepParticles(void);
+
+	// called for every particle that died during stepParticles, before it is released
+	virtual void particleDied(int p) {}
+
+	// whether the particles are only moved by air drag and gravity after their start (and every particle is started
+	// with its origin set), so they can be evaluated in closed form
+	virtual bool hasExactMotion(void) const {return false;}
+
+	// whether stepParticles is the last thing update does to the particles (no particles are started, changed or
+	// removed afterwards), so their points can be written while they are stepped (see updateAndEmit)
+	virtual bool emitsWhileStepping(void) const {return false;}
+
+	// writes random directions (unit vectors) into the velocities of the particles [first, first + count)
+	void startDirections(int first, int count);
+
 	// for convencience, randomize specific parameters
-	int getRandomLifetime(void);
+	int getRandomLifetime(void);		// in simulation steps
 	void getRandomColour(D3DXCOLOR* particleColour);
 	float getRandomSize(void);
 	float getRandomVelocity(void);
 
 	Projectile* sourceObject_; 
+
+	std::vector<int> chunkDied_;		// number of particles that died in each chunk during stepParticles
+	ParticleMotion motion_;
+	float emitAlpha_;					// the interpolation of the points written by stepParticles, negative if none are
+
+private:
+	// steps the particles [begin, end) and writes their points if 'points' is not NULL, returns the number that died
+	int stepRange(int (*step)(ParticleStore&, int, int, float, int, int*), int begin, int end, int fadeOutSteps,
+				  int* died, POINTVERTEX* points);
 };
 
 #endif
\ No newline at end of file
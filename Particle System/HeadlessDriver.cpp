@@ -0,0 +1,2002 @@
+/*
+Runs the simulation of a show without a window or Direct3D device and reports how long the frames took. The show is
+built from the same show file as in the application and drawn with the null render backend (the vertices are written
+to system memory) or the software render backend (the frames are drawn on the CPU), recording what would be submitted
+to the driver. The frames are run back to back (at a fixed frame rate of simulated time) so the numbers can be
+compared between builds.
+
+The driver needs neither Direct3D nor the DirectX SDK (see Direct3DTypes.h). Besides the Headless Driver project it
+builds on Linux from all sources except the application and the D3D9 render backend, e.g.
+	g++ -O2 -std=c++17 -msse2 -pthread $(ls *.cpp | grep -v -e ParticleSystemApplication -e D3D9RenderBackend)
+Built with -fsanitize=thread -g added to that line, --check jobs (and --check determinism) run the job system and the
+show under ThreadSanitizer, which reports every data race on the console.
+
+Usage: HeadlessDriver [options]
+	--scenario name		default, all-at-once, burst, stress or all (default: all)
+	--frames n			the number of frames to run (default: 1200)
+	--fps n				the simulated frame rate (default: 60)
+	--workers n			the number of worker threads, -1 for one less than there are cores (default: -1)
+	--seed n			the seed of the random numbers (default: 1)
+	--budget n			the size of the particle pool, 0 for the default of the scenario (default: 0)
+	--show file			the show file (default: Fireworks.show)
+	--format csv|json	the format of the report (default: csv)
+	--output file		where the report is written to (default: the console)
+	--render null|software	how the frames are drawn (default: null)
+	--width n			the size of the software rendered frames (default: 800)
+	--height n			(default: 600)
+	--images pattern	writes the software rendered frames to PNG files, e.g. frame%04d.png (default: none)
+	--image-every n		writes every n-th frame only (default: 1)
+	--keyframes pattern	writes a snapshot of the simulation every few seconds to the files given by the pattern (with
+						the simulation step), e.g. key%06d.snap, or reads them when seeking (default: none)
+	--keyframe-every s	the seconds between two keyframes (default: 1)
+	--motion euler|exact	how the effects move their particles: stepped by the Euler integrator or evaluated in closed
+						form (default: euler), the report gives the largest distance between both for the show
+	--seek s			starts the run at the given second of the show, from the last keyframe before it (the frames
+						up to there are not reported) (default: 0)
+	--colours n			instead of running the scenarios, times the conversion of n float colours to packed vertex
+						colours: by D3DXCOLOR, by the scalar and by the SSE2 version of ColourPacking (default: 0)
+	--integrator n		instead of running the scenarios, times the Euler step of n particles on a single core with
+						every kernel the CPU supports (scalar, SSE2, AVX2) and compares them with the scalar one
+	--layout n			instead of running the scenarios, times the update of the rays (n particles, 9300 in the show)
+						on a single core: with the particle records used before the ParticleStore, and with the store
+						by scalar and by vectorised loops
+	--directions n		instead of running the scenarios, times n bursts of 2000 emitter directions picked by two
+						random angles (as before) and by sphereDirections, and reports how evenly both spread them
+	--scaling n			instead of running the scenarios, runs the stress scenario on 1 to n threads (the main thread
+						and up to n - 1 workers) and reports the frame times and the speedup against one thread
+	--scheduler n		instead of running the scenarios, schedules n events within 10 minutes and fires them step by
+						step, with the timing wheel of the launch scheduler and with a binary heap
+	--check name|all	instead of running the scenarios, runs the named check (or all of them) and reports whether
+						it passed, the exit code is 1 if one failed:
+						integrator	the vectorised Euler steps give the results of the scalar one
+						ring		the vertex ring locks, discards and draws the ranges it should
+						determinism	500 frames of the stress scenario are drawn the same with 1, 2, 4 and 8 workers
+						snapshot	the stress scenario restored from a snapshot draws the frames of the run it was saved from
+						fps			the show simulated at 30, 60 and 240 frames per second is the same at every second
+						jobs		nested jobs on 0 to 8 workers are all run and waited for (see ThreadSanitizer above)
+						scheduler	events are fired once, in order, with their tick and during the advance passing it
+						reset		a show stopped while rockets fly and effects are prebuilt draws nothing afterwards
+*/
+
+#include "ShowDescription.h"
+#include "Show.h"
+#include "ParticlePool.h"
+#include "VertexRing.h"
+#include "NullRenderBackend.h"
+#include "RecordingRenderBackend.h"
+#include "SoftwareRenderBackend.h"
+#include "JobSystem.h"
+#include "SimulationClock.h"
+#include "LaunchScheduler.h"
+#include "Snapshot.h"
+#include "ParticleIntegrator.h"
+#include "ColourPacking.h"
+#include "RandomEngine.h"
+#include "EmitterDirections.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+using namespace std;
+
+
+// derives the rockets of a scenario from the rockets of the show file
+typedef void (*PrepareScenario)(vector<RocketRecord>& rockets);
+
+struct Scenario
+{
+	const char* name_;
+	int budget_;					// the default size of the particle pool
+	PrepareScenario prepare_;
+};
+
+// the show as it is
+void prepareDefault(vector<RocketRecord>& rockets)
+{
+}
+
+// every rocket is launched at the start of the show
+void prepareAllAtOnce(vector<RocketRecord>& rockets)
+{
+	for (size_t i = 0; i < rockets.size(); ++i)
+	{
+		rockets[i].launchTime_ = 0;
+	}
+}
+
+// only the rockets launched together 4 seconds into the show (the four spheres), to see the frames they explode in
+void prepareBurst(vector<RocketRecord>& rockets)
+{
+	const float launchTime = 4000.0f;
+
+	vector<RocketRecord> burst;
+	for (size_t i = 0; i < rockets.size(); ++i)
+	{
+		if (rockets[i].launchTime_ == launchTime) burst.push_back(rockets[i]);
+	}
+	rockets.swap(burst);
+}
+
+// 1000 rockets (the rockets of the show over and over again) launched within 10 seconds along the whole scene
+void prepareStress(vector<RocketRecord>& rockets)
+{
+	const int count = 1000;
+	const float duration = 10000.0f;
+	const float left = -400.0f, right = 400.0f;
+
+	vector<RocketRecord> base(rockets);
+	if (base.empty()) return;
+
+	rockets.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		rockets[i] = base[i % base.size()];
+		rockets[i].launchTime_ = duration * i / count;
+		rockets[i].position_[0] = left + (right - left) * ((i * 37) % count) / count;
+	}
+}
+
+const Scenario scenarios[] =
+{
+	{"default", 32 * 1024, prepareDefault},
+	{"all-at-once", 64 * 1024, prepareAllAtOnce},
+	{"burst", 32 * 1024, prepareBurst},
+	{"stress", 1024 * 1024, prepareStress},
+};
+const int SCENARIOS = sizeof(scenarios) / sizeof(scenarios[0]);
+
+struct Benchmark;
+
+struct Options
+{
+	const char* scenario_;
+	int frames_;
+	float fps_;
+	int workers_;
+	unsigned int seed_;
+	int budget_;
+	const char* show_;
+	bool json_;
+	const char* output_;
+	bool software_;
+	int width_;
+	int height_;
+	const char* images_;
+	int imageEvery_;
+	const char* keyframes_;
+	float keyframeEvery_;
+	float seek_;
+	ParticleMotion motion_;
+	const Benchmark* benchmark_;	// the micro benchmark run instead of the scenarios (NULL for none)
+	int benchmarkSize_;
+	const char* check_;
+};
+
+// a column of a report, its numbers are written with the given printf format (NULL for a column of text)
+struct ReportColumn
+{
+	const char* name_;
+	const char* format_;
+};
+
+// The rows of a report (of the scenarios or of a micro benchmark), written as CSV (a line with the names of the columns,
+// then a line per row) or as JSON (an object per row). The values are added row by row, in the order of the columns.
+class ReportTable
+{
+public:
+	template <int N>
+	explicit ReportTable(const ReportColumn (&columns)[N]) : columns_(columns, columns + N) {}
+
+	void add(const char* text);
+	void add(double number);
+
+	int rows(void) const {return static_cast<int>(cells_.size() / columns_.size());}
+	double number(int row, const char* column) const;	// (0 for a column that does not exist)
+
+	void write(FILE* file, bool json) const;
+
+private:
+	struct Cell
+	{
+		string text_;
+		double number_;
+	};
+
+	vector<ReportColumn> columns_;
+	vector<Cell> cells_;
+};
+
+void ReportTable::add(const char* text)
+{
+	Cell cell = {text, 0};
+	cells_.push_back(cell);
+}
+
+void ReportTable::add(double number)
+{
+	char text[64];
+	snprintf(text, sizeof(text), columns_[cells_.size() % columns_.size()].format_, number);
+
+	Cell cell = {text, number};
+	cells_.push_back(cell);
+}
+
+double ReportTable::number(int row, const char* column) const
+{
+	for (size_t c = 0; c < columns_.size(); ++c)
+	{
+		if (strcmp(columns_[c].name_, column) == 0) return cells_[row * columns_.size() + c].number_;
+	}
+	return 0;
+}
+
+void ReportTable::write(FILE* file, bool json) const
+{
+	size_t columns = columns_.size();
+	if (!json)
+	{
+		for (size_t c = 0; c < columns; ++c)
+		{
+			fprintf(file, "%s%s", columns_[c].name_, c + 1 < columns ? "," : "\n");
+		}
+	}
+	else fprintf(file, "[\n");
+
+	int rowCount = rows();
+	for (int r = 0; r < rowCount; ++r)
+	{
+		if (json) fprintf(file, "\t{");
+		for (size_t c = 0; c < columns; ++c)
+		{
+			const Cell& cell = cells_[r * columns + c];
+			if (!json) fprintf(file, "%s%s", cell.text_.c_str(), c + 1 < columns ? "," : "\n");
+			else if (columns_[c].format_) fprintf(file, "\"%s\": %s%s", columns_[c].name_, cell.text_.c_str(), c + 1 < columns ? ", " : "");
+			else fprintf(file, "\"%s\": \"%s\"%s", columns_[c].name_, cell.text_.c_str(), c + 1 < columns ? ", " : "");
+		}
+		if (json) fprintf(file, "}%s\n", r + 1 < rowCount ? "," : "");
+	}
+
+	if (json) fprintf(file, "]\n");
+}
+
+// writes a report to the output given by the options
+int writeReport(const Options& options, const ReportTable& table)
+{
+	FILE* file = stdout;
+	if (options.output_ && (file = fopen(options.output_, "w")) == NULL)
+	{
+		fprintf(stderr, "%s: cannot be written\n", options.output_);
+		return 1;
+	}
+
+	table.write(file, options.json_);
+
+	if (file != stdout) fclose(file);
+	return 0;
+}
+
+struct Result
+{
+	const char* scenario_;
+	int rockets_;
+	int frames_;
+	long long steps_;
+	double meanFrame_;				// milliseconds
+	double p50Frame_;
+	double p90Frame_;
+	double p99Frame_;
+	double maxFrame_;
+	double meanSimulation_;			// the simulation steps of a frame
+	double meanSubmission_;			// writing the vertices and drawing them
+	double meanRaster_;				// drawing the frame with the software render backend
+	double particlesPerSecond_;		// particles updated per second of real time
+	int peakAlive_;
+	int peakVertices_;
+	int poolCapacity_;
+	int poolHighWaterMark_;
+	int failedLeases_;
+	int finishedRockets_;			// rockets recycled as soon as their effect was over
+	double bindsPerFrame_;
+	double drawsPerFrame_;
+	double bytesPerFrame_;			// written to the vertex stream
+	int keyframes_;					// snapshots written
+	double meanSnapshot_;			// taking a snapshot and writing it to its file (milliseconds)
+	int snapshotBytes_;				// the largest snapshot
+	double restore_;				// reading the keyframe and restoring the simulation from it
+	double seek_;					// restoring and simulating up to the frame sought
+	ParticleMotion motion_;
+	double motionError_;			// the largest distance between the Euler steps and the closed form (world units)
+};
+
+// the value below which the given fraction of the sorted values lies (nearest rank)
+double percentile(const vector<double>& sorted, double fraction)
+{
+	if (sorted.empty()) return 0;
+	size_t rank = static_cast<size_t>(fraction * sorted.size() + 0.999999);
+	if (rank < 1) rank = 1;
+	if (rank > sorted.size()) rank = sorted.size();
+	return sorted[rank - 1];
+}
+
+// mismatches are the colours that differ from the conversion of D3DXCOLOR
+const ReportColumn colourColumns[] =
+{
+	{"conversion", NULL}, {"colours", "%.0f"}, {"ms", "%.4f"}, {"ns_per_colour", "%.3f"}, {"mismatches", "%.0f"},
+};
+
+typedef void (*PackColours)(const float* r, const float* g, const float* b, const float* a, int count, DWORD* colours);
+
+// the conversion the vertices used to be written with
+void packColoursD3DX(const float* r, const float* g, const float* b, const float* a, int count, DWORD* colours)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		colours[i] = D3DXCOLOR(r[i], g[i], b[i], a[i]);
+	}
+}
+
+// converts random colours (and the values at the limits of the clamping) with every conversion, the time is the
+// fastest of 20 runs
+int benchmarkColours(const Options& options, int count)
+{
+	const int repetitions = 20;
+	const float limits[] = {-1.0f, 0.0f, 1e-30f, 0.5f / 255.0f, 0.5f, 254.5f / 255.0f, 0.99999994f, 1.0f, 1.00000012f, 2.0f};
+	const int LIMITS = sizeof(limits) / sizeof(limits[0]);
+
+	// a quarter of the values lies outside [0, 1], as the colour divergence of the particles may push them there
+	vector<float> channels(4 * static_cast<size_t>(count));
+	RandomEngine random(options.seed_);
+	random.fill(&channels[0], static_cast<int>(channels.size()), -0.25f, 1.25f);
+	for (int c = 0; c < 4; ++c)
+	{
+		for (int i = 0; i < LIMITS && i < count; ++i)
+		{
+			channels[c * static_cast<size_t>(count) + i] = limits[(i + c) % LIMITS];
+		}
+	}
+	const float* r = &channels[0];
+	const float* g = r + count;
+	const float* b = g + count;
+	const float* a = b + count;
+
+	vector<DWORD> reference(count), colours(count);
+	packColoursD3DX(r, g, b, a, count, &reference[0]);
+
+	ReportTable table(colourColumns);
+	const char* names[] = {"d3dx", "scalar", "sse2"};
+	const PackColours conversions[] = {packColoursD3DX, packColoursScalar, packColours};
+	for (int c = 0; c < 3; ++c)
+	{
+		double fastest = 0;
+		for (int i = 0; i < repetitions; ++i)
+		{
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			conversions[c](r, g, b, a, count, &colours[0]);
+			double time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			if (i == 0 || time < fastest) fastest = time;
+		}
+
+		int mismatches = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			if (colours[i] != reference[i]) ++mismatches;
+		}
+
+		table.add(names[c]);
+		table.add(count);
+		table.add(fastest);
+		table.add(1e6 * fastest / count);
+		table.add(mismatches);
+	}
+	return writeReport(options, table);
+}
+
+// max_error is the largest difference to the scalar kernel (relative to the value, at least 1), death_mismatches the
+// particles that died in another step than with the scalar kernel
+const ReportColumn integratorColumns[] =
+{
+	{"kernel", NULL}, {"particles", "%.0f"}, {"steps", "%.0f"}, {"ms", "%.4f"}, {"ns_per_particle_step", "%.3f"},
+	{"particles_per_second", "%.0f"}, {"max_error", "%.3g"}, {"death_mismatches", "%.0f"},
+};
+
+const char* integratorKernelNames[] = {"scalar", "sse2", "avx2"};
+
+// the Euler step of the integrator benchmark, as in the show (2 seconds of particles fading out for the last one)
+const int INTEGRATOR_STEPS = 2 * SIMULATION_STEPS_PER_SECOND;
+const float INTEGRATOR_TIME_INCREMENT = 0.08f;
+const int INTEGRATOR_FADE_OUT = SIMULATION_STEPS_PER_SECOND;
+
+// random particles flying in all directions, dying at random steps up to twice as long as the benchmark runs
+void randomParticles(ParticleStore& particles, int count, unsigned int seed)
+{
+	RandomEngine random(seed);
+	particles.allocate(count);
+	for (int i = 0; i < count; ++i)
+	{
+		particles.clear(i);
+		particles.setPosition(i, D3DXVECTOR3(random.uniform(-300, 300), random.uniform(-300, 300), random.uniform(-300, 300)));
+		particles.setVelocity(i, D3DXVECTOR3(random.uniform(-80, 80), random.uniform(-80, 80), random.uniform(-80, 80)));
+		particles.resetAcceleration(i);
+		particles.setColour(i, D3DXCOLOR(1, 1, 1, 1));
+		particles.lifetime_[i] = random.number(1, 2 * INTEGRATOR_STEPS);
+	}
+}
+
+// Steps the particles [begin, end) of 'initial' with the given kernel, leaving the state after the last step in
+// 'particles' and the step every particle died in in 'deaths' (0 if it is still alive). Returns the milliseconds taken.
+double stepWithKernel(IntegratorKernel kernel, const ParticleStore& initial, ParticleStore& particles, int begin, int end, vector<int>& deaths)
+{
+	particles.allocate(initial.capacity());
+	particles.copy(initial, 0, initial.capacity());
+	deaths.assign(initial.capacity(), 0);
+	vector<int> died(max(end - begin, 1));
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int step = 1; step <= INTEGRATOR_STEPS; ++step)
+	{
+		int count = integrateParticlesWith(kernel, particles, begin, end, INTEGRATOR_TIME_INCREMENT, INTEGRATOR_FADE_OUT, &died[0]);
+		for (int i = 0; i < count; ++i)
+		{
+			deaths[died[i]] = step;
+		}
+	}
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// The largest difference of the attributes the Euler step changes, relative to the value of the reference (at least 1).
+// The previous position of dead particles is not compared, it is never drawn (the vectorised kernels set it to the
+// position, the scalar one leaves it as it was).
+double kernelError(const ParticleStore& reference, const ParticleStore& particles, int count)
+{
+	const float* const referenceArrays[] = {reference.positionX_, reference.positionY_, reference.positionZ_,
+											reference.previousX_, reference.previousY_, reference.previousZ_,
+											reference.velocityX_, reference.velocityY_, reference.velocityZ_,
+											reference.accelerationX_, reference.accelerationY_, reference.accelerationZ_,
+											reference.colourA_, reference.time_};
+	const float* const arrays[] = {particles.positionX_, particles.positionY_, particles.positionZ_,
+								   particles.previousX_, particles.previousY_, particles.previousZ_,
+								   particles.velocityX_, particles.velocityY_, particles.velocityZ_,
+								   particles.accelerationX_, particles.accelerationY_, particles.accelerationZ_,
+								   particles.colourA_, particles.time_};
+
+	double error = 0;
+	for (size_t a = 0; a < sizeof(arrays) / sizeof(arrays[0]); ++a)
+	{
+		bool previous = a >= 3 && a < 6;
+		for (int i = 0; i < count; ++i)
+		{
+			if (previous && reference.lifetime_[i] == 0) continue;
+
+			double difference = fabs(static_cast<double>(arrays[a][i]) - referenceArrays[a][i]);
+			error = max(error, difference / max(1.0, fabs(static_cast<double>(referenceArrays[a][i]))));
+		}
+	}
+	return error;
+}
+
+// Steps the particles [begin, count) with every kernel the CPU supports and compares the results with the ones of the
+// scalar kernel, a row per kernel. The time is the fastest of 'repetitions' runs on the calling thread alone.
+void compareIntegrators(int count, int begin, int repetitions, unsigned int seed, ReportTable& table)
+{
+	ParticleStore initial, reference, particles;
+	randomParticles(initial, count, seed);
+
+	vector<int> referenceDeaths, deaths;
+	stepWithKernel(ScalarIntegrator, initial, reference, begin, count, referenceDeaths);
+
+	for (int k = ScalarIntegrator; k <= widestIntegratorKernel(); ++k)
+	{
+		IntegratorKernel kernel = static_cast<IntegratorKernel>(k);
+
+		double fastest = 0;
+		for (int i = 0; i < repetitions; ++i)
+		{
+			double time = stepWithKernel(kernel, initial, particles, begin, count, deaths);
+			if (i == 0 || time < fastest) fastest = time;
+		}
+
+		int deathMismatches = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			if (deaths[i] != referenceDeaths[i] || particles.lifetime_[i] != reference.lifetime_[i]) ++deathMismatches;
+		}
+
+		double particleSteps = static_cast<double>(count - begin) * INTEGRATOR_STEPS;
+		table.add(integratorKernelNames[k]);
+		table.add(count - begin);
+		table.add(INTEGRATOR_STEPS);
+		table.add(fastest);
+		table.add(1e6 * fastest / particleSteps);
+		table.add(1e3 * particleSteps / fastest);
+		table.add(kernelError(reference, particles, count));
+		table.add(deathMismatches);
+	}
+}
+
+int benchmarkIntegrators(const Options& options, int count)
+{
+	ReportTable table(integratorColumns);
+	compareIntegrators(count, 0, 5, options.seed_, table);
+	return writeReport(options, table);
+}
+
+const ReportColumn layoutColumns[] =
+{
+	{"layout", NULL}, {"particles", "%.0f"}, {"frames", "%.0f"}, {"ms", "%.4f"}, {"ns_per_particle_frame", "%.3f"},
+};
+
+// a particle as it was stored before the ParticleStore (one record per particle in a std::vector)
+struct LegacyParticle
+{
+	int			id_;
+	int			lifetime_;
+	D3DXVECTOR3 position_;
+	D3DXVECTOR3 origin_;
+	D3DXVECTOR3 velocity_;
+	D3DXCOLOR	colour_;
+	D3DXVECTOR3	acceleration_;
+	float		time_;
+	float		size_;
+};
+
+// the rays of the show: 300 main particles, each one followed by a trail of 30 sub particles that shrink
+const int LAYOUT_FRAMES = 120;
+const int LAYOUT_TRAIL = 31;
+const float LAYOUT_TIME_INCREMENT = 0.08f;
+const int LAYOUT_FADE_OUT = 80;
+const int LAYOUT_SUB_LIFETIME = 30;
+
+// the particles of the benchmark, all of them living through all frames (main particles are every 31st one)
+void layoutParticles(ParticleStore& particles, int count, unsigned int seed)
+{
+	RandomEngine random(seed);
+	particles.allocate(count);
+	for (int i = 0; i < count; ++i)
+	{
+		particles.clear(i);
+		particles.id_[i] = i % LAYOUT_TRAIL == 0 ? 0 : 1;
+		particles.setPosition(i, D3DXVECTOR3(random.uniform(-300, 300), random.uniform(-300, 300), random.uniform(-300, 300)));
+		particles.setVelocity(i, D3DXVECTOR3(random.uniform(-70, 70), random.uniform(-70, 70), random.uniform(-70, 70)));
+		particles.resetAcceleration(i);
+		particles.setColour(i, D3DXCOLOR(1, random.uniform(0.5f, 1), random.uniform(0.5f, 1), 1));
+		particles.size_[i] = random.uniform(15, 20);
+		particles.lifetime_[i] = LAYOUT_FRAMES + random.number(1, LAYOUT_FRAMES);
+	}
+}
+
+// The update of the rays as it was: the Euler step, the fade out and the shrinking of the sub particles for every
+// living particle, then the vertices of all living particles, both walking through the whole records.
+void stepLegacyRays(vector<LegacyParticle>& particles, POINTVERTEX* points)
+{
+	for (vector<LegacyParticle>::iterator p(particles.begin()); p != particles.end(); ++p)
+	{
+		if (p -> lifetime_ > 0)
+		{
+			p -> position_.y += p -> velocity_.y * LAYOUT_TIME_INCREMENT;
+			p -> position_.x += p -> velocity_.x * LAYOUT_TIME_INCREMENT;
+			p -> position_.z += p -> velocity_.z * LAYOUT_TIME_INCREMENT;
+
+			p -> velocity_.x += p -> acceleration_.x * LAYOUT_TIME_INCREMENT;
+			p -> velocity_.y += p -> acceleration_.y * LAYOUT_TIME_INCREMENT;
+			p -> velocity_.z += p -> acceleration_.z * LAYOUT_TIME_INCREMENT;
+
+			p -> acceleration_.x = AIR_DRAG * p -> velocity_.x;
+			p -> acceleration_.y = AIR_DRAG * p -> velocity_.y + EARTH_GRAVITY;
+			p -> acceleration_.z = AIR_DRAG * p -> velocity_.z;
+
+			p -> time_ += LAYOUT_TIME_INCREMENT;
+			--(p -> lifetime_);
+
+			if (p -> lifetime_ < LAYOUT_FADE_OUT) p -> colour_.a -= static_cast<float>(1) / LAYOUT_FADE_OUT;
+			if (p -> id_ == 1) p -> size_ -= static_cast<float>(1) / LAYOUT_SUB_LIFETIME;
+		}
+	}
+
+	int P = 0;
+	for (vector<LegacyParticle>::iterator p(particles.begin()); p != particles.end(); ++p)
+	{
+		if (p -> lifetime_ > 0)
+		{
+			points[P].position_ = p -> position_;
+			points[P].size_ = p -> size_;
+			points[P].color_ = p -> colour_;
+			++P;
+		}
+	}
+}
+
+// the same update on the arrays of the store, with the given Euler step and colour conversion
+void stepStoreRays(ParticleStore& particles, int count, POINTVERTEX* points, bool vectorised, int* died, DWORD* colours)
+{
+	if (vectorised) integrateParticles(particles, 0, count, LAYOUT_TIME_INCREMENT, LAYOUT_FADE_OUT, died);
+	else integrateParticlesScalar(particles, 0, count, LAYOUT_TIME_INCREMENT, LAYOUT_FADE_OUT, died);
+
+	const float shrink = static_cast<float>(1) / LAYOUT_SUB_LIFETIME;
+	for (int i = 0; i < count; ++i)
+	{
+		if (particles.id_[i] == 1) particles.size_[i] -= shrink;
+	}
+
+	if (vectorised) packColours(particles.colourR_, particles.colourG_, particles.colourB_, particles.colourA_, count, colours);
+	else packColoursScalar(particles.colourR_, particles.colourG_, particles.colourB_, particles.colourA_, count, colours);
+
+	for (int i = 0; i < count; ++i)
+	{
+		points[i].position_ = D3DXVECTOR3(particles.positionX_[i], particles.positionY_[i], particles.positionZ_[i]);
+		points[i].size_ = particles.size_[i];
+		points[i].color_ = colours[i];
+	}
+}
+
+// Runs the update of 'count' particles of the rays for a number of frames, with the records the particles used to be
+// stored in and with the store (without and with the vectorised loops). The time is the fastest of 5 runs.
+int benchmarkLayouts(const Options& options, int count)
+{
+	const int repetitions = 5;
+
+	ParticleStore initial, particles;
+	layoutParticles(initial, count, options.seed_);
+
+	vector<LegacyParticle> legacyInitial(count);
+	for (int i = 0; i < count; ++i)
+	{
+		LegacyParticle& p = legacyInitial[i];
+		p.id_ = initial.id_[i];
+		p.lifetime_ = initial.lifetime_[i];
+		p.position_ = initial.getPosition(i);
+		p.origin_ = initial.getOrigin(i);
+		p.velocity_ = initial.getVelocity(i);
+		p.colour_ = initial.getColour(i);
+		p.acceleration_ = D3DXVECTOR3(initial.accelerationX_[i], initial.accelerationY_[i], initial.accelerationZ_[i]);
+		p.time_ = initial.time_[i];
+		p.size_ = initial.size_[i];
+	}
+
+	vector<POINTVERTEX> points(count);
+	vector<int> died(count);
+	vector<DWORD> colours(count);
+
+	ReportTable table(layoutColumns);
+	const char* names[] = {"aos", "soa-scalar", "soa-simd"};
+	for (int layout = 0; layout < 3; ++layout)
+	{
+		double fastest = 0;
+		for (int r = 0; r < repetitions; ++r)
+		{
+			vector<LegacyParticle> legacy(legacyInitial);
+			particles.allocate(count);
+			particles.copy(initial, 0, count);
+
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			for (int frame = 0; frame < LAYOUT_FRAMES; ++frame)
+			{
+				if (layout == 0) stepLegacyRays(legacy, &points[0]);
+				else stepStoreRays(particles, count, &points[0], layout == 2, &died[0], &colours[0]);
+			}
+			double time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			if (r == 0 || time < fastest) fastest = time;
+		}
+
+		table.add(names[layout]);
+		table.add(count);
+		table.add(LAYOUT_FRAMES);
+		table.add(fastest);
+		table.add(1e6 * fastest / (static_cast<double>(count) * LAYOUT_FRAMES));
+	}
+	return writeReport(options, table);
+}
+
+// mean_length is the length of the mean direction (0 if they are spread evenly), polar_share the share of the directions
+// with |y| > 0.9 (0.1 if they are spread evenly)
+const ReportColumn directionColumns[] =
+{
+	{"method", NULL}, {"bursts", "%.0f"}, {"ms", "%.4f"}, {"us_per_burst", "%.3f"}, {"ns_per_direction", "%.3f"},
+	{"mean_length", "%.5f"}, {"polar_share", "%.4f"},
+};
+
+const int DIRECTION_BURST = 2000;
+
+// The directions of a burst as they were picked before sphereDirections: two angles of rand() degrees, which spreads
+// the polar angle evenly instead of the height and so crowds the directions around the poles.
+void angleDirections(float* x, float* y, float* z, int n)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		float angleH = D3DXToRadian(static_cast<float>(rand()));
+		float angleV = D3DXToRadian(static_cast<float>(rand()));
+
+		x[i] = sin(angleV) * cos(angleH);
+		y[i] = cos(angleV);
+		z[i] = sin(angleV) * sin(angleH);
+	}
+}
+
+// Times 'bursts' bursts of 2,000 directions (the size of the bursts of the show) picked the old way and by
+// sphereDirections and measures how evenly both spread them. The time is the fastest of 5 runs.
+int benchmarkDirections(const Options& options, int bursts)
+{
+	const int repetitions = 5;
+	const int count = bursts * DIRECTION_BURST;
+
+	vector<float> x(count), y(count), z(count);
+	RandomEngine random;
+	unsigned int seed = options.seed_;
+
+	ReportTable table(directionColumns);
+	const char* names[] = {"angles", "sphere"};
+	for (int method = 0; method < 2; ++method)
+	{
+		double fastest = 0;
+		for (int r = 0; r < repetitions; ++r)
+		{
+			srand(seed);
+			random.seed(seed);
+
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			for (int b = 0; b < bursts; ++b)
+			{
+				int first = b * DIRECTION_BURST;
+				if (method == 0) angleDirections(&x[first], &y[first], &z[first], DIRECTION_BURST);
+				else sphereDirections(random, &x[first], &y[first], &z[first], DIRECTION_BURST);
+			}
+			double time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			if (r == 0 || time < fastest) fastest = time;
+		}
+
+		double sumX = 0, sumY = 0, sumZ = 0;
+		int polar = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			sumX += x[i];
+			sumY += y[i];
+			sumZ += z[i];
+			if (fabs(y[i]) > 0.9f) ++polar;
+		}
+
+		table.add(names[method]);
+		table.add(bursts);
+		table.add(fastest);
+		table.add(1e3 * fastest / bursts);
+		table.add(1e6 * fastest / count);
+		table.add(sqrt(sumX * sumX + sumY * sumY + sumZ * sumZ) / count);
+		table.add(static_cast<double>(polar) / count);
+	}
+	return writeReport(options, table);
+}
+
+// schedule_ms is the time for scheduling all events, fire_ms for advancing step by step until all have been fired
+const ReportColumn schedulerColumns[] =
+{
+	{"queue", NULL}, {"events", "%.0f"}, {"schedule_ms", "%.4f"}, {"fire_ms", "%.4f"}, {"ns_per_schedule", "%.3f"},
+	{"ns_per_fire", "%.3f"}, {"fired", "%.0f"},
+};
+
+void addSchedulerRow(ReportTable& table, const char* queue, int count, double schedule, double fire, int fired)
+{
+	table.add(queue);
+	table.add(count);
+	table.add(schedule);
+	table.add(fire);
+	table.add(1e6 * schedule / count);
+	table.add(1e6 * fire / count);
+	table.add(fired);
+}
+
+// the events of the scheduler benchmark are spread over 10 minutes of simulated time
+const long long SCHEDULER_SPAN = 600 * SCHEDULER_TICKS_PER_SECOND;
+
+// an event of the binary heap the timing wheel is compared with (ordered as the scheduler orders them)
+struct HeapEvent
+{
+	long long tick_;
+	unsigned long long sequence_;
+	RocketCommand command_;
+
+	bool operator<(const HeapEvent& e) const {return tick_ != e.tick_ ? tick_ > e.tick_ : sequence_ > e.sequence_;}
+};
+
+// Schedules 'count' events at random ticks, then advances the time a simulation step at a time (as the application
+// does) until all of them have been fired. Both with the timing wheel of the scheduler and with a binary heap.
+int benchmarkScheduler(const Options& options, int count)
+{
+	RandomEngine random(options.seed_);
+	vector<long long> ticks(count);
+	for (int i = 0; i < count; ++i)
+	{
+		ticks[i] = static_cast<long long>(random.next()) * SCHEDULER_SPAN >> 32;
+	}
+
+	const long long stepTicks = SCHEDULER_TICKS_PER_SECOND / SIMULATION_STEPS_PER_SECOND;
+	const long long steps = SCHEDULER_SPAN / stepTicks + 2;
+	int fired = 0;
+
+	ReportTable table(schedulerColumns);
+
+	// the timing wheel
+	{
+		LaunchScheduler scheduler;
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int i = 0; i < count; ++i)
+		{
+			RocketCommand command = {FireRocket, i};
+			scheduler.schedule(ticks[i], command);
+		}
+		chrono::steady_clock::time_point scheduled = chrono::steady_clock::now();
+
+		fired = 0;
+		for (long long step = 0; step < steps; ++step)
+		{
+			scheduler.advance(step * stepTicks, [&fired](const RocketCommand& command, long long tick) {++fired;});
+		}
+		chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+		addSchedulerRow(table, "wheel", count, chrono::duration<double, milli>(scheduled - start).count(),
+						chrono::duration<double, milli>(end - scheduled).count(), fired);
+	}
+
+	// the binary heap
+	{
+		vector<HeapEvent> heap;
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int i = 0; i < count; ++i)
+		{
+			HeapEvent event = {ticks[i], static_cast<unsigned long long>(i), {FireRocket, i}};
+			heap.push_back(event);
+			push_heap(heap.begin(), heap.end());
+		}
+		chrono::steady_clock::time_point scheduled = chrono::steady_clock::now();
+
+		fired = 0;
+		for (long long step = 0; step < steps; ++step)
+		{
+			while (!heap.empty() && heap.front().tick_ <= step * stepTicks)
+			{
+				pop_heap(heap.begin(), heap.end());
+				heap.pop_back();
+				++fired;
+			}
+		}
+		chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+		addSchedulerRow(table, "heap", count, chrono::duration<double, milli>(scheduled - start).count(),
+						chrono::duration<double, milli>(end - scheduled).count(), fired);
+	}
+
+	return writeReport(options, table);
+}
+
+// The largest distance between the Euler steps and the closed form over the lifetime of the particles of the effects
+// that can be evaluated in closed form. The fastest particle of every effect is sent up, down and sideways.
+double motionError(const ShowDescription& description)
+{
+	const D3DXVECTOR3 directions[4] = {D3DXVECTOR3(0, 1, 0), D3DXVECTOR3(0, -1, 0), D3DXVECTOR3(1, 0, 0), D3DXVECTOR3(0.6f, 0.8f, 0)};
+	ParticleStore euler, exact;
+	euler.allocate(PARTICLE_STORE_PADDING);
+	exact.allocate(PARTICLE_STORE_PADDING);
+
+	double error = 0;
+	for (int i = 0; i < description.systemCount(); ++i)
+	{
+		const SystemRecord& record = description.system(i);
+		if (record.type_ != SphereSystem && record.type_ != StarSystem && record.type_ != ConeSystem) continue;
+
+		float speed = record.launchVelocity_ + record.maxVelocityDivergence_;
+		int steps = secondsToSteps(record.maxLifetime_);
+		for (int d = 0; d < 4; ++d)
+		{
+			ParticleStore* stores[2] = {&euler, &exact};
+			for (int s = 0; s < 2; ++s)
+			{
+				stores[s] -> clear(d);
+				stores[s] -> setPosition(d, D3DXVECTOR3(0, 0, 0));
+				stores[s] -> setOrigin(d, D3DXVECTOR3(0, 0, 0));
+				stores[s] -> setVelocity(d, speed * directions[d]);
+				stores[s] -> resetAcceleration(d);
+				stores[s] -> lifetime_[d] = steps;
+			}
+		}
+
+		int died[4];
+		for (int step = 0; step < steps; ++step)
+		{
+			integrateParticlesScalar(euler, 0, 4, record.timeIncrement_, 0, died);
+			evaluateParticlesScalar(exact, 0, 4, record.timeIncrement_, 0, died);
+
+			for (int d = 0; d < 4; ++d)
+			{
+				D3DXVECTOR3 difference = euler.getPosition(d) - exact.getPosition(d);
+				error = max(error, static_cast<double>(D3DXVec3Length(&difference)));
+			}
+		}
+	}
+	return error;
+}
+
+// the name given by a file pattern (like key%06d.snap) for a number (a simulation step or a frame)
+string numberedFile(const char* pattern, long long number)
+{
+	int length = snprintf(NULL, 0, pattern, static_cast<int>(number));
+	vector<char> file(max(length, 0) + 1);
+	snprintf(&file[0], file.size(), pattern, static_cast<int>(number));
+	return string(&file[0]);
+}
+
+// the state of a run in the order it is saved and restored (the pool before the systems holding its leases)
+void saveRun(Snapshot& snapshot, int frame, const SimulationClock& clock, const LaunchScheduler& scheduler, ParticlePool& pool, const Show& show)
+{
+	snapshot.clear();
+	snapshot.write(frame);
+	clock.saveState(snapshot);
+	scheduler.saveState(snapshot);
+	pool.saveState(snapshot);
+	show.saveState(snapshot);
+}
+
+bool restoreRun(Snapshot& snapshot, int* frame, SimulationClock& clock, LaunchScheduler& scheduler, ParticlePool& pool, Show& show)
+{
+	snapshot.rewind();
+	snapshot.read(frame);
+	clock.restoreState(snapshot);
+	scheduler.restoreState(snapshot);
+	pool.restoreState(snapshot);
+	show.restoreState(snapshot);
+	return snapshot.valid();
+}
+
+// loads the show of a scenario and runs it for the given number of frames
+// the parts of a running scenario, for the frame observer
+struct Run
+{
+	Show& show_;
+	VertexRing& vertexRing_;
+	RecordingRenderBackend& renderBackend_;
+	NullRenderBackend& nullBackend_;
+	SimulationClock& clock_;
+	LaunchScheduler& scheduler_;
+	ParticlePool& pool_;
+};
+
+// lets the checks look at every frame of a run and change the simulation between two frames
+class FrameObserver
+{
+public:
+	virtual ~FrameObserver(void) {}
+
+	virtual void beforeFrame(int frame, Run& run) {}		// before the simulation steps of the frame
+	virtual void afterFrame(int frame, Run& run) {}		// after the frame has been drawn
+};
+
+bool runScenario(const Scenario& scenario, const Options& options, Result* result, FrameObserver* observer = NULL)
+{
+	ShowDescription description;
+	if (FAILED(description.loadText(options.show_)))
+	{
+		fprintf(stderr, "%s\n", description.error());
+		return false;
+	}
+
+	vector<RocketRecord> rockets;
+	for (int i = 0; i < description.rocketCount(); ++i)
+	{
+		rockets.push_back(description.rocket(i));
+	}
+	scenario.prepare_(rockets);
+	if (FAILED(description.setRockets(rockets.empty() ? NULL : &rockets[0], static_cast<int>(rockets.size()))))
+	{
+		fprintf(stderr, "%s: %s\n", scenario.name_, description.error());
+		return false;
+	}
+
+	JobSystem jobSystem;
+	NullRenderBackend nullBackend;
+	SoftwareRenderBackend softwareBackend(options.width_, options.height_, &jobSystem);
+	RecordingRenderBackend renderBackend(options.software_ ? static_cast<RenderBackend*>(&softwareBackend) : &nullBackend);
+
+	// the null render backend has nothing to draw, so it loads no textures either
+	vector<RenderTexture> textures;
+	for (int i = 0; i < description.textureCount(); ++i)
+	{
+		textures.push_back(renderBackend.loadTexture(description.texture(i).file_));
+		if (options.software_ && textures.back() == NULL)
+		{
+			fprintf(stderr, "%s: cannot be loaded\n", description.texture(i).file_);
+		}
+	}
+
+	Show show;
+	if (FAILED(show.build(description, textures))) return false;
+	show.setMotion(options.motion_);
+
+	ParticlePool particlePool;
+	VertexRing vertexRing;
+	SimulationClock simulationClock;
+	LaunchScheduler launchScheduler;
+
+	particlePool.initialise(options.budget_ > 0 ? options.budget_ : scenario.budget_);
+	vertexRing.initialise(&renderBackend, particlePool.capacity());
+	show.initialise(&renderBackend, &vertexRing, &particlePool, &jobSystem);
+	show.seedRandom(options.seed_);
+
+	jobSystem.start(options.workers_);
+	show.schedule(launchScheduler, 0);
+
+	Run run = {show, vertexRing, renderBackend, nullBackend, simulationClock, launchScheduler, particlePool};
+
+	// seeking starts from the last keyframe before the step sought (or from the start of the show if there is none)
+	Snapshot snapshot;
+	long long keyframeSteps = max(1, secondsToSteps(options.keyframeEvery_));
+	long long seekStep = options.seek_ > 0 ? static_cast<long long>(options.seek_ * SIMULATION_STEPS_PER_SECOND + 0.5) : 0;
+	int firstFrame = 0;
+	double restore = 0;
+
+	chrono::steady_clock::time_point seekStart = chrono::steady_clock::now();
+	for (long long step = seekStep / keyframeSteps * keyframeSteps; options.keyframes_ && step > 0; step -= keyframeSteps)
+	{
+		string file = numberedFile(options.keyframes_, step);
+		if (FAILED(snapshot.load(file.c_str()))) continue;
+
+		if (!restoreRun(snapshot, &firstFrame, simulationClock, launchScheduler, particlePool, show))
+		{
+			fprintf(stderr, "%s: the snapshot does not belong to this show\n", file.c_str());
+			jobSystem.stop();
+			return false;
+		}
+		restore = chrono::duration<double, milli>(chrono::steady_clock::now() - seekStart).count();
+		break;
+	}
+
+	vector<double> frameTimes;
+	frameTimes.reserve(options.frames_);
+	double particleSteps = 0, simulation = 0, submission = 0, raster = 0, snapshotTime = 0, seek = 0;
+	bool imagesWritten = true, keyframesWritten = true, sought = seekStep == 0;
+	int peakAlive = 0, peakVertices = 0, keyframes = 0, snapshotBytes = 0, finishedRockets = 0;
+	long long nextKeyframe = (simulationClock.steps() / keyframeSteps + 1) * keyframeSteps;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int frame = firstFrame; frame < options.frames_; ++frame)
+	{
+		// the frames up to the step sought are simulated as fast as possible and not reported
+		bool seeking = simulationClock.steps() < seekStep;
+		if (!seeking && !sought)
+		{
+			sought = true;
+			seek = chrono::duration<double, milli>(chrono::steady_clock::now() - seekStart).count();
+			start = chrono::steady_clock::now();
+		}
+
+		// keyframes are taken between two frames (and are not part of them)
+		if (options.keyframes_ && seekStep == 0 && simulationClock.steps() >= nextKeyframe)
+		{
+			chrono::steady_clock::time_point snapshotStart = chrono::steady_clock::now();
+
+			string file = numberedFile(options.keyframes_, nextKeyframe);
+			saveRun(snapshot, frame, simulationClock, launchScheduler, particlePool, show);
+			if (FAILED(snapshot.save(file.c_str())))
+			{
+				fprintf(stderr, "%s\n", snapshot.error());
+				keyframesWritten = false;
+				break;
+			}
+
+			snapshotTime += chrono::duration<double, milli>(chrono::steady_clock::now() - snapshotStart).count();
+			snapshotBytes = max(snapshotBytes, static_cast<int>(snapshot.size()));
+			++keyframes;
+			nextKeyframe = (simulationClock.steps() / keyframeSteps + 1) * keyframeSteps;
+		}
+
+		if (observer && !seeking) observer -> beforeFrame(frame, run);
+
+		chrono::steady_clock::time_point frameStart = chrono::steady_clock::now();
+
+		// the same steps as a frame of the application, without rendering
+		int steps = simulationClock.advance(1.0f / options.fps_);
+		long long firstStep = simulationClock.steps() - steps;
+		vertexRing.beginFrame();
+		for (int step = 0; step < steps; ++step)
+		{
+			launchScheduler.advance((firstStep + step) * SCHEDULER_TICKS_PER_SECOND / SIMULATION_STEPS_PER_SECOND,
+									[&](const RocketCommand& command, long long tick) {show.execute(command, tick, launchScheduler);});
+			if (step + 1 < steps) show.update();
+			else show.updateAndEmit(simulationClock.alpha());
+
+			if (seeking) continue;
+			finishedRockets += static_cast<int>(show.finishedRockets().size());
+			int alive = show.particlesAlive();
+			particleSteps += alive;
+			peakAlive = max(peakAlive, alive);
+		}
+		chrono::steady_clock::time_point submissionStart = chrono::steady_clock::now();
+
+		// the vertices are written while seeking as well, just as the effects write theirs while they are stepped
+		show.emitVertices(simulationClock.alpha());
+		vertexRing.endFrame();
+		if (seeking) continue;
+
+		peakVertices = max(peakVertices, vertexRing.frameVertices());
+		show.render();
+		chrono::steady_clock::time_point rasterStart = chrono::steady_clock::now();
+
+		if (options.software_) softwareBackend.rasterise();
+
+		chrono::steady_clock::time_point frameEnd = chrono::steady_clock::now();
+		simulation += chrono::duration<double, milli>(submissionStart - frameStart).count();
+		submission += chrono::duration<double, milli>(rasterStart - submissionStart).count();
+		raster += chrono::duration<double, milli>(frameEnd - rasterStart).count();
+		frameTimes.push_back(chrono::duration<double, milli>(frameEnd - frameStart).count());
+
+		if (observer) observer -> afterFrame(frame, run);
+
+		// writing the images is not part of the frame
+		if (options.software_ && options.images_ && frame % options.imageEvery_ == 0)
+		{
+			string file = numberedFile(options.images_, frame);
+			if (FAILED(softwareBackend.image().savePng(file.c_str())))
+			{
+				fprintf(stderr, "%s\n", softwareBackend.image().error());
+				imagesWritten = false;
+				break;
+			}
+		}
+	}
+	double total = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	jobSystem.stop();
+
+	int rocketCount = show.rocketCount();
+	show.clear();
+	vertexRing.release();
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		renderBackend.releaseTexture(textures[i]);
+	}
+	if (!imagesWritten || !keyframesWritten) return false;
+
+	vector<double> sorted(frameTimes);
+	sort(sorted.begin(), sorted.end());
+	double sum = 0;
+	for (size_t i = 0; i < sorted.size(); ++i)
+	{
+		sum += sorted[i];
+	}
+
+	result->scenario_ = scenario.name_;
+	result->rockets_ = rocketCount;
+	result->frames_ = static_cast<int>(frameTimes.size());
+	result->steps_ = simulationClock.steps();
+	result->meanFrame_ = sorted.empty() ? 0 : sum / sorted.size();
+	result->p50Frame_ = percentile(sorted, 0.5);
+	result->p90Frame_ = percentile(sorted, 0.9);
+	result->p99Frame_ = percentile(sorted, 0.99);
+	result->maxFrame_ = sorted.empty() ? 0 : sorted.back();
+	result->meanSimulation_ = sorted.empty() ? 0 : simulation / sorted.size();
+	result->meanSubmission_ = sorted.empty() ? 0 : submission / sorted.size();
+	result->meanRaster_ = sorted.empty() ? 0 : raster / sorted.size();
+	result->particlesPerSecond_ = total > 0 ? particleSteps / total : 0;
+	result->peakAlive_ = peakAlive;
+	result->peakVertices_ = peakVertices;
+	result->poolCapacity_ = particlePool.capacity();
+	result->poolHighWaterMark_ = particlePool.highWaterMark();
+	result->failedLeases_ = particlePool.failedLeases();
+	result->finishedRockets_ = finishedRockets;
+	result->bindsPerFrame_ = sorted.empty() ? 0 : static_cast<double>(renderBackend.statistics().binds_) / sorted.size();
+	result->drawsPerFrame_ = sorted.empty() ? 0 : static_cast<double>(renderBackend.statistics().draws_) / sorted.size();
+	result->bytesPerFrame_ = sorted.empty() ? 0 : static_cast<double>(renderBackend.statistics().bytesUploaded_) / sorted.size();
+	result->keyframes_ = keyframes;
+	result->meanSnapshot_ = keyframes ? snapshotTime / keyframes : 0;
+	result->snapshotBytes_ = snapshotBytes;
+	result->restore_ = restore;
+	result->seek_ = seek;
+	result->motion_ = options.motion_;
+	result->motionError_ = motionError(description);
+	return true;
+}
+
+const ReportColumn scenarioColumns[] =
+{
+	{"scenario", NULL}, {"rockets", "%.0f"}, {"frames", "%.0f"}, {"steps", "%.0f"},
+	{"mean_ms", "%.4f"}, {"p50_ms", "%.4f"}, {"p90_ms", "%.4f"}, {"p99_ms", "%.4f"}, {"max_ms", "%.4f"},
+	{"simulation_ms", "%.4f"}, {"submission_ms", "%.4f"}, {"raster_ms", "%.4f"}, {"particles_per_second", "%.0f"},
+	{"peak_alive", "%.0f"}, {"peak_vertices", "%.0f"},
+	{"pool_capacity", "%.0f"}, {"pool_high_water_mark", "%.0f"}, {"failed_leases", "%.0f"}, {"finished_rockets", "%.0f"},
+	{"binds_per_frame", "%.1f"}, {"draws_per_frame", "%.1f"}, {"bytes_per_frame", "%.0f"},
+	{"keyframes", "%.0f"}, {"snapshot_ms", "%.4f"}, {"snapshot_bytes", "%.0f"}, {"restore_ms", "%.4f"}, {"seek_ms", "%.4f"},
+	{"motion", NULL}, {"motion_error", "%.4f"},
+};
+
+void addScenarioRow(ReportTable& table, const Result& r)
+{
+	table.add(r.scenario_);
+	table.add(r.rockets_);
+	table.add(r.frames_);
+	table.add(static_cast<double>(r.steps_));
+	table.add(r.meanFrame_);
+	table.add(r.p50Frame_);
+	table.add(r.p90Frame_);
+	table.add(r.p99Frame_);
+	table.add(r.maxFrame_);
+	table.add(r.meanSimulation_);
+	table.add(r.meanSubmission_);
+	table.add(r.meanRaster_);
+	table.add(r.particlesPerSecond_);
+	table.add(r.peakAlive_);
+	table.add(r.peakVertices_);
+	table.add(r.poolCapacity_);
+	table.add(r.poolHighWaterMark_);
+	table.add(r.failedLeases_);
+	table.add(r.finishedRockets_);
+	table.add(r.bindsPerFrame_);
+	table.add(r.drawsPerFrame_);
+	table.add(r.bytesPerFrame_);
+	table.add(r.keyframes_);
+	table.add(r.meanSnapshot_);
+	table.add(r.snapshotBytes_);
+	table.add(r.restore_);
+	table.add(r.seek_);
+	table.add(r.motion_ == ExactMotion ? "exact" : "euler");
+	table.add(r.motionError_);
+}
+
+int usage(void);
+
+//-----------------------------------------------------------------------------
+// checks, each one tells whether the simulation still behaves as it should (what is wrong is written to stderr)
+
+// the vectorised kernels give the results of the scalar one, for a range starting and ending between two vectors
+bool checkIntegrators(const Options& options)
+{
+	const double tolerance = 1e-5;
+
+	ReportTable table(integratorColumns);
+	compareIntegrators(10003, 3, 1, options.seed_, table);
+
+	bool passed = true;
+	for (int k = 1; k < table.rows(); ++k)
+	{
+		double error = table.number(k, "max_error");
+		int mismatches = static_cast<int>(table.number(k, "death_mismatches"));
+		if (error > tolerance || mismatches != 0)
+		{
+			fprintf(stderr, "integrator: %s differs from scalar by %g, %d particles died in another step\n", integratorKernelNames[k], error, mismatches);
+			passed = false;
+		}
+	}
+	return passed;
+}
+
+// Follows the calls of the vertex ring and the draws of every frame: the stream is locked at most once per frame, with
+// DISCARD only when the ring starts over at its beginning and otherwise with NOOVERWRITE for a range nothing drawn since
+// the last DISCARD lies in. Every vertex written in a frame is drawn exactly once, by one draw per particle system
+// (except in frames a rocket finished in: its effect wrote the points of its last particles in the step they died in,
+// but a finished rocket isn't drawn any more).
+class RingObserver : public FrameObserver
+{
+public:
+	RingObserver(void) : drawnEnd_(0), discards_(0), noOverwrites_(0), failures_(0) {}
+
+	virtual void beforeFrame(int frame, Run& run)
+	{
+		calls_.clear();
+		run.renderBackend_.recordCalls(&calls_);
+	}
+
+	virtual void afterFrame(int frame, Run& run)
+	{
+		run.renderBackend_.recordCalls(NULL);
+
+		const RenderCall* lock = NULL;
+		int locks = 0, written = 0;
+		vector<RenderCall> draws;
+		for (size_t i = 0; i < calls_.size(); ++i)
+		{
+			const RenderCall& call = calls_[i];
+			if (call.type_ == LockCall) {lock = &call; ++locks;}
+			else if (call.type_ == UnlockCall) written = call.count_;
+			else draws.push_back(call);
+		}
+
+		if (locks > 1) fail(frame, "the stream was locked %d times", locks);
+		if (lock == NULL)
+		{
+			if (!draws.empty()) fail(frame, "%d draws without a lock", static_cast<int>(draws.size()));
+			return;
+		}
+
+		// DISCARD (and nothing else) starts over at the beginning, NOOVERWRITE stays behind everything drawn
+		if (lock->discard_)
+		{
+			if (lock->first_ != 0) fail(frame, "discarded at %d instead of the start", lock->first_);
+			drawnEnd_ = 0;
+			++discards_;
+		}
+		else
+		{
+			if (lock->first_ < drawnEnd_) fail(frame, "locked at %d without discarding, drawn up to %d", lock->first_, drawnEnd_);
+			++noOverwrites_;
+		}
+		if (written != run.vertexRing_.frameVertices()) fail(frame, "%d vertices unlocked, %d appended", written, run.vertexRing_.frameVertices());
+
+		// the draws cover what was written, each vertex once
+		sort(draws.begin(), draws.end(), [](const RenderCall& a, const RenderCall& b) {return a.first_ < b.first_;});
+		int next = lock->first_;
+		bool gaps = !run.show_.finishedRockets().empty();
+		for (size_t i = 0; i < draws.size(); ++i)
+		{
+			if (draws[i].first_ < next) fail(frame, "draw at %d overlaps the one before, ending at %d", draws[i].first_, next);
+			else if (draws[i].first_ > next && !gaps) fail(frame, "draw at %d, the next vertex not drawn is %d", draws[i].first_, next);
+			next = max(next, draws[i].first_ + draws[i].count_);
+		}
+		if (next > lock->first_ + written || (next < lock->first_ + written && !gaps)) fail(frame, "drawn up to %d, written up to %d", next, lock->first_ + written);
+		// every rocket is made of three systems: the projectile, its trace and the effect
+		int systems = 3 * run.show_.rocketCount();
+		if (static_cast<int>(draws.size()) > systems) fail(frame, "%d draws for %d particle systems", static_cast<int>(draws.size()), systems);
+
+		drawnEnd_ = max(drawnEnd_, next);
+	}
+
+	// the run has to have started over at least once to tell anything
+	bool passed(void) const
+	{
+		if (discards_ < 2 || noOverwrites_ == 0)
+		{
+			fprintf(stderr, "ring: %d DISCARD and %d NOOVERWRITE locks, the run does not wrap the ring\n", discards_, noOverwrites_);
+			return false;
+		}
+		return failures_ == 0;
+	}
+
+private:
+	int drawnEnd_;					// the end of the vertices drawn since the last discard
+	int discards_;
+	int noOverwrites_;
+	int failures_;
+	vector<RenderCall> calls_;
+
+	void fail(int frame, const char* format, int a, int b = 0)
+	{
+		if (failures_++ >= 10) return;
+
+		fprintf(stderr, "ring: frame %d: ", frame);
+		fprintf(stderr, format, a, b);
+		fprintf(stderr, "\n");
+	}
+};
+
+// the vertex ring of the default show, drawn by the recording backend (see RingObserver)
+bool checkRing(const Options& options)
+{
+	Options run = options;
+	run.frames_ = 1200;
+	run.fps_ = 60.0f;
+	run.software_ = false;
+	run.images_ = run.keyframes_ = NULL;
+	run.seek_ = 0;
+
+	Result result;
+	RingObserver observer;
+	if (!runScenario(scenarios[0], run, &result, &observer)) return false;
+	return observer.passed();
+}
+
+// the threads are the worker threads and the main thread (which works while it waits), the speedup is against one thread
+const ReportColumn scalingColumns[] =
+{
+	{"threads", "%.0f"}, {"frames", "%.0f"}, {"mean_ms", "%.4f"}, {"p99_ms", "%.4f"}, {"particles_per_s", "%.0f"}, {"speedup", "%.3f"},
+};
+
+// Runs the stress scenario (1000 rockets within 10 seconds, hundreds of them in the air at once) on 1 to 'threads'
+// threads and reports how the frame times scale.
+int benchmarkScaling(const Options& options, int threads)
+{
+	const Scenario& stress = scenarios[3];
+
+	ReportTable table(scalingColumns);
+	double singleThread = 0;
+	for (int t = 1; t <= threads; ++t)
+	{
+		Options run = options;
+		run.workers_ = t - 1;
+		run.images_ = run.keyframes_ = NULL;
+		run.seek_ = 0;
+
+		Result result;
+		if (!runScenario(stress, run, &result)) return 1;
+		if (t == 1) singleThread = result.meanFrame_;
+
+		table.add(t);
+		table.add(result.frames_);
+		table.add(result.meanFrame_);
+		table.add(result.p99Frame_);
+		table.add(result.particlesPerSecond_);
+		table.add(singleThread / result.meanFrame_);
+	}
+	return writeReport(options, table);
+}
+
+// FNV-1a
+void hashBytes(unsigned long long& hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+}
+
+const unsigned long long HASH_START = 14695981039346656037ULL;
+
+// Hashes the vertices of every frame, draw by draw. The particle systems append their vertices from several
+// threads, so where a range lies in the stream depends on the threads, the order of the draws does not. (The frame
+// number is left out, the hashes of a run restored from a snapshot are compared with later frames of another run.)
+class HashObserver : public FrameObserver
+{
+public:
+	virtual void beforeFrame(int frame, Run& run)
+	{
+		calls_.clear();
+		run.renderBackend_.recordCalls(&calls_);
+	}
+
+	virtual void afterFrame(int frame, Run& run)
+	{
+		run.renderBackend_.recordCalls(NULL);
+
+		unsigned long long hash = HASH_START;
+		int alive = run.show_.particlesAlive();
+		hashBytes(hash, &alive, sizeof(alive));
+
+		for (size_t i = 0; i < calls_.size(); ++i)
+		{
+			if (calls_[i].type_ != DrawCall) continue;
+			hashBytes(hash, &calls_[i].count_, sizeof(calls_[i].count_));
+			hashBytes(hash, run.nullBackend_.vertices() + calls_[i].first_, calls_[i].count_ * sizeof(POINTVERTEX));
+		}
+		hashes_.push_back(hash);
+	}
+
+	const vector<unsigned long long>& hashes(void) const {return hashes_;}
+
+private:
+	vector<RenderCall> calls_;
+	vector<unsigned long long> hashes_;
+};
+
+// 500 frames of the stress scenario give the same vertices, frame by frame, with 1, 2, 4 and 8 worker threads
+bool checkDeterminism(const Options& options)
+{
+	const int workers[] = {1, 2, 4, 8};
+
+	Options run = options;
+	run.frames_ = 500;
+	run.fps_ = 60.0f;
+	run.software_ = false;
+	run.images_ = run.keyframes_ = NULL;
+	run.seek_ = 0;
+
+	vector<unsigned long long> reference;
+	for (int w = 0; w < 4; ++w)
+	{
+		run.workers_ = workers[w];
+
+		Result result;
+		HashObserver observer;
+		if (!runScenario(scenarios[3], run, &result, &observer)) return false;
+
+		if (w == 0)
+		{
+			reference = observer.hashes();
+			continue;
+		}
+		for (size_t frame = 0; frame < reference.size(); ++frame)
+		{
+			if (frame >= observer.hashes().size() || observer.hashes()[frame] != reference[frame])
+			{
+				fprintf(stderr, "determinism: frame %d differs between %d and %d workers\n", static_cast<int>(frame), workers[0], workers[w]);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Saves the run before the given frame, or (for 'restore') restores the run saved before its first frame, and hashes
+// the frames like the HashObserver.
+class SnapshotObserver : public HashObserver
+{
+public:
+	SnapshotObserver(Snapshot& snapshot, int saveFrame, bool restore) : snapshot_(snapshot), saveFrame_(saveFrame), restore_(restore), restored_(false) {}
+
+	virtual void beforeFrame(int frame, Run& run)
+	{
+		if (!restore_ && frame == saveFrame_) saveRun(snapshot_, frame, run.clock_, run.scheduler_, run.pool_, run.show_);
+		if (restore_ && frame == 0)
+		{
+			int savedFrame = -1;
+			restored_ = restoreRun(snapshot_, &savedFrame, run.clock_, run.scheduler_, run.pool_, run.show_) && savedFrame == saveFrame_;
+		}
+		HashObserver::beforeFrame(frame, run);
+	}
+
+	bool restored(void) const {return restored_;}
+
+private:
+	Snapshot& snapshot_;
+	int saveFrame_;
+	bool restore_;
+	bool restored_;
+};
+
+// The stress scenario on 4 workers saved before frame 300 (with rockets flying, effects exploding and explosions being
+// prebuilt) and restored into a run of its own draws the same frames from there on as the run it was saved from.
+bool checkSnapshot(const Options& options)
+{
+	const int frames = 500, saveFrame = 300;
+
+	Options run = options;
+	run.frames_ = frames;
+	run.fps_ = 60.0f;
+	run.workers_ = 4;
+	run.software_ = false;
+	run.images_ = run.keyframes_ = NULL;
+	run.seek_ = 0;
+
+	Snapshot snapshot;
+	Result result;
+	SnapshotObserver straight(snapshot, saveFrame, false);
+	if (!runScenario(scenarios[3], run, &result, &straight)) return false;
+
+	run.frames_ = frames - saveFrame;
+	SnapshotObserver restored(snapshot, saveFrame, true);
+	if (!runScenario(scenarios[3], run, &result, &restored)) return false;
+	if (!restored.restored())
+	{
+		fprintf(stderr, "snapshot: the run saved before frame %d could not be restored\n", saveFrame);
+		return false;
+	}
+
+	for (int frame = saveFrame; frame < frames; ++frame)
+	{
+		size_t i = frame - saveFrame;
+		if (static_cast<size_t>(frame) >= straight.hashes().size() || i >= restored.hashes().size() || restored.hashes()[i] != straight.hashes()[frame])
+		{
+			fprintf(stderr, "snapshot: frame %d differs between the restored and the straight run\n", frame);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Hashes the state of the simulation (the scheduler, the pool and the show, not the clock, which holds the time left
+// over by the frames) at every whole second of simulated time a frame ends at.
+class StateObserver : public FrameObserver
+{
+public:
+	virtual void afterFrame(int frame, Run& run)
+	{
+		long long step = run.clock_.steps();
+		if (step % SIMULATION_STEPS_PER_SECOND != 0 || (!steps_.empty() && steps_.back() == step)) return;
+
+		snapshot_.clear();
+		run.scheduler_.saveState(snapshot_);
+		run.pool_.saveState(snapshot_);
+		run.show_.saveState(snapshot_);
+
+		unsigned long long hash = HASH_START;
+		hashBytes(hash, snapshot_.data(), snapshot_.size());
+		steps_.push_back(step);
+		hashes_.push_back(hash);
+	}
+
+	// the hash of the state after the given step, false if no frame ended right after it
+	bool hash(long long step, unsigned long long* hash) const
+	{
+		vector<long long>::const_iterator i = lower_bound(steps_.begin(), steps_.end(), step);
+		if (i == steps_.end() || *i != step) return false;
+
+		*hash = hashes_[i - steps_.begin()];
+		return true;
+	}
+
+private:
+	Snapshot snapshot_;
+	vector<long long> steps_;
+	vector<unsigned long long> hashes_;
+};
+
+// 20 seconds of the show simulated at 30, 60 and 240 frames per second give the same state at every second
+bool checkFrameRates(const Options& options)
+{
+	const float rates[] = {30.0f, 60.0f, 240.0f};
+	const int seconds = 20;
+
+	Options run = options;
+	run.software_ = false;
+	run.images_ = run.keyframes_ = NULL;
+	run.seek_ = 0;
+
+	StateObserver observers[3];
+	for (int r = 0; r < 3; ++r)
+	{
+		run.fps_ = rates[r];
+		run.frames_ = static_cast<int>(rates[r]) * seconds;
+
+		Result result;
+		if (!runScenario(scenarios[0], run, &result, &observers[r])) return false;
+	}
+
+	// the frames may end a step before or after a whole second (the clock adds up the frame times as floats)
+	int compared = 0;
+	for (int second = 1; second < seconds; ++second)
+	{
+		long long step = static_cast<long long>(second) * SIMULATION_STEPS_PER_SECOND;
+		unsigned long long hashes[3];
+		if (!observers[0].hash(step, &hashes[0]) || !observers[1].hash(step, &hashes[1]) || !observers[2].hash(step, &hashes[2])) continue;
+
+		if (hashes[1] != hashes[0] || hashes[2] != hashes[0])
+		{
+			fprintf(stderr, "fps: the state after %d seconds differs between the frame rates\n", second);
+			return false;
+		}
+		++compared;
+	}
+	if (compared < seconds / 2)
+	{
+		fprintf(stderr, "fps: only %d seconds could be compared\n", compared);
+		return false;
+	}
+	return true;
+}
+
+// Jobs submitting and waiting for jobs of their own, round after round on 0 to 8 workers: every job has to be run
+// exactly once and every wait has to return only once all jobs of its counter are done. Every tenth round one of the
+// jobs submits more jobs than the queue of a worker holds, the rest of them go through the injector.
+bool checkJobs(const Options& options)
+{
+	const int rounds = 100, jobs = 64, children = 16, overflow = 5000;
+
+	JobSystem jobSystem;
+	for (int workers = 0; workers <= 8; workers = max(1, workers * 2))
+	{
+		jobSystem.start(workers);
+
+		for (int round = 0; round < rounds; ++round)
+		{
+			JobSystem::Counter group(0);
+			atomic<int> started(0);
+			vector<int> sums(jobs, 0);
+
+			for (int j = 0; j < jobs; ++j)
+			{
+				int count = (j == 0 && round % 10 == 0) ? overflow : children;
+				jobSystem.submit([&jobSystem, &started, &sums, j, count] {
+					++started;
+
+					JobSystem::Counter nested(0);
+					atomic<int> total(0);
+					for (int c = 1; c <= count; ++c)
+					{
+						jobSystem.submit([&total, c] {total += c;}, &nested);
+					}
+					jobSystem.wait(&nested);
+
+					// read by the thread waiting for the group once this job is done
+					sums[j] = total;
+				}, &group);
+			}
+			jobSystem.wait(&group);
+
+			if (started != jobs)
+			{
+				fprintf(stderr, "jobs: %d of %d jobs were run with %d workers\n", static_cast<int>(started), jobs, workers);
+				return false;
+			}
+			for (int j = 0; j < jobs; ++j)
+			{
+				int count = (j == 0 && round % 10 == 0) ? overflow : children;
+				int sum = count * (count + 1) / 2;
+				if (sums[j] == sum) continue;
+
+				fprintf(stderr, "jobs: a job waited for its jobs and got %d instead of %d with %d workers\n", sums[j], sum, workers);
+				return false;
+			}
+		}
+
+		jobSystem.stop();
+	}
+	return true;
+}
+
+// Events at random ticks (some of them at the same tick, some scheduling further events when they are fired) and the
+// time advanced by random amounts: every event has to be fired exactly once, with the tick it was scheduled for, during
+// the advance that passed its tick and in the order of the ticks (events of the same tick in the order scheduled).
+bool checkScheduler(const Options& options)
+{
+	const int count = 200000;
+	const long long span = 60 * SCHEDULER_TICKS_PER_SECOND;
+
+	RandomEngine random(options.seed_);
+	LaunchScheduler scheduler;
+	vector<long long> ticks;
+	vector<int> fired;
+
+	for (int i = 0; i < count; ++i)
+	{
+		// every tenth event shares the tick of the one before
+		long long tick = i % 10 == 9 ? ticks.back() : static_cast<long long>(random.next()) * span >> 32;
+		ticks.push_back(tick);
+		fired.push_back(0);
+
+		RocketCommand command = {FireRocket, i};
+		scheduler.schedule(tick, command);
+	}
+
+	long long before = -1, now = 0, lastTick = -1;
+	int last = -1, failures = 0;
+	LaunchScheduler::Handler handler = [&](const RocketCommand& command, long long tick) {
+		int i = command.rocket_;
+		bool inOrder = tick > lastTick || (tick == lastTick && i > last);
+		if ((tick != ticks[i] || tick <= before || tick > now || !inOrder || fired[i] > 0) && failures++ < 10)
+		{
+			fprintf(stderr, "scheduler: event %d for tick %lld fired with tick %lld while advancing from %lld to %lld\n",
+					i, ticks[i], tick, before, now);
+		}
+		++fired[i];
+		lastTick = tick;
+		last = i;
+
+		// every hundredth event schedules another one (for the same tick up to a second later)
+		if (i % 100 == 0)
+		{
+			long long later = tick + static_cast<long long>(random.number(0, SCHEDULER_TICKS_PER_SECOND));
+			RocketCommand next = {FireRocket, static_cast<int>(ticks.size())};
+			ticks.push_back(later);
+			fired.push_back(0);
+			scheduler.schedule(later, next);
+		}
+	};
+
+	// steps of up to 20 milliseconds with a jump of up to 5 seconds now and then
+	while (now < span + 2 * SCHEDULER_TICKS_PER_SECOND)
+	{
+		before = now;
+		now += random.number(0, 50) == 0 ? random.number(1, 5 * SCHEDULER_TICKS_PER_SECOND) : random.number(1, 20000);
+		scheduler.advance(now, handler);
+		if (scheduler.now() != now && failures++ < 10) fprintf(stderr, "scheduler: advanced to %lld instead of %lld\n", scheduler.now(), now);
+	}
+
+	for (size_t i = 0; i < fired.size(); ++i)
+	{
+		if (fired[i] != 1 && failures++ < 10) fprintf(stderr, "scheduler: event %d was fired %d times\n", static_cast<int>(i), fired[i]);
+	}
+	if (scheduler.pending() != 0 && failures++ < 10) fprintf(stderr, "scheduler: %d events left\n", scheduler.pending());
+
+	return failures == 0;
+}
+
+// Stops the show in the middle of a run: once an effect has exploded, every rocket that is ready is fired (so the batches
+// of their effects are being prebuilt on the workers) and right away all rockets are reset by a StopShow, with the
+// launches still waiting dropped from the scheduler. The StopShow has to give all particles back to the pool at once (a
+// rocket fired at the time it is reset only prebuilds its explosion if its effect holds no lease), and from the next
+// frame on nothing may be alive, written or drawn.
+class ResetObserver : public FrameObserver
+{
+public:
+	ResetObserver(void) : resetFrame_(-1), failures_(0) {}
+
+	virtual void beforeFrame(int frame, Run& run)
+	{
+		// (only the effects have more than a few particles)
+		if (resetFrame_ < 0 && run.show_.particlesAlive() > 1000)
+		{
+			for (int i = 0; i < run.show_.rocketCount(); ++i)
+			{
+				run.show_.rocket(i).fire();
+			}
+
+			run.scheduler_.reset(run.scheduler_.now());
+			RocketCommand stop = {StopShow, -1};
+			run.show_.execute(stop, run.scheduler_.now(), run.scheduler_);
+			resetFrame_ = frame;
+
+			if (run.pool_.inUse() != 0)
+			{
+				fprintf(stderr, "reset: %d particles still leased right after the reset\n", run.pool_.inUse());
+				++failures_;
+			}
+		}
+
+		calls_.clear();
+		run.renderBackend_.recordCalls(&calls_);
+	}
+
+	virtual void afterFrame(int frame, Run& run)
+	{
+		run.renderBackend_.recordCalls(NULL);
+		if (resetFrame_ < 0) return;
+
+		int draws = 0;
+		for (size_t i = 0; i < calls_.size(); ++i)
+		{
+			if (calls_[i].type_ == DrawCall) ++draws;
+		}
+
+		int alive = run.show_.particlesAlive(), vertices = run.vertexRing_.frameVertices();
+		if ((alive != 0 || vertices != 0 || draws != 0) && failures_++ < 10)
+		{
+			fprintf(stderr, "reset: frame %d after the reset: %d particles alive, %d vertices, %d draws\n", frame, alive, vertices, draws);
+		}
+	}
+
+	bool passed(void) const
+	{
+		if (resetFrame_ < 0)
+		{
+			fprintf(stderr, "reset: no effect exploded before the end of the run\n");
+			return false;
+		}
+		return failures_ == 0;
+	}
+
+private:
+	int resetFrame_;
+	int failures_;
+	vector<RenderCall> calls_;
+};
+
+// the default show on 4 workers, stopped as soon as the first effect has exploded (see ResetObserver)
+bool checkReset(const Options& options)
+{
+	Options run = options;
+	run.frames_ = 600;
+	run.fps_ = 60.0f;
+	run.workers_ = 4;
+	run.software_ = false;
+	run.images_ = run.keyframes_ = NULL;
+	run.seek_ = 0;
+
+	Result result;
+	ResetObserver observer;
+	if (!runScenario(scenarios[0], run, &result, &observer)) return false;
+	return observer.passed();
+}
+
+// a micro benchmark, run instead of the scenarios and given its size by its option (see the usage at the top)
+typedef int (*RunBenchmark)(const Options& options, int size);
+
+struct Benchmark
+{
+	const char* option_;
+	RunBenchmark run_;
+};
+
+const Benchmark benchmarks[] =
+{
+	{"--colours", benchmarkColours},
+	{"--integrator", benchmarkIntegrators},
+	{"--layout", benchmarkLayouts},
+	{"--directions", benchmarkDirections},
+	{"--scaling", benchmarkScaling},
+	{"--scheduler", benchmarkScheduler},
+};
+const int BENCHMARKS = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+typedef bool (*RunCheck)(const Options& options);
+
+struct Check
+{
+	const char* name_;
+	RunCheck run_;
+};
+
+const Check checks[] =
+{
+	{"integrator", checkIntegrators},
+	{"ring", checkRing},
+	{"determinism", checkDeterminism},
+	{"snapshot", checkSnapshot},
+	{"fps", checkFrameRates},
+	{"jobs", checkJobs},
+	{"scheduler", checkScheduler},
+	{"reset", checkReset},
+};
+const int CHECKS = sizeof(checks) / sizeof(checks[0]);
+
+// runs the checks given by name (or all of them), returns the exit code of the driver
+int runChecks(const Options& options)
+{
+	int run = 0, failed = 0;
+	for (int i = 0; i < CHECKS; ++i)
+	{
+		if (strcmp(options.check_, "all") != 0 && strcmp(options.check_, checks[i].name_) != 0) continue;
+
+		bool passed = checks[i].run_(options);
+		printf("%s: %s\n", checks[i].name_, passed ? "passed" : "FAILED");
+		++run;
+		if (!passed) ++failed;
+	}
+	if (run == 0) return usage();
+	return failed > 0 ? 1 : 0;
+}
+
+int usage(void)
+{
+	fprintf(stderr, "usage: HeadlessDriver [--scenario default|all-at-once|burst|stress|all] [--frames n] [--fps n] [--workers n]\n"
+					"                      [--seed n] [--budget n] [--show file] [--format csv|json] [--output file]\n"
+					"                      [--render null|software] [--width n] [--height n] [--images pattern] [--image-every n]\n"
+					"                      [--keyframes pattern] [--keyframe-every s] [--seek s] [--motion euler|exact]\n"
+					"                      [--colours n] [--integrator n] [--layout n] [--directions n]\n"
+					"                      [--scaling n] [--scheduler n] [--check name|all]\n");
+	return 2;
+}
+
+int main(int argc, char* argv[])
+{
+	Options options = {"all", 1200, 60.0f, -1, 1, 0, "Fireworks.show", false, NULL, false, 800, 600, NULL, 1, NULL, 1.0f, 0, EulerMotion, NULL, 0, NULL};
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (i + 1 >= argc) return usage();
+		const char* option = argv[i];
+		const char* value = argv[++i];
+
+		if (strcmp(option, "--scenario") == 0) options.scenario_ = value;
+		else if (strcmp(option, "--frames") == 0) options.frames_ = atoi(value);
+		else if (strcmp(option, "--fps") == 0) options.fps_ = static_cast<float>(atof(value));
+		else if (strcmp(option, "--workers") == 0) options.workers_ = atoi(value);
+		else if (strcmp(option, "--seed") == 0) options.seed_ = static_cast<unsigned int>(strtoul(value, NULL, 10));
+		else if (strcmp(option, "--budget") == 0) options.budget_ = atoi(value);
+		else if (strcmp(option, "--show") == 0) options.show_ = value;
+		else if (strcmp(option, "--format") == 0 && strcmp(value, "csv") == 0) options.json_ = false;
+		else if (strcmp(option, "--format") == 0 && strcmp(value, "json") == 0) options.json_ = true;
+		else if (strcmp(option, "--output") == 0) options.output_ = value;
+		else if (strcmp(option, "--render") == 0 && strcmp(value, "null") == 0) options.software_ = false;
+		else if (strcmp(option, "--render") == 0 && strcmp(value, "software") == 0) options.software_ = true;
+		else if (strcmp(option, "--width") == 0) options.width_ = atoi(value);
+		else if (strcmp(option, "--height") == 0) options.height_ = atoi(value);
+		else if (strcmp(option, "--images") == 0) options.images_ = value;
+		else if (strcmp(option, "--image-every") == 0) options.imageEvery_ = atoi(value);
+		else if (strcmp(option, "--keyframes") == 0) options.keyframes_ = value;
+		else if (strcmp(option, "--keyframe-every") == 0) options.keyframeEvery_ = static_cast<float>(atof(value));
+		else if (strcmp(option, "--seek") == 0) options.seek_ = static_cast<float>(atof(value));
+		else if (strcmp(option, "--motion") == 0 && strcmp(value, "euler") == 0) options.motion_ = EulerMotion;
+		else if (strcmp(option, "--motion") == 0 && strcmp(value, "exact") == 0) options.motion_ = ExactMotion;
+		else if (strcmp(option, "--check") == 0) options.check_ = value;
+		else
+		{
+			// the micro benchmarks, all of them given their size
+			int b = 0;
+			while (b < BENCHMARKS && strcmp(option, benchmarks[b].option_) != 0) ++b;
+			if (b == BENCHMARKS) return usage();
+
+			options.benchmark_ = &benchmarks[b];
+			options.benchmarkSize_ = atoi(value);
+		}
+	}
+	if (options.frames_ < 0 || options.fps_ <= 0 || options.width_ <= 0 || options.height_ <= 0 || options.imageEvery_ <= 0 ||
+		options.keyframeEvery_ <= 0 || options.seek_ < 0 ||
+		(options.benchmark_ && options.benchmarkSize_ <= 0)) return usage();
+
+	// the micro benchmarks and the checks run instead of the scenarios
+	if (options.benchmark_) return options.benchmark_ -> run_(options, options.benchmarkSize_);
+	if (options.check_) return runChecks(options);
+
+	ReportTable table(scenarioColumns);
+	for (int i = 0; i < SCENARIOS; ++i)
+	{
+		if (strcmp(options.scenario_, "all") != 0 && strcmp(options.scenario_, scenarios[i].name_) != 0) continue;
+
+		Result result;
+		if (!runScenario(scenarios[i], options, &result)) return 1;
+		addScenarioRow(table, result);
+	}
+	if (table.rows() == 0) return usage();
+
+	return writeReport(options, table);
+}
@@ -1,36 +1,58 @@
 /*
-Some helper functions, mostly for random number generation.
+Some helper functions (random numbers are created by the RandomEngine of each particle system).
 */
 
 #ifndef HELPERS_H
 #define HELPERS_H
 
-#include <stdlib.h>		// Included for the random number generator routines.
-#include <Windows.h>	// For DWORD
-#include <time.h>       // For time
+#include "Direct3DTypes.h"	// For DWORD
+#if defined(_MSC_VER)
+#include <intrin.h>		// For __cpuid
+#endif
 
-// seeds the random number generator with the system time
-static void seedRandomNumberGenerator()
+// returns a well mixed number depending only on the two given numbers (for randomness that must not depend on any state)
+static inline unsigned int hash_numbers(unsigned int a, unsigned int b)
 {
-	srand(static_cast<unsigned int>(time(NULL)));
-}
+	unsigned int h = a * 0x9E3779B1u ^ (b + 0x7F4A7C15u) * 0x85EBCA77u;
 
-// returns a random integer number
-static unsigned int random_number()
-{
-	return rand();
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	h ^= h >> 12;
+	h *= 0x297A2D39u;
+	h ^= h >> 15;
+
+	return h;
 }
 
-// returns a random number in the range specified by a and b
-static unsigned int random_number(unsigned int a, unsigned int b)	
+// determines whether the CPU and the operating system support AVX2, so vectorised code can pick its widest version
+// (callers keep the result, it doesn't change while running)
+inline bool cpuSupportsAVX2()
 {
-	// prevent division by zero as part of modulus calculation below
-	if(b == a)
-		return 0;
-
-	return a + (rand() % (b - a));
+#if defined(_MSC_VER)
+	int info[4];
+
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+
+	// AVX needs to be supported by the CPU and its registers need to be saved by the operating system
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return false;
+	if ((_xgetbv(0) & 6) != 6) return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
 }
 
+// functions using AVX2 intrinsics have to be marked for gcc/clang, MSVC allows them anywhere
+#if defined(_MSC_VER)
+#define AVX2_FUNCTION
+#else
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+
 // converts a float into a DWORD.
 static inline DWORD FtoDW(float f) 
 {
@@ -0,0 +1,629 @@
+#include "Image.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+// inflate (the decompression of deflate streams, as used by PNG files)
+
+// reads the bits of a deflate stream, least significant bit first
+struct BitReader
+{
+	const unsigned char* data_;
+	size_t size_;
+	size_t position_;
+	unsigned int bits_;
+	int count_;
+	bool overrun_;		// set when reading past the end of the data
+
+	unsigned int read(int n)
+	{
+		while (count_ < n)
+		{
+			unsigned int byte = 0;
+			if (position_ < size_) byte = data_[position_++];
+			else overrun_ = true;
+
+			bits_ |= byte << count_;
+			count_ += 8;
+		}
+
+		unsigned int value = bits_ & ((1u << n) - 1);
+		bits_ >>= n;
+		count_ -= n;
+		return value;
+	}
+};
+
+// a canonical Huffman code, given by the number of codes of every length and the symbols in the order of their codes
+struct Huffman
+{
+	unsigned short counts_[16];
+	unsigned short symbols_[288];
+};
+
+static const int INFLATE_MAX_BITS = 15;
+
+// builds the code from the code length of every symbol, returns false if the lengths do not make up a valid code
+static bool buildHuffman(Huffman& code, const unsigned char* lengths, int n)
+{
+	memset(code.counts_, 0, sizeof(code.counts_));
+	for (int symbol = 0; symbol < n; ++symbol)
+	{
+		++code.counts_[lengths[symbol]];
+	}
+	if (code.counts_[0] == n) return true;		// no codes at all (only valid for distances that are never used)
+
+	// more codes of a length than there is room for
+	int left = 1;
+	for (int length = 1; length <= INFLATE_MAX_BITS; ++length)
+	{
+		left = (left << 1) - code.counts_[length];
+		if (left < 0) return false;
+	}
+
+	unsigned short offsets[16];
+	offsets[1] = 0;
+	for (int length = 1; length < INFLATE_MAX_BITS; ++length)
+	{
+		offsets[length + 1] = offsets[length] + code.counts_[length];
+	}
+	for (int symbol = 0; symbol < n; ++symbol)
+	{
+		if (lengths[symbol] != 0) code.symbols_[offsets[lengths[symbol]]++] = static_cast<unsigned short>(symbol);
+	}
+
+	return true;
+}
+
+// reads one symbol (bit by bit, the codes are stored most significant bit first), returns -1 for an invalid code
+static int decodeSymbol(BitReader& input, const Huffman& code)
+{
+	int value = 0, first = 0, index = 0;
+	for (int length = 1; length <= INFLATE_MAX_BITS; ++length)
+	{
+		value |= input.read(1);
+		int count = code.counts_[length];
+		if (value - first < count) return code.symbols_[index + (value - first)];
+
+		index += count;
+		first = (first + count) << 1;
+		value <<= 1;
+	}
+	return -1;
+}
+
+static const unsigned short LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const unsigned char LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const unsigned short DISTANCE_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const unsigned char DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// decodes the symbols of a compressed block until its end
+static bool inflateCodes(BitReader& input, const Huffman& lengths, const Huffman& distances, std::vector<unsigned char>& output)
+{
+	for (;;)
+	{
+		int symbol = decodeSymbol(input, lengths);
+		if (symbol < 0 || input.overrun_) return false;
+
+		if (symbol < 256)
+		{
+			output.push_back(static_cast<unsigned char>(symbol));
+		}
+		else if (symbol == 256)
+		{
+			return true;
+		}
+		else
+		{
+			// a copy of earlier output
+			symbol -= 257;
+			if (symbol >= 29) return false;
+			size_t length = LENGTH_BASE[symbol] + input.read(LENGTH_EXTRA[symbol]);
+
+			int distanceSymbol = decodeSymbol(input, distances);
+			if (distanceSymbol < 0 || distanceSymbol >= 30) return false;
+			size_t distance = DISTANCE_BASE[distanceSymbol] + input.read(DISTANCE_EXTRA[distanceSymbol]);
+			if (distance > output.size()) return false;
+
+			size_t from = output.size() - distance;
+			for (size_t i = 0; i < length; ++i)
+			{
+				output.push_back(output[from + i]);
+			}
+		}
+	}
+}
+
+// the codes of blocks compressed with fixed codes
+struct FixedCodes
+{
+	Huffman lengths_;
+	Huffman distances_;
+
+	FixedCodes(void)
+	{
+		unsigned char lengths[288];
+		int symbol = 0;
+		for (; symbol < 144; ++symbol) lengths[symbol] = 8;
+		for (; symbol < 256; ++symbol) lengths[symbol] = 9;
+		for (; symbol < 280; ++symbol) lengths[symbol] = 7;
+		for (; symbol < 288; ++symbol) lengths[symbol] = 8;
+		buildHuffman(lengths_, lengths, 288);
+
+		for (symbol = 0; symbol < 30; ++symbol) lengths[symbol] = 5;
+		buildHuffman(distances_, lengths, 30);
+	}
+};
+
+// decompresses a raw deflate stream (without the zlib header)
+static bool inflate(const unsigned char* data, size_t size, std::vector<unsigned char>& output)
+{
+	BitReader input = {data, size, 0, 0, 0, false};
+
+	bool last;
+	do
+	{
+		last = input.read(1) != 0;
+		unsigned int type = input.read(2);
+
+		if (type == 0)
+		{
+			// stored block, starting at the next byte
+			input.bits_ = 0;
+			input.count_ = 0;
+			if (input.position_ + 4 > size) return false;
+
+			unsigned int length = data[input.position_] | (data[input.position_ + 1] << 8);
+			unsigned int complement = data[input.position_ + 2] | (data[input.position_ + 3] << 8);
+			input.position_ += 4;
+			if (length != (~complement & 0xffff) || input.position_ + length > size) return false;
+
+			output.insert(output.end(), data + input.position_, data + input.position_ + length);
+			input.position_ += length;
+		}
+		else if (type == 1)
+		{
+			static const FixedCodes fixed;
+			if (!inflateCodes(input, fixed.lengths_, fixed.distances_, output)) return false;
+		}
+		else if (type == 2)
+		{
+			// the codes are part of the block, their lengths are compressed with another code
+			static const unsigned char ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+			int lengthCount = input.read(5) + 257;
+			int distanceCount = input.read(5) + 1;
+			int codeCount = input.read(4) + 4;
+			if (lengthCount > 286 || distanceCount > 30) return false;
+
+			unsigned char lengths[320];
+			memset(lengths, 0, sizeof(lengths));
+			for (int i = 0; i < codeCount; ++i)
+			{
+				lengths[ORDER[i]] = static_cast<unsigned char>(input.read(3));
+			}
+
+			Huffman codeLengths;
+			if (!buildHuffman(codeLengths, lengths, 19)) return false;
+
+			int index = 0;
+			while (index < lengthCount + distanceCount)
+			{
+				int symbol = decodeSymbol(input, codeLengths);
+				if (symbol < 0 || input.overrun_) return false;
+
+				if (symbol < 16)
+				{
+					lengths[index++] = static_cast<unsigned char>(symbol);
+					continue;
+				}
+
+				unsigned char length = 0;
+				int repeat;
+				if (symbol == 16)
+				{
+					if (index == 0) return false;
+					length = lengths[index - 1];
+					repeat = 3 + input.read(2);
+				}
+				else if (symbol == 17)
+				{
+					repeat = 3 + input.read(3);
+				}
+				else
+				{
+					repeat = 11 + input.read(7);
+				}
+				if (index + repeat > lengthCount + distanceCount) return false;
+
+				while (repeat--) lengths[index++] = length;
+			}
+
+			Huffman dynamicLengths, dynamicDistances;
+			if (lengths[256] == 0) return false;	// there must be an end of the block
+			if (!buildHuffman(dynamicLengths, lengths, lengthCount) ||
+				!buildHuffman(dynamicDistances, lengths + lengthCount, distanceCount)) return false;
+
+			if (!inflateCodes(input, dynamicLengths, dynamicDistances, output)) return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	while (!last);
+
+	return !input.overrun_;
+}
+
+
+//-----------------------------------------------------------------------------
+// checksums of the PNG format
+
+struct CrcTable
+{
+	unsigned int values_[256];
+
+	CrcTable(void)
+	{
+		for (unsigned int n = 0; n < 256; ++n)
+		{
+			unsigned int c = n;
+			for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			values_[n] = c;
+		}
+	}
+};
+
+static unsigned int crc32(const unsigned char* data, size_t size, unsigned int crc = 0)
+{
+	static const CrcTable table;
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc = table.values_[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static unsigned int adler32(const unsigned char* data, size_t size)
+{
+	unsigned int a = 1, b = 0;
+	for (size_t i = 0; i < size; ++i)
+	{
+		a = (a + data[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	return (b << 16) | a;
+}
+
+static unsigned int readBigEndian(const unsigned char* p)
+{
+	return (static_cast<unsigned int>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void appendBigEndian(std::vector<unsigned char>& output, unsigned int value)
+{
+	output.push_back(static_cast<unsigned char>(value >> 24));
+	output.push_back(static_cast<unsigned char>(value >> 16));
+	output.push_back(static_cast<unsigned char>(value >> 8));
+	output.push_back(static_cast<unsigned char>(value));
+}
+
+static const unsigned char PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+
+//-----------------------------------------------------------------------------
+// Image
+
+Image::Image(void) : width_(0), height_(0)
+{
+	error_[0] = 0;
+}
+
+void Image::create(int width, int height, DWORD colour)
+{
+	width_ = width;
+	height_ = height;
+	pixels_.assign(static_cast<size_t>(width) * height, colour);
+}
+
+HRESULT Image::fail(const char* format, ...) const
+{
+	va_list arguments;
+	va_start(arguments, format);
+	vsnprintf(error_, sizeof(error_), format, arguments);
+	va_end(arguments);
+
+	return E_FAIL;
+}
+
+HRESULT Image::load(const char* file)
+{
+	error_[0] = 0;
+
+	FILE* input = fopen(file, "rb");
+	if (!input) return fail("%s: cannot be opened", file);
+
+	std::vector<unsigned char> data;
+	unsigned char buffer[65536];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), input)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + read);
+	}
+	fclose(input);
+
+	HRESULT result;
+	if (data.size() >= 8 && memcmp(&data[0], PNG_SIGNATURE, 8) == 0) result = loadPng(&data[0], data.size());
+	else if (data.size() >= 4 && memcmp(&data[0], "DDS ", 4) == 0) result = loadDds(&data[0], data.size());
+	else result = fail("unknown image format");
+
+	if (FAILED(result))
+	{
+		// name the file in the message
+		char message[sizeof(error_)];
+		strcpy(message, error_);
+		fail("%s: %s", file, message);
+		create(0, 0);
+	}
+	return result;
+}
+
+HRESULT Image::loadPng(const unsigned char* data, size_t size)
+{
+	int width = 0, height = 0, depth = 0, colourType = -1, interlace = 0;
+	std::vector<unsigned char> compressed;
+	DWORD palette[256];
+	for (int i = 0; i < 256; ++i) palette[i] = 0xff000000;
+
+	// the chunks: IHDR first, then the palette and the image data
+	size_t position = 8;
+	bool ended = false;
+	while (!ended && position + 12 <= size)
+	{
+		unsigned int length = readBigEndian(data + position);
+		const unsigned char* type = data + position + 4;
+		const unsigned char* content = data + position + 8;
+		if (length > size - position - 12) return fail("truncated PNG chunk");
+
+		if (memcmp(type, "IHDR", 4) == 0 && length >= 13)
+		{
+			width = readBigEndian(content);
+			height = readBigEndian(content + 4);
+			depth = content[8];
+			colourType = content[9];
+			interlace = content[12];
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			for (unsigned int i = 0; i < length / 3 && i < 256; ++i)
+			{
+				palette[i] = 0xff000000 | (content[3 * i] << 16) | (content[3 * i + 1] << 8) | content[3 * i + 2];
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0 && colourType == 3)
+		{
+			for (unsigned int i = 0; i < length && i < 256; ++i)
+			{
+				palette[i] = (palette[i] & 0x00ffffff) | (static_cast<DWORD>(content[i]) << 24);
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			compressed.insert(compressed.end(), content, content + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			ended = true;
+		}
+
+		position += length + 12;
+	}
+
+	if (width <= 0 || height <= 0 || width > 16384 || height > 16384) return fail("invalid PNG size");
+	if (depth != 8 || interlace != 0) return fail("only PNG files with 8 bits per channel and without interlacing are supported");
+
+	int channels;
+	switch (colourType)
+	{
+	case 0: channels = 1; break;		// grey
+	case 2: channels = 3; break;		// RGB
+	case 3: channels = 1; break;		// palette
+	case 4: channels = 2; break;		// grey and alpha
+	case 6: channels = 4; break;		// RGBA
+	default: return fail("unsupported PNG colour type %d", colourType);
+	}
+
+	// a zlib stream: two bytes of header, the deflate stream and a checksum
+	if (compressed.size() < 6 || (compressed[0] & 0x0f) != 8 || (compressed[0] << 8 | compressed[1]) % 31 != 0 || (compressed[1] & 0x20))
+	{
+		return fail("invalid PNG image data");
+	}
+
+	std::vector<unsigned char> rows;
+	size_t stride = static_cast<size_t>(width) * channels;
+	rows.reserve((stride + 1) * height);
+	if (!inflate(&compressed[2], compressed.size() - 2, rows) || rows.size() < (stride + 1) * height) return fail("corrupt PNG image data");
+
+	// undo the filter of every row (each row starts with its filter type)
+	std::vector<unsigned char> previous(stride, 0);
+	create(width, height);
+	for (int y = 0; y < height; ++y)
+	{
+		unsigned char* row = &rows[y * (stride + 1) + 1];
+		int filter = row[-1];
+
+		for (size_t i = 0; i < stride; ++i)
+		{
+			int left = i >= static_cast<size_t>(channels) ? row[i - channels] : 0;
+			int up = previous[i];
+			int upLeft = i >= static_cast<size_t>(channels) ? previous[i - channels] : 0;
+
+			switch (filter)
+			{
+			case 0: break;
+			case 1: row[i] = static_cast<unsigned char>(row[i] + left); break;
+			case 2: row[i] = static_cast<unsigned char>(row[i] + up); break;
+			case 3: row[i] = static_cast<unsigned char>(row[i] + (left + up) / 2); break;
+			case 4:
+			{
+				// Paeth predictor
+				int p = left + up - upLeft;
+				int pa = abs(p - left), pb = abs(p - up), pc = abs(p - upLeft);
+				int predictor = (pa <= pb && pa <= pc) ? left : (pb <= pc ? up : upLeft);
+				row[i] = static_cast<unsigned char>(row[i] + predictor);
+				break;
+			}
+			default: return fail("invalid PNG filter type %d", filter);
+			}
+		}
+
+		DWORD* pixel = &pixels_[static_cast<size_t>(y) * width];
+		for (int x = 0; x < width; ++x)
+		{
+			const unsigned char* p = row + x * channels;
+			switch (colourType)
+			{
+			case 0: pixel[x] = 0xff000000 | (p[0] << 16) | (p[0] << 8) | p[0]; break;
+			case 2: pixel[x] = 0xff000000 | (p[0] << 16) | (p[1] << 8) | p[2]; break;
+			case 3: pixel[x] = palette[p[0]]; break;
+			case 4: pixel[x] = (static_cast<DWORD>(p[1]) << 24) | (p[0] << 16) | (p[0] << 8) | p[0]; break;
+			case 6: pixel[x] = (static_cast<DWORD>(p[3]) << 24) | (p[0] << 16) | (p[1] << 8) | p[2]; break;
+			}
+		}
+
+		memcpy(&previous[0], row, stride);
+	}
+
+	return S_OK;
+}
+
+HRESULT Image::loadDds(const unsigned char* data, size_t size)
+{
+	// the header follows the magic number, the pixel format is part of it
+	const size_t HEADER_SIZE = 4 + 124;
+	if (size < HEADER_SIZE) return fail("truncated DDS header");
+
+	const unsigned char* header = data + 4;
+	unsigned int height = header[8] | (header[9] << 8) | (header[10] << 16) | (header[11] << 24);
+	unsigned int width = header[12] | (header[13] << 8) | (header[14] << 16) | (header[15] << 24);
+
+	const unsigned char* format = header + 72;
+	unsigned int flags = format[4] | (format[5] << 8) | (format[6] << 16) | (format[7] << 24);
+	unsigned int bits = format[12] | (format[13] << 8) | (format[14] << 16) | (format[15] << 24);
+	unsigned int masks[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		const unsigned char* m = format + 16 + 4 * i;
+		masks[i] = m[0] | (m[1] << 8) | (m[2] << 16) | (static_cast<unsigned int>(m[3]) << 24);
+	}
+
+	const unsigned int DDPF_ALPHAPIXELS = 0x1, DDPF_FOURCC = 0x4, DDPF_RGB = 0x40;
+	if ((flags & DDPF_FOURCC) || !(flags & DDPF_RGB) || (bits != 32 && bits != 24)) return fail("only uncompressed 24 and 32 bit DDS files are supported");
+	if (width == 0 || height == 0 || width > 16384 || height > 16384) return fail("invalid DDS size");
+
+	size_t bytes = bits / 8;
+	if (size < HEADER_SIZE + width * height * bytes) return fail("truncated DDS image data");
+
+	// every channel is given by a bit mask (the first mip level only)
+	unsigned int alphaMask = (flags & DDPF_ALPHAPIXELS) ? masks[3] : 0;
+	unsigned int channelMasks[4] = {alphaMask, masks[0], masks[1], masks[2]};
+	int shifts[4], scales[4];
+	for (int c = 0; c < 4; ++c)
+	{
+		unsigned int mask = channelMasks[c];
+		shifts[c] = 0;
+		while (mask && !(mask & 1)) {mask >>= 1; ++shifts[c];}
+		scales[c] = mask;		// the largest value of the channel
+	}
+
+	create(width, height);
+	const unsigned char* p = data + HEADER_SIZE;
+	for (size_t i = 0; i < pixels_.size(); ++i, p += bytes)
+	{
+		unsigned int value = p[0] | (p[1] << 8) | (p[2] << 16) | (bytes == 4 ? static_cast<unsigned int>(p[3]) << 24 : 0);
+
+		DWORD colour = 0;
+		for (int c = 0; c < 4; ++c)
+		{
+			unsigned int channel = scales[c] ? ((value & channelMasks[c]) >> shifts[c]) * 255 / scales[c] : 255;
+			colour |= channel << (24 - 8 * c);
+		}
+		pixels_[i] = colour;
+	}
+
+	return S_OK;
+}
+
+HRESULT Image::savePng(const char* file) const
+{
+	// the rows as RGBA bytes, each one without a filter
+	std::vector<unsigned char> rows;
+	rows.reserve((static_cast<size_t>(width_) * 4 + 1) * height_);
+	for (int y = 0; y < height_; ++y)
+	{
+		rows.push_back(0);
+		const DWORD* pixel = &pixels_[static_cast<size_t>(y) * width_];
+		for (int x = 0; x < width_; ++x)
+		{
+			rows.push_back(static_cast<unsigned char>(pixel[x] >> 16));
+			rows.push_back(static_cast<unsigned char>(pixel[x] >> 8));
+			rows.push_back(static_cast<unsigned char>(pixel[x]));
+			rows.push_back(static_cast<unsigned char>(pixel[x] >> 24));
+		}
+	}
+
+	// a zlib stream made of stored (uncompressed) deflate blocks
+	std::vector<unsigned char> stream;
+	stream.push_back(0x78);
+	stream.push_back(0x01);
+	size_t position = 0;
+	do
+	{
+		size_t length = rows.size() - position;
+		if (length > 65535) length = 65535;
+
+		stream.push_back(position + length == rows.size() ? 1 : 0);
+		stream.push_back(static_cast<unsigned char>(length));
+		stream.push_back(static_cast<unsigned char>(length >> 8));
+		stream.push_back(static_cast<unsigned char>(~length));
+		stream.push_back(static_cast<unsigned char>(~length >> 8));
+		stream.insert(stream.end(), rows.begin() + position, rows.begin() + position + length);
+		position += length;
+	}
+	while (position < rows.size());
+	appendBigEndian(stream, adler32(rows.empty() ? NULL : &rows[0], rows.size()));
+
+	unsigned char header[13] = {0};
+	header[0] = static_cast<unsigned char>(width_ >> 24); header[1] = static_cast<unsigned char>(width_ >> 16);
+	header[2] = static_cast<unsigned char>(width_ >> 8); header[3] = static_cast<unsigned char>(width_);
+	header[4] = static_cast<unsigned char>(height_ >> 24); header[5] = static_cast<unsigned char>(height_ >> 16);
+	header[6] = static_cast<unsigned char>(height_ >> 8); header[7] = static_cast<unsigned char>(height_);
+	header[8] = 8;			// bits per channel
+	header[9] = 6;			// RGBA
+
+	std::vector<unsigned char> png(PNG_SIGNATURE, PNG_SIGNATURE + 8);
+	const char* types[3] = {"IHDR", "IDAT", "IEND"};
+	const unsigned char* contents[3] = {header, &stream[0], NULL};
+	size_t lengths[3] = {sizeof(header), stream.size(), 0};
+	for (int i = 0; i < 3; ++i)
+	{
+		appendBigEndian(png, static_cast<unsigned int>(lengths[i]));
+		size_t start = png.size();
+		png.insert(png.end(), types[i], types[i] + 4);
+		if (lengths[i]) png.insert(png.end(), contents[i], contents[i] + lengths[i]);
+		appendBigEndian(png, crc32(&png[start], png.size() - start));
+	}
+
+	FILE* output = fopen(file, "wb");
+	if (!output) return fail("%s: cannot be written", file);
+
+	bool written = fwrite(&png[0], 1, png.size(), output) == png.size();
+	if (fclose(output) != 0) written = false;
+	return written ? S_OK : fail("%s: cannot be written", file);
+}
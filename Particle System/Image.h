@@ -0,0 +1,42 @@
+/*
+A 32 bit image in system memory, every pixel is an A8R8G8B8 colour (like a D3DCOLOR). Reads the PNG and DDS files the
+point sprite textures are stored in and writes PNG files, without any image library.
+*/
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "Direct3DTypes.h"
+#include <vector>
+
+class Image
+{
+public:
+	Image(void);
+
+	void create(int width, int height, DWORD colour = 0);
+
+	// PNG files with 8 bits per channel (not interlaced) and uncompressed DDS files
+	HRESULT load(const char* file);
+	HRESULT savePng(const char* file) const;
+
+	int width(void) const {return width_;}
+	int height(void) const {return height_;}
+	DWORD* pixels(void) {return pixels_.empty() ? NULL : &pixels_[0];}		// row by row, from the top
+	const DWORD* pixels(void) const {return pixels_.empty() ? NULL : &pixels_[0];}
+
+	const char* error(void) const {return error_;}		// describes why loading or saving failed
+
+private:
+	HRESULT fail(const char* format, ...) const;
+	HRESULT loadPng(const unsigned char* data, size_t size);
+	HRESULT loadDds(const unsigned char* data, size_t size);
+
+	int width_;
+	int height_;
+	std::vector<DWORD> pixels_;
+
+	mutable char error_[256];
+};
+
+#endif
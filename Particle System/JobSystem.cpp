@@ -0,0 +1,217 @@
+#include "JobSystem.h"
+
+
+// the worker the current thread belongs to (-1 for threads outside of any pool)
+static thread_local int currentWorker = -1;
+static thread_local JobSystem* currentPool = NULL;
+
+JobSystem::JobSystem(void) : pending_(0), queued_(0), sleeping_(0), running_(false)
+{
+}
+
+
+JobSystem::~JobSystem(void)
+{
+	stop();
+}
+
+void JobSystem::start(int workers)
+{
+	stop();
+
+	if (workers < 0)
+	{
+		// the thread calling wait() is working as well
+		workers = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+		if (workers < 0) workers = 0;
+	}
+
+	running_ = true;
+
+	for (int i = 0; i < workers; ++i)
+	{
+		queues_.push_back(new WorkQueue);
+	}
+
+	for (int i = 0; i < workers; ++i)
+	{
+		workers_.push_back(std::thread(&JobSystem::work, this, i));
+	}
+}
+
+void JobSystem::stop(void)
+{
+	if (!running_) return;
+
+	wait();
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex_);
+		running_ = false;
+	}
+	wakeUp_.notify_all();
+
+	for (size_t i = 0; i < workers_.size(); ++i)
+	{
+		workers_[i].join();
+	}
+	workers_.clear();
+
+	for (size_t i = 0; i < queues_.size(); ++i)
+	{
+		delete queues_[i];
+	}
+	queues_.clear();
+}
+
+void JobSystem::submit(const Job& job, Counter* counter)
+{
+	++pending_;
+	if (counter) ++*counter;
+
+	Entry* entry = new Entry;
+	entry -> job_ = job;
+	entry -> counter_ = counter;
+
+	// jobs created by a job stay with its worker, everything else (and what a full queue can't take) goes through the injector
+	bool onWorker = currentPool == this && currentWorker >= 0;
+	if (!onWorker || !pushJob(*queues_[currentWorker], entry))
+	{
+		std::lock_guard<std::mutex> lock(injector_.mutex_);
+		injector_.jobs_.push_back(entry);
+	}
+
+	// A worker counts itself as sleeping before it looks at the queued jobs a last time, so either it sees the new job
+	// or the job is counted after it started to sleep and it is woken up here. Taking the lock makes sure it is
+	// actually waiting (and not about to) when it is notified.
+	++queued_;
+	if (sleeping_ > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex_);
+		}
+		wakeUp_.notify_one();
+	}
+}
+
+void JobSystem::wait(Counter* counter)
+{
+	int worker = (currentPool == this) ? currentWorker : -1;
+	Counter& unfinished = counter ? *counter : pending_;
+
+	while (unfinished > 0)
+	{
+		if (!runJob(worker))
+		{
+			// the remaining jobs are being run by other threads
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::work(int worker)
+{
+	currentWorker = worker;
+	currentPool = this;
+
+	while (true)
+	{
+		if (runJob(worker)) continue;
+
+		// sleep until there is something to do (see submit)
+		std::unique_lock<std::mutex> lock(sleepMutex_);
+		++sleeping_;
+		wakeUp_.wait(lock, [this] {return queued_ > 0 || !running_;});
+		--sleeping_;
+		if (!running_) break;
+	}
+
+	currentWorker = -1;
+	currentPool = NULL;
+}
+
+bool JobSystem::runJob(int worker)
+{
+	// the newest job of the own queue first (it is most likely still in the cache), then the injector,
+	// then the oldest job of any other worker
+	Entry* job = worker >= 0 ? popJob(*queues_[worker]) : NULL;
+	if (!job) job = takeInjected();
+
+	int workers = static_cast<int>(queues_.size());
+	for (int i = 1; !job && i <= workers; ++i)
+	{
+		int victim = (worker + i + workers) % workers;
+		if (victim != worker) job = stealJob(*queues_[victim]);
+	}
+
+	if (!job) return false;
+	--queued_;
+
+	job -> job_();
+
+	Counter* counter = job -> counter_;
+	delete job;
+	if (counter) --*counter;
+	--pending_;
+
+	return true;
+}
+
+bool JobSystem::pushJob(WorkQueue& queue, Entry* job)
+{
+	long long bottom = queue.bottom_.load(std::memory_order_relaxed);
+	long long top = queue.top_.load(std::memory_order_acquire);
+	if (bottom - top >= WORK_QUEUE_SIZE) return false;
+
+	// (released, so a thief taking the job sees all of it)
+	queue.slots_[bottom & (WORK_QUEUE_SIZE - 1)].store(job, std::memory_order_release);
+	queue.bottom_.store(bottom + 1, std::memory_order_release);
+	return true;
+}
+
+JobSystem::Entry* JobSystem::popJob(WorkQueue& queue)
+{
+	// claim the newest job before looking at what the thieves took (both in the single order of all seq_cst accesses,
+	// so a thief either sees the claim or the worker sees the thief)
+	long long bottom = queue.bottom_.load(std::memory_order_relaxed) - 1;
+	queue.bottom_.store(bottom, std::memory_order_seq_cst);
+	long long top = queue.top_.load(std::memory_order_seq_cst);
+
+	if (top > bottom)
+	{
+		// empty
+		queue.bottom_.store(bottom + 1, std::memory_order_relaxed);
+		return NULL;
+	}
+
+	Entry* job = queue.slots_[bottom & (WORK_QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		// the last job, a thief may be after it as well
+		if (!queue.top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) job = NULL;
+		queue.bottom_.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+JobSystem::Entry* JobSystem::stealJob(WorkQueue& queue)
+{
+	long long top = queue.top_.load(std::memory_order_seq_cst);
+	long long bottom = queue.bottom_.load(std::memory_order_seq_cst);
+	if (top >= bottom) return NULL;
+
+	// the slot is read before taking it, once 'top_' has moved on the worker may fill it again
+	Entry* job = queue.slots_[top & (WORK_QUEUE_SIZE - 1)].load(std::memory_order_acquire);
+	if (!queue.top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return NULL;
+	return job;
+}
+
+JobSystem::Entry* JobSystem::takeInjected(void)
+{
+	std::lock_guard<std::mutex> lock(injector_.mutex_);
+	if (injector_.jobs_.empty()) return NULL;
+
+	Entry* job = injector_.jobs_.front();
+	injector_.jobs_.pop_front();
+	return job;
+}
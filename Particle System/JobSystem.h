@@ -0,0 +1,87 @@
+/*
+A small work-stealing thread pool. Every worker has its own deque of jobs (Chase and Lev: the worker pushes and pops
+at the bottom without a lock, the other threads steal from the top) and steals from the others when its own runs dry,
+jobs submitted from outside the pool go to a global queue (the injector). Idle workers sleep, the threads submitting
+jobs only take the lock to wake them up if one of them actually sleeps.
+The thread waiting for the jobs helps running them, so a pool without any worker threads still works and jobs can
+wait for jobs of their own (using a counter).
+*/
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+class JobSystem
+{
+public:
+	typedef std::function<void()> Job;
+	typedef std::atomic<int> Counter;		// counts the unfinished jobs of a group
+
+	JobSystem(void);
+	~JobSystem(void);
+
+	void start(int workers);	// starts the worker threads (-1 for one less than there are cores)
+	void stop(void);			// finishes all jobs and ends the worker threads
+
+	void submit(const Job& job, Counter* counter = NULL);	// the counter (if any) is increased until the job is done
+	void wait(Counter* counter = NULL);		// runs jobs until all jobs of the counter (or all jobs at all) are done
+
+	int workerCount(void) const {return static_cast<int>(workers_.size());}
+
+private:
+	struct Entry
+	{
+		Job job_;
+		Counter* counter_;
+	};
+
+	static const int WORK_QUEUE_SIZE = 4096;	// jobs a worker can hold (a power of two), more go to the injector
+
+	// The jobs of a worker, the slots from 'top_' up to 'bottom_' hold jobs. Only the worker changes 'bottom_', the
+	// thieves take the job at 'top_' by moving it on (the worker as well for the last job, which both may be after).
+	struct WorkQueue
+	{
+		alignas(64) std::atomic<long long> top_;
+		alignas(64) std::atomic<long long> bottom_;
+		std::atomic<Entry*> slots_[WORK_QUEUE_SIZE];
+
+		WorkQueue(void) : top_(0), bottom_(0) {}
+	};
+
+	struct Injector
+	{
+		std::deque<Entry*> jobs_;
+		std::mutex mutex_;
+	};
+
+	void work(int worker);					// the loop of a worker thread
+	bool runJob(int worker);				// runs a single job if there is one, 'worker' is -1 for other threads
+	static bool pushJob(WorkQueue& queue, Entry* job);	// false if the queue is full (called by its worker only)
+	static Entry* popJob(WorkQueue& queue);				// the newest job (called by its worker only)
+	static Entry* stealJob(WorkQueue& queue);			// the oldest job, NULL if there is none or another thread was faster
+	Entry* takeInjected(void);
+
+	std::vector<std::thread> workers_;
+	std::vector<WorkQueue*> queues_;		// one per worker
+	Injector injector_;
+
+	std::atomic<int> pending_;				// submitted jobs that are not finished yet
+	std::atomic<int> queued_;				// submitted jobs that have not been started yet
+	std::atomic<int> sleeping_;				// workers waiting for new jobs
+	std::atomic<bool> running_;
+	std::mutex sleepMutex_;					// idle workers sleep until new jobs are submitted
+	std::condition_variable wakeUp_;
+
+	// the threads are owned by the pool, so it must not be copied
+	JobSystem(const JobSystem&);
+	JobSystem& operator=(const JobSystem&);
+};
+
+#endif
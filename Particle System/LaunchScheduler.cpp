@@ -0,0 +1,246 @@
+#include "LaunchScheduler.h"
+#include <algorithm>
+
+
+// the index of the lowest bit set in a (non-zero) mask, found by a de Bruijn multiplication
+static int lowestBit(unsigned long long mask)
+{
+	static const int index[64] = { 0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+								   62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+								   63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+								   46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6 };
+
+	return index[((mask & (0 - mask)) * 0x03F79D71B4CB0A89ull) >> 58];
+}
+
+// the slot of a tick at the given level
+static inline int slotOf(unsigned long long tick, int level)
+{
+	return static_cast<int>(tick >> (level * SCHEDULER_SLOT_BITS)) & (SCHEDULER_SLOTS - 1);
+}
+
+// the first tick of the slot range of the next level that contains the given tick
+static inline unsigned long long rangeStart(unsigned long long tick, int level)
+{
+	int bits = (level + 1) * SCHEDULER_SLOT_BITS;
+	return bits < 64 ? (tick >> bits) << bits : 0;
+}
+
+LaunchScheduler::LaunchScheduler(void)
+{
+	reset();
+}
+
+void LaunchScheduler::reset(long long now)
+{
+	events_.clear();
+	unused_ = -1;
+
+	for (int level = 0; level < SCHEDULER_LEVELS; ++level)
+	{
+		for (int slot = 0; slot < SCHEDULER_SLOTS; ++slot)
+		{
+			slots_[level][slot].first_ = slots_[level][slot].last_ = -1;
+		}
+		occupied_[level] = 0;
+	}
+
+	now_ = now > 0 ? static_cast<unsigned long long>(now) : 0;
+	scheduled_ = 0;
+	pending_ = 0;
+}
+
+void LaunchScheduler::schedule(long long tick, const RocketCommand& command)
+{
+	int event = unused_;
+	if (event >= 0)
+	{
+		unused_ = events_[event].next_;
+	}
+	else
+	{
+		event = static_cast<int>(events_.size());
+		events_.push_back(Event());
+	}
+
+	events_[event].tick_ = tick > 0 ? static_cast<unsigned long long>(tick) : 0;
+	events_[event].command_ = command;
+	events_[event].sequence_ = scheduled_++;
+	++pending_;
+
+	insert(event);
+}
+
+void LaunchScheduler::insert(int event)
+{
+	unsigned long long tick = events_[event].tick_;
+
+	// events that are already due go to the slot of the current tick
+	if (tick <= now_)
+	{
+		append(0, slotOf(now_, 0), event);
+		return;
+	}
+
+	// the lowest level at which the event lies in the same slot range as the current time
+	unsigned long long difference = tick ^ now_;
+	int level = 0;
+	while (level < SCHEDULER_LEVELS - 1 && (difference >> ((level + 1) * SCHEDULER_SLOT_BITS)) != 0)
+	{
+		++level;
+	}
+
+	append(level, slotOf(tick, level), event);
+}
+
+void LaunchScheduler::append(int level, int slot, int event)
+{
+	Slot& s = slots_[level][slot];
+
+	events_[event].next_ = -1;
+	if (s.last_ >= 0)
+	{
+		events_[s.last_].next_ = event;
+	}
+	else
+	{
+		s.first_ = event;
+	}
+	s.last_ = event;
+
+	occupied_[level] |= 1ull << slot;
+}
+
+int LaunchScheduler::fireDue(const Handler& handler)
+{
+	int slot = slotOf(now_, 0);
+	Slot& s = slots_[0][slot];
+
+	// the handler may schedule further events for the current tick, these are appended and fired as well
+	int fired = 0;
+	while (s.first_ >= 0)
+	{
+		int event = s.first_;
+		s.first_ = events_[event].next_;
+		if (s.first_ < 0) s.last_ = -1;
+
+		// copy the event before the handler gets the chance to reuse it
+		RocketCommand command = events_[event].command_;
+		long long tick = static_cast<long long>(events_[event].tick_);
+
+		events_[event].next_ = unused_;
+		unused_ = event;
+		--pending_;
+
+		handler(command, tick);
+		++fired;
+	}
+
+	occupied_[0] &= ~(1ull << slot);
+	return fired;
+}
+
+void LaunchScheduler::cascade(int level, int slot)
+{
+	Slot& s = slots_[level][slot];
+	int event = s.first_;
+
+	s.first_ = s.last_ = -1;
+	occupied_[level] &= ~(1ull << slot);
+
+	while (event >= 0)
+	{
+		int next = events_[event].next_;
+		insert(event);
+		event = next;
+	}
+}
+
+int LaunchScheduler::advance(long long now, const Handler& handler)
+{
+	unsigned long long target = now > 0 ? static_cast<unsigned long long>(now) : 0;
+	int fired = 0;
+
+	for (;;)
+	{
+		fired += fireDue(handler);
+
+		// find the next slot holding events, the slots of a lower level always come before those of a higher one
+		int level = 0;
+		unsigned long long mask = 0;
+		for (; level < SCHEDULER_LEVELS; ++level)
+		{
+			int current = slotOf(now_, level);
+			mask = current < SCHEDULER_SLOTS - 1 ? occupied_[level] & (~0ull << (current + 1)) : 0;
+			if (mask) break;
+		}
+
+		if (level == SCHEDULER_LEVELS)
+		{
+			// nothing is waiting
+			if (target > now_) now_ = target;
+			return fired;
+		}
+
+		int slot = lowestBit(mask);
+		unsigned long long next = rangeStart(now_, level) + (static_cast<unsigned long long>(slot) << (level * SCHEDULER_SLOT_BITS));
+		if (next > target)
+		{
+			if (target > now_) now_ = target;
+			return fired;
+		}
+
+		// jump to the start of the slot, there is nothing to be done for the ticks in between
+		now_ = next;
+		if (level > 0) cascade(level, slot);
+	}
+}
+
+void LaunchScheduler::saveState(Snapshot& snapshot) const
+{
+	// events of the same tick are fired in the order they were scheduled, no matter which level they wait at
+	std::vector<const Event*> waiting;
+	waiting.reserve(pending_);
+	for (int level = 0; level < SCHEDULER_LEVELS; ++level)
+	{
+		for (int slot = 0; slot < SCHEDULER_SLOTS; ++slot)
+		{
+			for (int event = slots_[level][slot].first_; event >= 0; event = events_[event].next_)
+			{
+				waiting.push_back(&events_[event]);
+			}
+		}
+	}
+	std::sort(waiting.begin(), waiting.end(), [](const Event* a, const Event* b) {
+		return a->tick_ != b->tick_ ? a->tick_ < b->tick_ : a->sequence_ < b->sequence_;
+	});
+
+	snapshot.write(now_);
+	snapshot.write(static_cast<int>(waiting.size()));
+	for (size_t i = 0; i < waiting.size(); ++i)
+	{
+		snapshot.write(waiting[i]->tick_);
+		snapshot.write(waiting[i]->command_);
+	}
+}
+
+void LaunchScheduler::restoreState(Snapshot& snapshot)
+{
+	unsigned long long now = 0;
+	int count = 0;
+	snapshot.read(&now);
+	snapshot.read(&count);
+
+	reset(static_cast<long long>(now));
+	for (int i = 0; i < count && snapshot.valid(); ++i)
+	{
+		unsigned long long tick = 0;
+		RocketCommand command;
+		snapshot.read(&tick);
+		snapshot.read(&command);
+		if (snapshot.valid()) schedule(static_cast<long long>(tick), command);
+	}
+
+	if (count < 0) snapshot.invalidate();
+	if (!snapshot.valid()) reset();
+}
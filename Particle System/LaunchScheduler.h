@@ -0,0 +1,78 @@
+/*
+Fires the commands of the show (launches, resets and loops) at their time on the simulation clock.
+The events are kept in a hierarchical timing wheel: every level has 64 slots, a slot of level 0 holds the events of a
+single tick and a slot of level n the events of 64^n ticks. An event goes to the lowest level at which it still lies
+in the same slot range as the current time and moves down a level whenever the time reaches its slot, so scheduling
+and firing an event are O(1) no matter how many events are waiting. Empty slots are skipped using a bit mask per level.
+*/
+
+#ifndef LAUNCH_SCHEDULER_H
+#define LAUNCH_SCHEDULER_H
+
+#include "RocketCommand.h"
+#include "Snapshot.h"
+#include <functional>
+#include <vector>
+
+// the scheduler counts in microseconds of simulated time
+const long long SCHEDULER_TICKS_PER_SECOND = 1000000;
+
+const int SCHEDULER_SLOT_BITS = 6;
+const int SCHEDULER_SLOTS = 1 << SCHEDULER_SLOT_BITS;
+const int SCHEDULER_LEVELS = 11;	// enough levels for any 64 bit tick
+
+class LaunchScheduler
+{
+public:
+	// called for every event that is due, with the tick it was scheduled for
+	typedef std::function<void(const RocketCommand& command, long long tick)> Handler;
+
+	LaunchScheduler(void);
+
+	void reset(long long now = 0);		// drops all events and sets the current time
+
+	// queues a command for the given tick, commands scheduled for the past are fired with the next advance
+	// (may be called from the handler)
+	void schedule(long long tick, const RocketCommand& command);
+
+	// moves the current time forward to 'now' and fires all events due until then (in order of their ticks, events
+	// of the same tick in the order they were scheduled), returns the number of events fired
+	int advance(long long now, const Handler& handler);
+
+	long long now(void) const {return static_cast<long long>(now_);}
+	int pending(void) const {return pending_;}		// the number of events waiting to be fired
+
+	// the current time and the waiting events (restoring them keeps the order in which they are fired)
+	void saveState(Snapshot& snapshot) const;
+	void restoreState(Snapshot& snapshot);
+
+private:
+	struct Event
+	{
+		unsigned long long tick_;
+		RocketCommand command_;
+		unsigned long long sequence_;	// the order in which the events were scheduled
+		int next_;		// the next event in the same slot (or in the list of unused events)
+	};
+
+	struct Slot
+	{
+		int first_;
+		int last_;
+	};
+
+	void insert(int event);				// puts the event into the slot matching its tick
+	void append(int level, int slot, int event);
+	int fireDue(const Handler& handler);		// fires the events of the current tick
+	void cascade(int level, int slot);			// moves the events of a slot down to the lower levels
+
+	std::vector<Event> events_;			// all events, the unused ones are linked in a list to be reused
+	int unused_;
+	Slot slots_[SCHEDULER_LEVELS][SCHEDULER_SLOTS];
+	unsigned long long occupied_[SCHEDULER_LEVELS];	// a bit for every slot that holds events
+	unsigned long long now_;
+	unsigned long long scheduled_;		// the number of events scheduled so far
+	int pending_;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include "NullRenderBackend.h"
+
+
+NullRenderBackend::NullRenderBackend(void)
+{
+}
+
+NullRenderBackend::~NullRenderBackend(void)
+{
+}
+
+RenderTexture NullRenderBackend::loadTexture(const char* file)
+{
+	return NULL;
+}
+
+void NullRenderBackend::releaseTexture(RenderTexture texture)
+{
+}
+
+HRESULT NullRenderBackend::createVertexStream(int capacity)
+{
+	memory_.assign(capacity, POINTVERTEX());
+	return S_OK;
+}
+
+void NullRenderBackend::releaseVertexStream(void)
+{
+	memory_.clear();
+}
+
+POINTVERTEX* NullRenderBackend::lockVertices(int first, int count, bool discard)
+{
+	if (first < 0 || first + count > static_cast<int>(memory_.size())) return NULL;
+	return &memory_[0] + first;
+}
+
+void NullRenderBackend::unlockVertices(int written)
+{
+}
+
+void NullRenderBackend::bindPoints(PointShading shading, RenderTexture texture, float size)
+{
+}
+
+void NullRenderBackend::unbindPoints(void)
+{
+}
+
+void NullRenderBackend::drawPoints(int first, int count)
+{
+}
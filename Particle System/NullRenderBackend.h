@@ -0,0 +1,36 @@
+/*
+A render backend that draws nothing (and loads no textures). The vertices are written to system memory and dropped, so
+the simulation (and the writing of the vertices) can be run and profiled without a window or Direct 3D device.
+*/
+
+#ifndef NULL_RENDER_BACKEND_H
+#define NULL_RENDER_BACKEND_H
+
+#include "RenderBackend.h"
+#include <vector>
+
+class NullRenderBackend : public RenderBackend
+{
+public:
+	NullRenderBackend(void);
+	virtual ~NullRenderBackend(void);
+
+	virtual RenderTexture loadTexture(const char* file);
+	virtual void releaseTexture(RenderTexture texture);
+
+	virtual HRESULT createVertexStream(int capacity);
+	virtual void releaseVertexStream(void);
+	virtual POINTVERTEX* lockVertices(int first, int count, bool discard);
+	virtual void unlockVertices(int written);
+
+	virtual void bindPoints(PointShading shading, RenderTexture texture, float size);
+	virtual void unbindPoints(void);
+	virtual void drawPoints(int first, int count);
+
+	const POINTVERTEX* vertices(void) const {return memory_.empty() ? NULL : &memory_[0];}	// the whole stream
+
+private:
+	std::vector<POINTVERTEX> memory_;	// takes the place of the vertex buffer
+};
+
+#endif
@@ -0,0 +1,457 @@
+#include "ParticleIntegrator.h"
+#include "EnvironmentalConstants.h"
+#include "Helpers.h"
+#include <emmintrin.h>	// SSE2
+#include <immintrin.h>	// AVX2
+#include <string.h>
+
+
+// the amount by which the alpha value decreases per step while the particle fades out
+static float fadeOutStep(int fadeOutTime)
+{
+	return fadeOutTime > 0 ? static_cast<float>(1)/fadeOutTime : 0.0f;
+}
+
+int integrateParticlesScalar(ParticleStore& particles, int begin, int end, float timeIncrement, int fadeOutTime, int* died)
+{
+	int* lifetime = particles.lifetime_;
+	float* px = particles.positionX_;
+	float* py = particles.positionY_;
+	float* pz = particles.positionZ_;
+	float* previousX = particles.previousX_;
+	float* previousY = particles.previousY_;
+	float* previousZ = particles.previousZ_;
+	float* vx = particles.velocityX_;
+	float* vy = particles.velocityY_;
+	float* vz = particles.velocityZ_;
+	float* ax = particles.accelerationX_;
+	float* ay = particles.accelerationY_;
+	float* az = particles.accelerationZ_;
+	float* alpha = particles.colourA_;
+	float* time = particles.time_;
+
+	float fadeStep = fadeOutStep(fadeOutTime);
+	int count = 0;
+
+	for (int i = begin; i < end; ++i)
+	{
+		if (lifetime[i] > 0)	// Update only if this particle is alive.
+		{
+			// Calculate the new position of the particle (rendering interpolates from the previous one)...
+			previousX[i] = px[i];
+			previousY[i] = py[i];
+			previousZ[i] = pz[i];
+
+			px[i] += vx[i] * timeIncrement;
+			py[i] += vy[i] * timeIncrement;
+			pz[i] += vz[i] * timeIncrement;
+
+			// update velocity
+			vx[i] += ax[i] * timeIncrement;
+			vy[i] += ay[i] * timeIncrement;
+			vz[i] += az[i] * timeIncrement;
+
+			// update acceleration (this is not physically correct but takes air drag into account to some extent)
+			ax[i] = AIR_DRAG * vx[i];
+			ay[i] = AIR_DRAG * vy[i] + EARTH_GRAVITY;
+			az[i] = AIR_DRAG * vz[i];
+
+			time[i] += timeIncrement;
+			--lifetime[i];
+
+			// update alpha value
+			if (lifetime[i] < fadeOutTime)
+			{
+				alpha[i] -= fadeStep;
+			}
+
+			if (lifetime[i] == 0) died[count++] = i;
+		}
+	}
+
+	return count;
+}
+
+// 4 particles per iteration, 'begin' must be a multiple of 4
+static int integrateParticlesSSE2(ParticleStore& particles, int begin, int end, float timeIncrement, int fadeOutTime, int* died)
+{
+	const __m128 dt = _mm_set1_ps(timeIncrement);
+	const __m128 drag = _mm_set1_ps(AIR_DRAG);
+	const __m128 gravity = _mm_set1_ps(EARTH_GRAVITY);
+	const __m128 fadeStep = _mm_set1_ps(fadeOutStep(fadeOutTime));
+	const __m128i fadeOut = _mm_set1_epi32(fadeOutTime);
+	const __m128i zero = _mm_setzero_si128();
+	int count = 0;
+
+	for (int i = begin; i < end; i += 4)
+	{
+		__m128i lifetime = _mm_load_si128(reinterpret_cast<__m128i*>(particles.lifetime_ + i));
+		__m128i aliveMask = _mm_cmpgt_epi32(lifetime, zero);
+		__m128 alive = _mm_castsi128_ps(aliveMask);
+
+		// skip blocks that only contain dead particles
+		if (_mm_movemask_ps(alive) == 0) continue;
+
+		__m128 px = _mm_load_ps(particles.positionX_ + i);
+		__m128 py = _mm_load_ps(particles.positionY_ + i);
+		__m128 pz = _mm_load_ps(particles.positionZ_ + i);
+		__m128 vx = _mm_load_ps(particles.velocityX_ + i);
+		__m128 vy = _mm_load_ps(particles.velocityY_ + i);
+		__m128 vz = _mm_load_ps(particles.velocityZ_ + i);
+		__m128 ax = _mm_load_ps(particles.accelerationX_ + i);
+		__m128 ay = _mm_load_ps(particles.accelerationY_ + i);
+		__m128 az = _mm_load_ps(particles.accelerationZ_ + i);
+
+		// the same operations in the same order as the scalar version, so the results are identical
+		__m128 newPx = _mm_add_ps(px, _mm_mul_ps(vx, dt));
+		__m128 newPy = _mm_add_ps(py, _mm_mul_ps(vy, dt));
+		__m128 newPz = _mm_add_ps(pz, _mm_mul_ps(vz, dt));
+		__m128 newVx = _mm_add_ps(vx, _mm_mul_ps(ax, dt));
+		__m128 newVy = _mm_add_ps(vy, _mm_mul_ps(ay, dt));
+		__m128 newVz = _mm_add_ps(vz, _mm_mul_ps(az, dt));
+		__m128 newAx = _mm_mul_ps(drag, newVx);
+		__m128 newAy = _mm_add_ps(_mm_mul_ps(drag, newVy), gravity);
+		__m128 newAz = _mm_mul_ps(drag, newVz);
+
+		// dead particles keep their old values (select by mask), their previous position is their current one anyway
+		_mm_store_ps(particles.previousX_ + i, px);
+		_mm_store_ps(particles.previousY_ + i, py);
+		_mm_store_ps(particles.previousZ_ + i, pz);
+		_mm_store_ps(particles.positionX_ + i, _mm_or_ps(_mm_and_ps(alive, newPx), _mm_andnot_ps(alive, px)));
+		_mm_store_ps(particles.positionY_ + i, _mm_or_ps(_mm_and_ps(alive, newPy), _mm_andnot_ps(alive, py)));
+		_mm_store_ps(particles.positionZ_ + i, _mm_or_ps(_mm_and_ps(alive, newPz), _mm_andnot_ps(alive, pz)));
+		_mm_store_ps(particles.velocityX_ + i, _mm_or_ps(_mm_and_ps(alive, newVx), _mm_andnot_ps(alive, vx)));
+		_mm_store_ps(particles.velocityY_ + i, _mm_or_ps(_mm_and_ps(alive, newVy), _mm_andnot_ps(alive, vy)));
+		_mm_store_ps(particles.velocityZ_ + i, _mm_or_ps(_mm_and_ps(alive, newVz), _mm_andnot_ps(alive, vz)));
+		_mm_store_ps(particles.accelerationX_ + i, _mm_or_ps(_mm_and_ps(alive, newAx), _mm_andnot_ps(alive, ax)));
+		_mm_store_ps(particles.accelerationY_ + i, _mm_or_ps(_mm_and_ps(alive, newAy), _mm_andnot_ps(alive, ay)));
+		_mm_store_ps(particles.accelerationZ_ + i, _mm_or_ps(_mm_and_ps(alive, newAz), _mm_andnot_ps(alive, az)));
+
+		__m128 time = _mm_load_ps(particles.time_ + i);
+		_mm_store_ps(particles.time_ + i, _mm_add_ps(time, _mm_and_ps(alive, dt)));
+
+		// the mask is -1 for living particles, so adding it decreases their lifetime
+		lifetime = _mm_add_epi32(lifetime, aliveMask);
+		_mm_store_si128(reinterpret_cast<__m128i*>(particles.lifetime_ + i), lifetime);
+
+		__m128 fading = _mm_and_ps(alive, _mm_castsi128_ps(_mm_cmplt_epi32(lifetime, fadeOut)));
+		__m128 alpha = _mm_load_ps(particles.colourA_ + i);
+		_mm_store_ps(particles.colourA_ + i, _mm_sub_ps(alpha, _mm_and_ps(fading, fadeStep)));
+
+		// remember the particles that just died
+		int dying = _mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(aliveMask, _mm_cmpeq_epi32(lifetime, zero))));
+		for (int k = 0; dying != 0; ++k, dying >>= 1)
+		{
+			if (dying & 1) died[count++] = i + k;
+		}
+	}
+
+	return count;
+}
+
+// 8 particles per iteration, 'begin' must be a multiple of 8
+AVX2_FUNCTION static int integrateParticlesAVX2(ParticleStore& particles, int begin, int end, float timeIncrement, int fadeOutTime, int* died)
+{
+	const __m256 dt = _mm256_set1_ps(timeIncrement);
+	const __m256 drag = _mm256_set1_ps(AIR_DRAG);
+	const __m256 gravity = _mm256_set1_ps(EARTH_GRAVITY);
+	const __m256 fadeStep = _mm256_set1_ps(fadeOutStep(fadeOutTime));
+	const __m256i fadeOut = _mm256_set1_epi32(fadeOutTime);
+	const __m256i zero = _mm256_setzero_si256();
+	int count = 0;
+
+	for (int i = begin; i < end; i += 8)
+	{
+		__m256i lifetime = _mm256_load_si256(reinterpret_cast<__m256i*>(particles.lifetime_ + i));
+		__m256i aliveMask = _mm256_cmpgt_epi32(lifetime, zero);
+		__m256 alive = _mm256_castsi256_ps(aliveMask);
+
+		// skip blocks that only contain dead particles
+		if (_mm256_movemask_ps(alive) == 0) continue;
+
+		__m256 px = _mm256_load_ps(particles.positionX_ + i);
+		__m256 py = _mm256_load_ps(particles.positionY_ + i);
+		__m256 pz = _mm256_load_ps(particles.positionZ_ + i);
+		__m256 vx = _mm256_load_ps(particles.velocityX_ + i);
+		__m256 vy = _mm256_load_ps(particles.velocityY_ + i);
+		__m256 vz = _mm256_load_ps(particles.velocityZ_ + i);
+		__m256 ax = _mm256_load_ps(particles.accelerationX_ + i);
+		__m256 ay = _mm256_load_ps(particles.accelerationY_ + i);
+		__m256 az = _mm256_load_ps(particles.accelerationZ_ + i);
+
+		// no fused multiply-add, so the results stay identical to the scalar version
+		__m256 newVx = _mm256_add_ps(vx, _mm256_mul_ps(ax, dt));
+		__m256 newVy = _mm256_add_ps(vy, _mm256_mul_ps(ay, dt));
+		__m256 newVz = _mm256_add_ps(vz, _mm256_mul_ps(az, dt));
+
+		_mm256_store_ps(particles.previousX_ + i, px);
+		_mm256_store_ps(particles.previousY_ + i, py);
+		_mm256_store_ps(particles.previousZ_ + i, pz);
+		_mm256_store_ps(particles.positionX_ + i, _mm256_blendv_ps(px, _mm256_add_ps(px, _mm256_mul_ps(vx, dt)), alive));
+		_mm256_store_ps(particles.positionY_ + i, _mm256_blendv_ps(py, _mm256_add_ps(py, _mm256_mul_ps(vy, dt)), alive));
+		_mm256_store_ps(particles.positionZ_ + i, _mm256_blendv_ps(pz, _mm256_add_ps(pz, _mm256_mul_ps(vz, dt)), alive));
+		_mm256_store_ps(particles.velocityX_ + i, _mm256_blendv_ps(vx, newVx, alive));
+		_mm256_store_ps(particles.velocityY_ + i, _mm256_blendv_ps(vy, newVy, alive));
+		_mm256_store_ps(particles.velocityZ_ + i, _mm256_blendv_ps(vz, newVz, alive));
+		_mm256_store_ps(particles.accelerationX_ + i, _mm256_blendv_ps(ax, _mm256_mul_ps(drag, newVx), alive));
+		_mm256_store_ps(particles.accelerationY_ + i, _mm256_blendv_ps(ay, _mm256_add_ps(_mm256_mul_ps(drag, newVy), gravity), alive));
+		_mm256_store_ps(particles.accelerationZ_ + i, _mm256_blendv_ps(az, _mm256_mul_ps(drag, newVz), alive));
+
+		__m256 time = _mm256_load_ps(particles.time_ + i);
+		_mm256_store_ps(particles.time_ + i, _mm256_add_ps(time, _mm256_and_ps(alive, dt)));
+
+		// the mask is -1 for living particles, so adding it decreases their lifetime
+		lifetime = _mm256_add_epi32(lifetime, aliveMask);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(particles.lifetime_ + i), lifetime);
+
+		__m256 fading = _mm256_and_ps(alive, _mm256_castsi256_ps(_mm256_cmpgt_epi32(fadeOut, lifetime)));
+		__m256 alpha = _mm256_load_ps(particles.colourA_ + i);
+		_mm256_store_ps(particles.colourA_ + i, _mm256_sub_ps(alpha, _mm256_and_ps(fading, fadeStep)));
+
+		// remember the particles that just died
+		int dying = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(aliveMask, _mm256_cmpeq_epi32(lifetime, zero))));
+		for (int k = 0; dying != 0; ++k, dying >>= 1)
+		{
+			if (dying & 1) died[count++] = i + k;
+		}
+	}
+
+	return count;
+}
+
+IntegratorKernel widestIntegratorKernel(void)
+{
+	return cpuSupportsAVX2() ? AVX2Integrator : SSE2Integrator;
+}
+
+int integrateParticles(ParticleStore& particles, int begin, int end, float timeIncrement, int fadeOutTime, int* died)
+{
+	static const IntegratorKernel kernel = widestIntegratorKernel();
+	return integrateParticlesWith(kernel, particles, begin, end, timeIncrement, fadeOutTime, died);
+}
+
+int integrateParticlesWith(IntegratorKernel kernel, ParticleStore& particles, int begin, int end, float timeIncrement, int fadeOutTime, int* died)
+{
+	if (kernel == ScalarIntegrator)
+	{
+		return integrateParticlesScalar(particles, begin, end, timeIncrement, fadeOutTime, died);
+	}
+
+	const bool useAVX2 = kernel == AVX2Integrator;
+	const int width = useAVX2 ? 8 : 4;
+
+	// the arrays are aligned, so the vectorised part has to start at a multiple of the vector width
+	int vectorBegin = (begin + width - 1) / width * width;
+	int vectorEnd = end / width * width;
+
+	if (vectorBegin >= vectorEnd)
+	{
+		return integrateParticlesScalar(particles, begin, end, timeIncrement, fadeOutTime, died);
+	}
+
+	int count = integrateParticlesScalar(particles, begin, vectorBegin, timeIncrement, fadeOutTime, died);
+
+	if (useAVX2)
+		count += integrateParticlesAVX2(particles, vectorBegin, vectorEnd, timeIncrement, fadeOutTime, died + count);
+	else
+		count += integrateParticlesSSE2(particles, vectorBegin, vectorEnd, timeIncrement, fadeOutTime, died + count);
+
+	count += integrateParticlesScalar(particles, vectorEnd, end, timeIncrement, fadeOutTime, died + count);
+	return count;
+}
+
+
+//-----------------------------------------------------------------------------
+// closed form
+
+// With the acceleration a = k * v + g the velocity is v(t) = (v0 + g / k) * e^(kt) - g / k and the position
+// p(t) = p0 + (v0 + g / k) * (e^(kt) - 1) / k - g / k * t, with k the air drag and g the gravity (along y only).
+static const float DRAG_INVERSE = 1.0f / AIR_DRAG;
+static const float GRAVITY_OVER_DRAG = EARTH_GRAVITY / AIR_DRAG;
+
+// e^x for the (negative) exponents of the drag, by range reduction to 2^n * e^r and a polynomial for e^r (Cephes).
+// The scalar and the vectorised version do the same operations, so every particle gets the same result in both.
+static const float EXP_MIN = -87.0f;
+static const float EXP_LOG2E = 1.44269504088896341f;
+static const float EXP_C1 = 0.693359375f;
+static const float EXP_C2 = -2.12194440e-4f;
+static const float EXP_P0 = 1.9875691500e-4f;
+static const float EXP_P1 = 1.3981999507e-3f;
+static const float EXP_P2 = 8.3334519073e-3f;
+static const float EXP_P3 = 4.1665795894e-2f;
+static const float EXP_P4 = 1.6666665459e-1f;
+static const float EXP_P5 = 5.0000001201e-1f;
+
+static float exponential(float x)
+{
+	if (x < EXP_MIN) x = EXP_MIN;
+	if (x > 0) x = 0;
+
+	// n = floor(x * log2(e) + 0.5)
+	float f = x * EXP_LOG2E + 0.5f;
+	int n = static_cast<int>(f);
+	if (static_cast<float>(n) > f) --n;
+	float fn = static_cast<float>(n);
+
+	float r = x - fn * EXP_C1;
+	r = r - fn * EXP_C2;
+
+	float y = EXP_P0;
+	y = y * r + EXP_P1;
+	y = y * r + EXP_P2;
+	y = y * r + EXP_P3;
+	y = y * r + EXP_P4;
+	y = y * r + EXP_P5;
+	y = y * (r * r) + r;
+	y = y + 1.0f;
+
+	int bits = (n + 127) << 23;
+	float scale;
+	memcpy(&scale, &bits, sizeof(scale));
+	return y * scale;
+}
+
+static inline __m128 exponential(__m128 x)
+{
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(EXP_MIN)), _mm_setzero_ps());
+
+	__m128 f = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(EXP_LOG2E)), _mm_set1_ps(0.5f));
+	__m128i n = _mm_cvttps_epi32(f);
+	__m128 fn = _mm_cvtepi32_ps(n);
+	__m128 greater = _mm_cmpgt_ps(fn, f);
+	n = _mm_add_epi32(n, _mm_castps_si128(greater));		// -1 where the conversion rounded up
+	fn = _mm_cvtepi32_ps(n);
+
+	__m128 r = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(EXP_C1)));
+	r = _mm_sub_ps(r, _mm_mul_ps(fn, _mm_set1_ps(EXP_C2)));
+
+	__m128 y = _mm_set1_ps(EXP_P0);
+	y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(EXP_P1));
+	y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(EXP_P2));
+	y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(EXP_P3));
+	y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(EXP_P4));
+	y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(EXP_P5));
+	y = _mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(r, r)), r);
+	y = _mm_add_ps(y, _mm_set1_ps(1.0f));
+
+	__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+	return _mm_mul_ps(y, scale);
+}
+
+D3DXVECTOR3 exactParticlePosition(const D3DXVECTOR3& origin, const D3DXVECTOR3& velocity, float time)
+{
+	float c = (exponential(AIR_DRAG * time) - 1.0f) * DRAG_INVERSE;
+
+	return D3DXVECTOR3(origin.x + velocity.x * c,
+					   origin.y + (velocity.y + GRAVITY_OVER_DRAG) * c - GRAVITY_OVER_DRAG * time,
+					   origin.z + velocity.z * c);
+}
+
+int evaluateParticlesScalar(ParticleStore& particles, int begin, int end, float timeIncrement, int fadeOutTime, int* died)
+{
+	int* lifetime = particles.lifetime_;
+	float* alpha = particles.colourA_;
+	float* time = particles.time_;
+
+	float fadeStep = fadeOutStep(fadeOutTime);
+	int count = 0;
+
+	for (int i = begin; i < end; ++i)
+	{
+		if (lifetime[i] > 0)
+		{
+			time[i] += timeIncrement;
+
+			D3DXVECTOR3 position = exactParticlePosition(particles.getOrigin(i), particles.getVelocity(i), time[i]);
+			particles.movePosition(i, position);
+
+			--lifetime[i];
+			if (lifetime[i] < fadeOutTime)
+			{
+				alpha[i] -= fadeStep;
+			}
+
+			if (lifetime[i] == 0) died[count++] = i;
+		}
+	}
+
+	return count;
+}
+
+// 4 particles per iteration, 'begin' must be a multiple of 4
+static int evaluateParticlesSSE2(ParticleStore& particles, int begin, int end, float timeIncrement, int fadeOutTime, int* died)
+{
+	const __m128 dt = _mm_set1_ps(timeIncrement);
+	const __m128 drag = _mm_set1_ps(AIR_DRAG);
+	const __m128 dragInverse = _mm_set1_ps(DRAG_INVERSE);
+	const __m128 gravityOverDrag = _mm_set1_ps(GRAVITY_OVER_DRAG);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 fadeStep = _mm_set1_ps(fadeOutStep(fadeOutTime));
+	const __m128i fadeOut = _mm_set1_epi32(fadeOutTime);
+	const __m128i zero = _mm_setzero_si128();
+	int count = 0;
+
+	for (int i = begin; i < end; i += 4)
+	{
+		__m128i lifetime = _mm_load_si128(reinterpret_cast<__m128i*>(particles.lifetime_ + i));
+		__m128i aliveMask = _mm_cmpgt_epi32(lifetime, zero);
+		__m128 alive = _mm_castsi128_ps(aliveMask);
+
+		// skip blocks that only contain dead particles
+		if (_mm_movemask_ps(alive) == 0) continue;
+
+		__m128 time = _mm_add_ps(_mm_load_ps(particles.time_ + i), _mm_and_ps(alive, dt));
+		_mm_store_ps(particles.time_ + i, time);
+
+		// the same operations in the same order as exactParticlePosition
+		__m128 c = _mm_mul_ps(_mm_sub_ps(exponential(_mm_mul_ps(drag, time)), one), dragInverse);
+		__m128 newPx = _mm_add_ps(_mm_load_ps(particles.originX_ + i), _mm_mul_ps(_mm_load_ps(particles.velocityX_ + i), c));
+		__m128 newPy = _mm_sub_ps(_mm_add_ps(_mm_load_ps(particles.originY_ + i), _mm_mul_ps(_mm_add_ps(_mm_load_ps(particles.velocityY_ + i), gravityOverDrag), c)),
+								  _mm_mul_ps(gravityOverDrag, time));
+		__m128 newPz = _mm_add_ps(_mm_load_ps(particles.originZ_ + i), _mm_mul_ps(_mm_load_ps(particles.velocityZ_ + i), c));
+
+		__m128 px = _mm_load_ps(particles.positionX_ + i);
+		__m128 py = _mm_load_ps(particles.positionY_ + i);
+		__m128 pz = _mm_load_ps(particles.positionZ_ + i);
+		_mm_store_ps(particles.previousX_ + i, px);
+		_mm_store_ps(particles.previousY_ + i, py);
+		_mm_store_ps(particles.previousZ_ + i, pz);
+		_mm_store_ps(particles.positionX_ + i, _mm_or_ps(_mm_and_ps(alive, newPx), _mm_andnot_ps(alive, px)));
+		_mm_store_ps(particles.positionY_ + i, _mm_or_ps(_mm_and_ps(alive, newPy), _mm_andnot_ps(alive, py)));
+		_mm_store_ps(particles.positionZ_ + i, _mm_or_ps(_mm_and_ps(alive, newPz), _mm_andnot_ps(alive, pz)));
+
+		// the mask is -1 for living particles, so adding it decreases their lifetime
+		lifetime = _mm_add_epi32(lifetime, aliveMask);
+		_mm_store_si128(reinterpret_cast<__m128i*>(particles.lifetime_ + i), lifetime);
+
+		__m128 fading = _mm_and_ps(alive, _mm_castsi128_ps(_mm_cmplt_epi32(lifetime, fadeOut)));
+		__m128 alpha = _mm_load_ps(particles.colourA_ + i);
+		_mm_store_ps(particles.colourA_ + i, _mm_sub_ps(alpha, _mm_and_ps(fading, fadeStep)));
+
+		// remember the particles that just died
+		int dying = _mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(aliveMask, _mm_cmpeq_epi32(lifetime, zero))));
+		for (int k = 0; dying != 0; ++k, dying >>= 1)
+		{
+			if (dying & 1) died[count++] = i + k;
+		}
+	}
+
+	return count;
+}
+
+int evaluateParticles(ParticleStore& particles, int begin, int end, float timeIncrement, int fadeOutTime, int* died)
+{
+	// the exponential dominates, so SSE2 is used on every CPU (the results do not depend on the vector width)
+	int vectorBegin = (begin + 3) / 4 * 4;
+	int vectorEnd = end / 4 * 4;
+
+	if (vectorBegin >= vectorEnd)
+	{
+		return evaluateParticlesScalar(particles, begin, end, timeIncrement, fadeOutTime, died);
+	}
+
+	int count = evaluateParticlesScalar(particles, begin, vectorBegin, timeIncrement, fadeOutTime, died);
+	count += evaluateParticlesSSE2(particles, vectorBegin, vectorEnd, timeIncrement, fadeOutTime, died + count);
+	count += evaluateParticlesScalar(particles, vectorEnd, end, timeIncrement, fadeOutTime, died + count);
+	return count;
+}
@@ -0,0 +1,53 @@
+/*
+The Euler step shared by all firework effects, vectorised with SSE2 (4 particles per iteration) and, if the CPU
+supports it, AVX2 (8 particles per iteration).
+Particles only moved by air drag and gravity after their start can also be evaluated in closed form: the linear drag
+has an exact solution, so their position follows from their origin, their start velocity and their time alone.
+*/
+
+#ifndef PARTICLE_INTEGRATOR_H
+#define PARTICLE_INTEGRATOR_H
+
+#include "ParticleStore.h"
+
+// how the firework effects move their particles
+enum ParticleMotion
+{
+	EulerMotion,		// stepped by the Euler integrator (position, velocity and acceleration carried from step to step)
+	ExactMotion			// evaluated from the start of the particle (origin and velocity), the acceleration is not used
+};
+
+// the versions of the Euler step, integrateParticles uses the widest one the CPU supports
+enum IntegratorKernel
+{
+	ScalarIntegrator,	// one particle per iteration
+	SSE2Integrator,		// 4 particles per iteration
+	AVX2Integrator		// 8 particles per iteration, only if the CPU supports AVX2
+};
+
+IntegratorKernel widestIntegratorKernel(void);
+
+// Advances every living particle in the range [begin, end) by one simulation step: position (keeping the previous one),
+// velocity, acceleration (air drag and gravity), time, lifetime and the fade out of the alpha value. Lifetime and
+// 'fadeOutTime' are counted in simulation steps.
+// The indices of the particles that died during this step are written to 'died' (in ascending order, so it needs room
+// for end - begin indices). Returns the number of particles that died.
+int integrateParticles(ParticleStore& particles, int begin, int end, float timeIncrement, int fadeOutTime, int* died);
+
+// The same step without any vectorisation. Used for the unaligned start and the end of a range and as a reference
+// for the vectorised versions, which produce the same results.
+int integrateParticlesScalar(ParticleStore& particles, int begin, int end, float timeIncrement, int fadeOutTime, int* died);
+
+// The same step done by the given kernel (to compare the kernels with each other), the scalar loop is used for the
+// particles before and after the aligned part.
+int integrateParticlesWith(IntegratorKernel kernel, ParticleStore& particles, int begin, int end, float timeIncrement, int fadeOutTime, int* died);
+
+// The same step for particles in ExactMotion: the time is advanced and the position evaluated at the new time from the
+// origin and the velocity the particle started with (both stay untouched). Lifetime and alpha are counted down as above.
+int evaluateParticles(ParticleStore& particles, int begin, int end, float timeIncrement, int fadeOutTime, int* died);
+int evaluateParticlesScalar(ParticleStore& particles, int begin, int end, float timeIncrement, int fadeOutTime, int* died);
+
+// where a particle starting at 'origin' with 'velocity' is after 'time' (the exact solution the evaluation uses)
+D3DXVECTOR3 exactParticlePosition(const D3DXVECTOR3& origin, const D3DXVECTOR3& velocity, float time);
+
+#endif
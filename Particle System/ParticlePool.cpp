@@ -0,0 +1,138 @@
+#include "ParticlePool.h"
+
+
+// leases are rounded up to whole SIMD blocks, so every range starts aligned
+static int padLease(int count)
+{
+	return (count + PARTICLE_STORE_PADDING - 1) / PARTICLE_STORE_PADDING * PARTICLE_STORE_PADDING;
+}
+
+ParticlePool::ParticlePool(void) : inUse_(0), highWaterMark_(0), failedLeases_(0)
+{
+}
+
+
+ParticlePool::~ParticlePool(void)
+{
+}
+
+void ParticlePool::initialise(int budget)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	particles_.allocate(budget);
+
+	freeRanges_.clear();
+	if (particles_.capacity() > 0)
+	{
+		Range all = { 0, particles_.capacity() };
+		freeRanges_.push_back(all);
+	}
+
+	inUse_ = highWaterMark_ = failedLeases_ = 0;
+}
+
+int ParticlePool::lease(int count)
+{
+	if (count <= 0) return -1;
+	count = padLease(count);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	// take the first free range that is large enough
+	for (size_t i = 0; i < freeRanges_.size(); ++i)
+	{
+		Range& range = freeRanges_[i];
+		if (range.count_ < count) continue;
+
+		int first = range.first_;
+		range.first_ += count;
+		range.count_ -= count;
+		if (range.count_ == 0) freeRanges_.erase(freeRanges_.begin() + i);
+
+		inUse_ += count;
+		if (inUse_ > highWaterMark_) highWaterMark_ = inUse_;
+
+		return first;
+	}
+
+	++failedLeases_;
+	return -1;
+}
+
+void ParticlePool::returnLease(int first, int count)
+{
+	count = padLease(count);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	// find the place to keep the free ranges sorted
+	size_t i = 0;
+	while (i < freeRanges_.size() && freeRanges_[i].first_ < first) ++i;
+
+	Range range = { first, count };
+	freeRanges_.insert(freeRanges_.begin() + i, range);
+
+	// merge with the following and then with the preceding range if they touch
+	if (i + 1 < freeRanges_.size() && freeRanges_[i].first_ + freeRanges_[i].count_ == freeRanges_[i + 1].first_)
+	{
+		freeRanges_[i].count_ += freeRanges_[i + 1].count_;
+		freeRanges_.erase(freeRanges_.begin() + i + 1);
+	}
+	if (i > 0 && freeRanges_[i - 1].first_ + freeRanges_[i - 1].count_ == freeRanges_[i].first_)
+	{
+		freeRanges_[i - 1].count_ += freeRanges_[i].count_;
+		freeRanges_.erase(freeRanges_.begin() + i);
+	}
+
+	inUse_ -= count;
+}
+
+void ParticlePool::saveState(Snapshot& snapshot)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	snapshot.write(particles_.capacity());
+	snapshot.write(inUse_);
+	snapshot.write(highWaterMark_);
+	snapshot.write(failedLeases_);
+
+	snapshot.write(static_cast<int>(freeRanges_.size()));
+	if (!freeRanges_.empty()) snapshot.write(&freeRanges_[0], freeRanges_.size() * sizeof(Range));
+}
+
+void ParticlePool::restoreState(Snapshot& snapshot)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	int capacity = 0, ranges = 0;
+	snapshot.read(&capacity);
+	snapshot.read(&inUse_);
+	snapshot.read(&highWaterMark_);
+	snapshot.read(&failedLeases_);
+	snapshot.read(&ranges);
+
+	// the ranges have to fit into the pool
+	if (capacity != particles_.capacity() || ranges < 0 || ranges > capacity) snapshot.invalidate();
+	freeRanges_.resize(snapshot.valid() ? ranges : 0);
+	if (!freeRanges_.empty()) snapshot.read(&freeRanges_[0], freeRanges_.size() * sizeof(Range));
+
+	int end = 0;
+	for (size_t i = 0; i < freeRanges_.size(); ++i)
+	{
+		if (freeRanges_[i].first_ < end || freeRanges_[i].count_ <= 0 || freeRanges_[i].first_ + freeRanges_[i].count_ > capacity) snapshot.invalidate();
+		end = freeRanges_[i].first_ + freeRanges_[i].count_;
+	}
+
+	if (!snapshot.valid())
+	{
+		// everything is free again
+		freeRanges_.clear();
+		if (particles_.capacity() > 0)
+		{
+			Range all = { 0, particles_.capacity() };
+			freeRanges_.push_back(all);
+		}
+		inUse_ = highWaterMark_ = failedLeases_ = 0;
+	}
+}
@@ -0,0 +1,57 @@
+/*
+A single particle arena shared by all particle systems of the scene.
+Particle systems lease a contiguous range of particles when they become active and give it back when they are done,
+so the memory needed follows the number of particles alive at the same time instead of the sum of all maxima.
+*/
+
+#ifndef PARTICLE_POOL_H
+#define PARTICLE_POOL_H
+
+#include "ParticleStore.h"
+#include <vector>
+#include <mutex>
+
+class ParticlePool
+{
+public:
+	ParticlePool(void);
+	~ParticlePool(void);
+
+	void initialise(int budget);		// creates the arena with room for 'budget' particles, all of them free
+
+	// reserves 'count' particles and returns the index of the first one, or -1 if there is no range large enough (or
+	// 'count' is not positive, an empty lease would share its first particle with the lease of another system)
+	int lease(int count);
+	// gives a range obtained by lease() back to the pool
+	void returnLease(int first, int count);
+
+	ParticleStore& particles(void) {return particles_;}
+	int capacity(void) const {return particles_.capacity();}
+
+	// statistics, to size the budget for a show
+	int inUse(void) const {return inUse_;}					// particles currently leased
+	int highWaterMark(void) const {return highWaterMark_;}	// the most particles ever leased at the same time
+	int failedLeases(void) const {return failedLeases_;}	// number of leases that could not be served
+
+	// which particles are leased (not their attributes, these are saved by the systems holding the leases), the pool
+	// has to be initialised with the same budget before it is restored
+	void saveState(Snapshot& snapshot);
+	void restoreState(Snapshot& snapshot);
+
+private:
+	struct Range
+	{
+		int first_;
+		int count_;
+	};
+
+	ParticleStore particles_;
+	std::vector<Range> freeRanges_;		// sorted by their first particle, neighbouring ranges are always merged
+	std::mutex mutex_;					// leases may be requested while several rockets are updated at once
+
+	int inUse_;
+	int highWaterMark_;
+	int failedLeases_;
+};
+
+#endif
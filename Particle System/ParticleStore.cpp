@@ -0,0 +1,168 @@
+#include "ParticleStore.h"
+#include "EnvironmentalConstants.h"
+#include <string.h>
+#ifdef _WIN32
+#include <malloc.h>		// _aligned_malloc
+#else
+#include <stdlib.h>		// posix_memalign
+#endif
+
+
+// the arrays making up the store, in the order they are laid out in memory and written to snapshots
+static int* ParticleStore::* const intArrays[] = { &ParticleStore::id_, &ParticleStore::lifetime_ };
+static float* ParticleStore::* const floatArrays[] = { &ParticleStore::positionX_, &ParticleStore::positionY_, &ParticleStore::positionZ_,
+													   &ParticleStore::previousX_, &ParticleStore::previousY_, &ParticleStore::previousZ_,
+													   &ParticleStore::originX_, &ParticleStore::originY_, &ParticleStore::originZ_,
+													   &ParticleStore::velocityX_, &ParticleStore::velocityY_, &ParticleStore::velocityZ_,
+													   &ParticleStore::accelerationX_, &ParticleStore::accelerationY_, &ParticleStore::accelerationZ_,
+													   &ParticleStore::colourR_, &ParticleStore::colourG_, &ParticleStore::colourB_, &ParticleStore::colourA_,
+													   &ParticleStore::time_, &ParticleStore::size_ };
+
+static const int PARTICLE_STORE_INT_ARRAYS = sizeof(intArrays) / sizeof(intArrays[0]);
+static const int PARTICLE_STORE_FLOAT_ARRAYS = sizeof(floatArrays) / sizeof(floatArrays[0]);
+
+// memory aligned for the SIMD loads and stores of the integrator
+static void* allocateAligned(size_t bytes, size_t alignment)
+{
+#ifdef _WIN32
+	return _aligned_malloc(bytes, alignment);
+#else
+	void* memory;
+	return posix_memalign(&memory, alignment, bytes) == 0 ? memory : NULL;
+#endif
+}
+
+static void freeAligned(void* memory)
+{
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+ParticleStore::ParticleStore(void) : capacity_(0), memory_(NULL)
+{
+	release();
+}
+
+
+ParticleStore::~ParticleStore(void)
+{
+	release();
+}
+
+void ParticleStore::allocate(int capacity)
+{
+	release();
+
+	// round up so that every array is a whole number of SIMD registers long (and thus stays aligned)
+	capacity_ = (capacity + PARTICLE_STORE_PADDING - 1) / PARTICLE_STORE_PADDING * PARTICLE_STORE_PADDING;
+	if (capacity_ == 0) return;
+
+	size_t arrayBytes = capacity_ * sizeof(float);
+	memory_ = allocateAligned(arrayBytes * (PARTICLE_STORE_INT_ARRAYS + PARTICLE_STORE_FLOAT_ARRAYS), PARTICLE_STORE_ALIGNMENT);
+	SecureZeroMemory(memory_, arrayBytes * (PARTICLE_STORE_INT_ARRAYS + PARTICLE_STORE_FLOAT_ARRAYS));
+
+	char* p = static_cast<char*>(memory_);
+	for (int a = 0; a < PARTICLE_STORE_INT_ARRAYS; ++a)
+	{
+		this->*intArrays[a] = reinterpret_cast<int*>(p);
+		p += arrayBytes;
+	}
+	for (int a = 0; a < PARTICLE_STORE_FLOAT_ARRAYS; ++a)
+	{
+		this->*floatArrays[a] = reinterpret_cast<float*>(p);
+		p += arrayBytes;
+	}
+}
+
+void ParticleStore::release(void)
+{
+	if (memory_) freeAligned(memory_);
+	memory_ = NULL;
+	capacity_ = 0;
+
+	for (int a = 0; a < PARTICLE_STORE_INT_ARRAYS; ++a) this->*intArrays[a] = NULL;
+	for (int a = 0; a < PARTICLE_STORE_FLOAT_ARRAYS; ++a) this->*floatArrays[a] = NULL;
+}
+
+void ParticleStore::attach(ParticleStore& arena, int first, int capacity)
+{
+	release();
+
+	capacity_ = capacity;
+
+	for (int a = 0; a < PARTICLE_STORE_INT_ARRAYS; ++a) this->*intArrays[a] = arena.*intArrays[a] + first;
+	for (int a = 0; a < PARTICLE_STORE_FLOAT_ARRAYS; ++a) this->*floatArrays[a] = arena.*floatArrays[a] + first;
+}
+
+void ParticleStore::clear(int i)
+{
+	for (int a = 0; a < PARTICLE_STORE_INT_ARRAYS; ++a) (this->*intArrays[a])[i] = 0;
+	for (int a = 0; a < PARTICLE_STORE_FLOAT_ARRAYS; ++a) (this->*floatArrays[a])[i] = 0;
+}
+
+void ParticleStore::copy(int from, int to)
+{
+	for (int a = 0; a < PARTICLE_STORE_INT_ARRAYS; ++a)
+	{
+		int* array = this->*intArrays[a];
+		array[to] = array[from];
+	}
+	for (int a = 0; a < PARTICLE_STORE_FLOAT_ARRAYS; ++a)
+	{
+		float* array = this->*floatArrays[a];
+		array[to] = array[from];
+	}
+}
+
+void ParticleStore::copy(const ParticleStore& source, int first, int count)
+{
+	if (count <= 0) return;
+
+	for (int a = 0; a < PARTICLE_STORE_INT_ARRAYS; ++a)
+	{
+		memcpy(this->*intArrays[a] + first, source.*intArrays[a] + first, count * sizeof(int));
+	}
+	for (int a = 0; a < PARTICLE_STORE_FLOAT_ARRAYS; ++a)
+	{
+		memcpy(this->*floatArrays[a] + first, source.*floatArrays[a] + first, count * sizeof(float));
+	}
+}
+
+void ParticleStore::saveState(Snapshot& snapshot, int count) const
+{
+	if (count <= 0) return;
+
+	for (int a = 0; a < PARTICLE_STORE_INT_ARRAYS; ++a)
+	{
+		snapshot.write(this->*intArrays[a], count * sizeof(int));
+	}
+	for (int a = 0; a < PARTICLE_STORE_FLOAT_ARRAYS; ++a)
+	{
+		snapshot.write(this->*floatArrays[a], count * sizeof(float));
+	}
+}
+
+void ParticleStore::restoreState(Snapshot& snapshot, int count)
+{
+	if (count <= 0) return;
+
+	for (int a = 0; a < PARTICLE_STORE_INT_ARRAYS; ++a)
+	{
+		snapshot.read(this->*intArrays[a], count * sizeof(int));
+	}
+	for (int a = 0; a < PARTICLE_STORE_FLOAT_ARRAYS; ++a)
+	{
+		snapshot.read(this->*floatArrays[a], count * sizeof(float));
+	}
+}
+
+void ParticleStore::resetAcceleration(int i)
+{
+	// this is not physically correct but takes air drag into account to some extent
+	accelerationX_[i] = AIR_DRAG * velocityX_[i];
+	accelerationY_[i] = AIR_DRAG * velocityY_[i] + EARTH_GRAVITY;
+	accelerationZ_[i] = AIR_DRAG * velocityZ_[i];
+}
@@ -0,0 +1,98 @@
+/*
+Structure-of-arrays storage for the particles of a particle system.
+Every attribute lives in its own contiguous, aligned array so that the update and vertex loops only pull the
+attributes they actually read through the cache.
+*/
+
+#ifndef PARTICLE_STORE_H
+#define PARTICLE_STORE_H
+
+#include "Direct3DTypes.h"
+#include "Snapshot.h"
+
+// alignment of every attribute array in bytes (wide enough for 8 floats)
+const int PARTICLE_STORE_ALIGNMENT = 32;
+
+// the capacity is rounded up to a multiple of this, so vectorised loops never need to handle a partial tail
+const int PARTICLE_STORE_PADDING = 8;
+
+class ParticleStore
+{
+public:
+	ParticleStore(void);
+	~ParticleStore(void);
+
+	void allocate(int capacity);		// (re)creates the arrays with room for 'capacity' particles, all of them dead
+	void release(void);					// frees the arrays (or detaches from the arena)
+
+	// uses the particles [first, first + capacity) of another store instead of arrays of its own, the arena keeps
+	// owning the memory ('first' should be a multiple of PARTICLE_STORE_PADDING to keep the arrays aligned)
+	void attach(ParticleStore& arena, int first, int capacity);
+	int capacity(void) const {return capacity_;}
+
+	void clear(int i);					// resets all attributes of a single particle to zero
+	void copy(int from, int to);		// copies all attributes of one particle into another slot
+	// copies all attributes of the particles [first, first + count) of another store into the same slots of this one
+	void copy(const ParticleStore& source, int first, int count);
+
+	// writes (or reads back) all attributes of the particles [0, count), array by array
+	void saveState(Snapshot& snapshot, int count) const;
+	void restoreState(Snapshot& snapshot, int count);
+
+	// convenience accessors for code that works on a single particle
+	D3DXVECTOR3 getPosition(int i) const {return D3DXVECTOR3(positionX_[i], positionY_[i], positionZ_[i]);}
+	D3DXVECTOR3 getOrigin(int i) const {return D3DXVECTOR3(originX_[i], originY_[i], originZ_[i]);}
+	D3DXVECTOR3 getVelocity(int i) const {return D3DXVECTOR3(velocityX_[i], velocityY_[i], velocityZ_[i]);}
+	D3DXCOLOR getColour(int i) const {return D3DXCOLOR(colourR_[i], colourG_[i], colourB_[i], colourA_[i]);}
+
+	D3DXVECTOR3 getPreviousPosition(int i) const {return D3DXVECTOR3(previousX_[i], previousY_[i], previousZ_[i]);}
+
+	// places the particle at the given position (without any movement from its previous position to be interpolated)
+	void setPosition(int i, const D3DXVECTOR3& v) {positionX_[i] = previousX_[i] = v.x; positionY_[i] = previousY_[i] = v.y; positionZ_[i] = previousZ_[i] = v.z;}
+	// moves the particle to the given position during a simulation step (the current position becomes the previous one)
+	void movePosition(int i, const D3DXVECTOR3& v) {storePreviousPosition(i); positionX_[i] = v.x; positionY_[i] = v.y; positionZ_[i] = v.z;}
+	void setOrigin(int i, const D3DXVECTOR3& v) {originX_[i] = v.x; originY_[i] = v.y; originZ_[i] = v.z;}
+	void setVelocity(int i, const D3DXVECTOR3& v) {velocityX_[i] = v.x; velocityY_[i] = v.y; velocityZ_[i] = v.z;}
+	void setColour(int i, const D3DXCOLOR& c) {colourR_[i] = c.r; colourG_[i] = c.g; colourB_[i] = c.b; colourA_[i] = c.a;}
+
+	// sets the acceleration resulting from the environmental influences for the current velocity
+	void resetAcceleration(int i);
+
+	// remembers the current position before the particle is moved by a simulation step
+	void storePreviousPosition(int i) {previousX_[i] = positionX_[i]; previousY_[i] = positionY_[i]; previousZ_[i] = positionZ_[i];}
+
+	// (every array is listed in the tables at the top of ParticleStore.cpp, which allocation, copies and snapshots go by)
+	int*	id_;				// used to distinguish between particles belonging to different subsystems
+	int*	lifetime_;			// how many simulation steps is the particle rendered
+	float*	positionX_;			// the current position of the particle
+	float*	positionY_;
+	float*	positionZ_;
+	float*	previousX_;			// the position before the last simulation step (rendering interpolates between both)
+	float*	previousY_;
+	float*	previousZ_;
+	float*	originX_;			// the origin of the particle (the position where it was originally created)
+	float*	originY_;
+	float*	originZ_;
+	float*	velocityX_;			// the velocity of the particle
+	float*	velocityY_;
+	float*	velocityZ_;
+	float*	accelerationX_;		// acceleration of the particle (calculated from the velocity taking environmental influence into account)
+	float*	accelerationY_;
+	float*	accelerationZ_;
+	float*	colourR_;			// the current colour of the particle
+	float*	colourG_;
+	float*	colourB_;
+	float*	colourA_;
+	float*	time_;				// how long the particle is alive
+	float*	size_;				// the size of the particle
+
+private:
+	int capacity_;
+	void* memory_;				// a single allocation, split up into the attribute arrays above (NULL if attached to an arena)
+
+	// the arrays are owned by the store, so it must not be copied
+	ParticleStore(const ParticleStore&);
+	ParticleStore& operator=(const ParticleStore&);
+};
+
+#endif
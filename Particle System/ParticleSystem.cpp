@@ -1,34 +1,38 @@
 #include "ParticleSystem.h"
+#include "ColourPacking.h"
+#include <algorithm>
+#include <string.h>
+#include <emmintrin.h>	// SSE2 (non-temporal stores)
 
 
-ParticleSystem::ParticleSystem(void) : maxParticles_(0), startParticles_(0), particlesAlive_(0), maxLifetime_(0), origin_(D3DXVECTOR3(0, 0, 0)), points_(NULL), maxParticleSize_(1.0f)
+ParticleSystem::ParticleSystem(void) : maxParticles_(0), startParticles_(0), particlesAlive_(0), maxLifetime_(0), particleTexture_(NULL), origin_(D3DXVECTOR3(0, 0, 0)),
+	startCountdown_(0), startIntervalSteps_(0), timeIncrement_(0), maxParticleSize_(1.0f),
+	particlePool_(NULL), leaseFirst_(-1), vertexRing_(NULL), vertexOffset_(0), vertexCount_(0), vertexFrame_(0), renderBackend_(NULL),
+	flickerSeed_(0), steps_(0), jobSystem_(NULL), prebuiltCount_(0), prebuilding_(0)
 {
 }
 
 
 ParticleSystem::~ParticleSystem(void)
 {
-	SAFE_RELEASE(points_);
+	waitForPrebuild();
 }
 
-HRESULT ParticleSystem::initialise(LPDIRECT3DDEVICE9 device)
+HRESULT ParticleSystem::initialise(RenderBackend* renderBackend, VertexRing* vertexRing, ParticlePool* particlePool, JobSystem* jobSystem)
 {
-	// Store the render target for later use...
-	renderTarget_ = device;
-			
-	Particle p;
-	reset_particle(p);
-	particles_.resize(maxParticles_, p);	// Create a vector of empty particles - make 'max_particles_' copies of particle 'p'.
+	// Store the render backend for later use...
+	renderBackend_ = renderBackend;
 
-	// Create a vertex buffer for the particles (each particule represented as an individual vertex).
-	int buffer_size = maxParticles_ * sizeof(POINTVERTEX);
+	// the points are written into the vertex buffer shared by all systems (each particle represented as an individual vertex)
+	vertexRing_ = vertexRing;
+	vertexCount_ = 0;
+			
+	// the storage for 'max_particles_' particles is leased from the pool once the system becomes active
+	particlePool_ = particlePool;
+	jobSystem_ = jobSystem;
 
-	// The data in the buffer doesn't exist at this point, but the memory space
-	// is allocated and the pointer to it (g_pPointBuffer) also exists.
-	if (FAILED(device -> CreateVertexBuffer(buffer_size, 0, D3DFVF_POINTVERTEX, D3DPOOL_DEFAULT, &points_, NULL)))
-	{
-		return E_FAIL; // Return if the vertex buffer culd not be created.
-	}
+	diedParticles_.resize(maxParticles_);
+	flicker_.resize(maxParticles_);
 
 	return S_OK;
 }
@@ -37,72 +41,348 @@ HRESULT ParticleSystem::initialise(LPDIRECT3DDEVICE9 device)
 // this is pretty much a default implementation for rendering
 void ParticleSystem::render()
 {
-	// Enable point sprites, and set the size of the point.
-	renderTarget_	-> SetRenderState(D3DRS_POINTSPRITEENABLE, true);
-	renderTarget_  -> SetRenderState(D3DRS_POINTSCALEENABLE,  true);
+	// nothing to draw, don't bind anything either
+	if (!hasVertices()) return;
+
+	// draw the points with the colour and alpha of the texture
+	renderBackend_ -> bindPoints(TexturedPoints, particleTexture_, maxParticleSize_);
+	renderBackend_ -> drawPoints(vertexOffset_, vertexCount_);
+	renderBackend_ -> unbindPoints();
+}
+
+void ParticleSystem::saveState(Snapshot& snapshot) const
+{
+	waitForPrebuild();
+
+	snapshot.write(maxParticles_);
+	snapshot.write(leaseFirst_);
+	snapshot.write(particlesAlive_);
+	snapshot.write(startCountdown_);
+	snapshot.write(origin_);
+	random_.saveState(snapshot);
+	snapshot.write(flickerSeed_);
+	snapshot.write(steps_);
+
+	particles_.saveState(snapshot, particlesAlive_);
+
+	snapshot.write(prebuiltCount_);
+	prebuilt_.saveState(snapshot, prebuiltCount_);
+}
+
+void ParticleSystem::restoreState(Snapshot& snapshot)
+{
+	waitForPrebuild();
+
+	int maxParticles = 0, leaseFirst = -1, particlesAlive = 0, prebuiltCount = 0;
+	snapshot.read(&maxParticles);
+	snapshot.read(&leaseFirst);
+	snapshot.read(&particlesAlive);
+	snapshot.read(&startCountdown_);
+	snapshot.read(&origin_);
+	random_.restoreState(snapshot);
+	snapshot.read(&flickerSeed_);
+	snapshot.read(&steps_);
+
+	// the particles have to lie within a lease of the pool
+	if (maxParticles != maxParticles_ || particlesAlive < 0 || particlesAlive > maxParticles_ ||
+		(leaseFirst < 0 && particlesAlive > 0) ||
+		(leaseFirst >= 0 && (leaseFirst % PARTICLE_STORE_PADDING != 0 || leaseFirst + maxParticles_ > particlePool_ -> capacity())))
+	{
+		snapshot.invalidate();
+	}
+
+	// the pool already knows the range is leased, it has been restored before
+	particles_.release();
+	leaseFirst_ = -1;
+	particlesAlive_ = 0;
+	vertexCount_ = 0;
+	discardPrebuiltBatch();
+	if (!snapshot.valid()) return;
+
+	if (leaseFirst >= 0)
+	{
+		particles_.attach(particlePool_ -> particles(), leaseFirst, maxParticles_);
+		particles_.restoreState(snapshot, particlesAlive);
+		leaseFirst_ = leaseFirst;
+		particlesAlive_ = snapshot.valid() ? particlesAlive : 0;
+	}
+
+	snapshot.read(&prebuiltCount);
+	if (prebuiltCount < 0 || prebuiltCount > maxParticles_) snapshot.invalidate();
+	if (!snapshot.valid() || prebuiltCount == 0) return;
+
+	prebuilt_.allocate(prebuiltCount);
+	prebuilt_.restoreState(snapshot, prebuiltCount);
+	prebuiltCount_ = snapshot.valid() ? prebuiltCount : 0;
+}
+
+bool ParticleSystem::leaseParticles()
+{
+	if (leaseFirst_ >= 0) return true;
+	waitForPrebuild();
+
+	leaseFirst_ = particlePool_ -> lease(maxParticles_);
+	if (leaseFirst_ < 0) return false;
+
+	particles_.attach(particlePool_ -> particles(), leaseFirst_, maxParticles_);
+	particlesAlive_ = 0;
+
+	return true;
+}
+
+void ParticleSystem::returnParticles()
+{
+	if (leaseFirst_ < 0) return;
+	waitForPrebuild();
 
-	// Disable z buffer while rendering the particles. Makes rendering quicker and
-	// stops any visual (alpha) 'artefacts' on screen while rendering.
-	renderTarget_ -> SetRenderState(D3DRS_ZENABLE, false);
-		    
-	// Scale the points according to distance...
-	renderTarget_ -> SetRenderState(D3DRS_POINTSIZE,     FtoDW(maxParticleSize_));
-	renderTarget_ -> SetRenderState(D3DRS_POINTSIZE_MIN, FtoDW(0.00f));
-	renderTarget_ -> SetRenderState(D3DRS_POINTSCALE_A,  FtoDW(0.00f));
-	renderTarget_ -> SetRenderState(D3DRS_POINTSCALE_B,  FtoDW(0.00f));
-	renderTarget_ -> SetRenderState(D3DRS_POINTSCALE_C,  FtoDW(1.00f));
+	particles_.release();
+	particlePool_ -> returnLease(leaseFirst_, maxParticles_);
+	leaseFirst_ = -1;
 
-	// Now select the texture for the points...
-	// Use texture colour and alpha components.
-	renderTarget_ -> SetTexture(0, particleTexture_);
-	renderTarget_ -> SetRenderState(D3DRS_ALPHABLENDENABLE, true);
-	renderTarget_ -> SetRenderState(D3DRS_SRCBLEND,  D3DBLEND_SRCALPHA);
-	renderTarget_ -> SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+	particlesAlive_ = 0;
+	vertexCount_ = 0;
+}
 
-	renderTarget_ -> SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
-	renderTarget_ -> SetTextureStageState(0, D3DTSS_COLOROP,	D3DTOP_SELECTARG1);
+int ParticleSystem::allocateParticle()
+{
+	if (particlesAlive_ >= maxParticles_) return -1;
 
-	renderTarget_ -> SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
-	renderTarget_ -> SetTextureStageState(0, D3DTSS_ALPHAOP,   D3DTOP_SELECTARG1);
+	return particlesAlive_++;
+}
 
-	// Render the contents of the vertex buffer.
-	renderTarget_ -> SetStreamSource(0, points_, 0, sizeof(POINTVERTEX));
-	renderTarget_ -> SetFVF(D3DFVF_POINTVERTEX);
-	renderTarget_ -> DrawPrimitive(D3DPT_POINTLIST, 0, particlesAlive_);
+int ParticleSystem::allocateParticles(int count)
+{
+	if (count > maxParticles_ - particlesAlive_) count = maxParticles_ - particlesAlive_;
+	if (count < 0) count = 0;
 
-	// Reset the render states.
-	renderTarget_ -> SetRenderState(D3DRS_POINTSPRITEENABLE, false);
-	renderTarget_ -> SetRenderState(D3DRS_POINTSCALEENABLE,  false);
-	renderTarget_ -> SetRenderState(D3DRS_ALPHABLENDENABLE,  false);
-	renderTarget_ -> SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
-	renderTarget_ -> SetRenderState(D3DRS_ZENABLE, D3DZB_TRUE);
+	particlesAlive_ += count;
+	return count;
 }
 
-std::vector<Particle>::iterator ParticleSystem::findNextDeadParticle()
+void ParticleSystem::releaseParticles(const int* died, int count)
 {
-	return std::find_if(particles_.begin(), particles_.end(), isParticleDead());
+	// Fill the gap left by each dead particle with the last living one. Going from the highest index downwards
+	// guarantees that the last particle is never one of the dead particles that still need to be removed.
+	for (int i = count - 1; i >= 0; --i)
+	{
+		--particlesAlive_;
+
+		if (died[i] != particlesAlive_)
+		{
+			particles_.copy(particlesAlive_, died[i]);
+		}
+	}
+}
+
+void ParticleSystem::emitVertices(float alpha)
+{
+	// the vertices of this frame may have been written while the particles were stepped already
+	if (hasVertices()) return;
+
+	vertexCount_ = 0;
+	if (particlesAlive_ == 0) return;
+
+	POINTVERTEX *points = reservePoints(particlesAlive_);
+	if (points == NULL) return;
+
+	writePoints(points, 0, particlesAlive_, alpha);
+	_mm_sfence();
+}
+
+POINTVERTEX* ParticleSystem::reservePoints(int count)
+{
+	// Get a pointer to the first vertex of the range reserved for this system in the shared buffer
+	// (the ring keeps the buffer locked while the vertices of all particle systems are written).
+	POINTVERTEX *points = vertexRing_ -> append(count, &vertexOffset_);
+	if (points == NULL) return NULL;
+
+	vertexCount_ = count;
+	vertexFrame_ = vertexRing_ -> frame();
+
+	// let the particles flicker by scaling their size with a random factor (the same for every frame of a step)
+	flickerRandom_.seed(hash_numbers(flickerSeed_, steps_));
+	flickerRandom_.fill(&flicker_[0], count, 0.0f, 1.0f);
+
+	return points;
+}
+
+// stores a value without reading the cache line it belongs to (or keeping it in the cache)
+static void streamValue(void* destination, float value)
+{
+	int bits;
+	memcpy(&bits, &value, sizeof(bits));
+	_mm_stream_si32(static_cast<int*>(destination), bits);
+}
+
+static void streamValue(void* destination, DWORD value)
+{
+	_mm_stream_si32(static_cast<int*>(destination), static_cast<int>(value));
+}
+
+void ParticleSystem::writePoint(POINTVERTEX* point, int i, float alpha)
+{
+	streamValue(&point -> position_.x, particles_.previousX_[i] + (particles_.positionX_[i] - particles_.previousX_[i]) * alpha);
+	streamValue(&point -> position_.y, particles_.previousY_[i] + (particles_.positionY_[i] - particles_.previousY_[i]) * alpha);
+	streamValue(&point -> position_.z, particles_.previousZ_[i] + (particles_.positionZ_[i] - particles_.previousZ_[i]) * alpha);
+
+	// a particle that died in the step it was written in is still there, but covers nothing
+	bool alive = particles_.lifetime_[i] > 0;
+	streamValue(&point -> size_, alive ? flicker_[i] * particles_.size_[i] : 0.0f);
+	streamValue(&point -> color_, alive ? packColour(particles_.colourR_[i], particles_.colourG_[i], particles_.colourB_[i], particles_.colourA_[i]) : static_cast<DWORD>(0));
+}
+
+void ParticleSystem::writePoints(POINTVERTEX* points, int first, int count, float alpha)
+{
+	// The stream is write-combined memory the CPU never reads back, so the vertices are written around the cache.
+	// 4 vertices are 80 bytes, which are written as 5 aligned blocks of 16 bytes once the first vertex of the 4 starts
+	// on a 16 byte boundary (one of any 4 consecutive vertices does), the rest one value at a time.
+	int i = first, end = first + count;
+	for (; i < end && (reinterpret_cast<size_t>(points + i) & 15) != 0; ++i)
+	{
+		writePoint(points + i, i, alpha);
+	}
+
+	// the same operations in the same order as writePoint, so the results are identical
+	const __m128 interpolation = _mm_set1_ps(alpha);
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 alive = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(particles_.lifetime_ + i)), zero));
+
+		__m128 previousX = _mm_loadu_ps(particles_.previousX_ + i);
+		__m128 previousY = _mm_loadu_ps(particles_.previousY_ + i);
+		__m128 previousZ = _mm_loadu_ps(particles_.previousZ_ + i);
+		__m128 x = _mm_add_ps(previousX, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(particles_.positionX_ + i), previousX), interpolation));
+		__m128 y = _mm_add_ps(previousY, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(particles_.positionY_ + i), previousY), interpolation));
+		__m128 z = _mm_add_ps(previousZ, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(particles_.positionZ_ + i), previousZ), interpolation));
+		__m128 size = _mm_and_ps(alive, _mm_mul_ps(_mm_loadu_ps(&flicker_[i]), _mm_loadu_ps(particles_.size_ + i)));
+
+		__m128i packed = packColours(_mm_loadu_ps(particles_.colourR_ + i), _mm_loadu_ps(particles_.colourG_ + i),
+									 _mm_loadu_ps(particles_.colourB_ + i), _mm_loadu_ps(particles_.colourA_ + i));
+		__m128 colour = _mm_and_ps(alive, _mm_castsi128_ps(packed));
+
+		// from 5 values of 4 vertices to 4 vertices of 5 values: x0 y0 z0 s0 | c0 x1 y1 z1 | s1 c1 x2 y2 | z2 s2 c2 x3 | y3 z3 s3 c3
+		_MM_TRANSPOSE4_PS(x, y, z, size);
+		__m128 block1 = _mm_move_ss(_mm_shuffle_ps(y, y, _MM_SHUFFLE(2, 1, 0, 3)), colour);
+		__m128 block2 = _mm_shuffle_ps(_mm_shuffle_ps(y, colour, _MM_SHUFFLE(1, 1, 3, 3)), z, _MM_SHUFFLE(1, 0, 2, 0));
+		__m128 block3 = _mm_shuffle_ps(z, _mm_shuffle_ps(colour, size, _MM_SHUFFLE(0, 0, 2, 2)), _MM_SHUFFLE(2, 0, 3, 2));
+		__m128 block4 = _mm_shuffle_ps(size, _mm_shuffle_ps(size, colour, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 1));
+
+		float* destination = reinterpret_cast<float*>(points + i);
+		_mm_stream_ps(destination, x);
+		_mm_stream_ps(destination + 4, block1);
+		_mm_stream_ps(destination + 8, block2);
+		_mm_stream_ps(destination + 12, block3);
+		_mm_stream_ps(destination + 16, block4);
+	}
+
+	for (; i < end; ++i)
+	{
+		writePoint(points + i, i, alpha);
+	}
+}
+
+bool ParticleSystem::hasVertices() const
+{
+	// a range from an earlier frame may already have been overwritten
+	return vertexCount_ > 0 && vertexFrame_ == vertexRing_ -> frame();
 }
 
 // virtual function
 void ParticleSystem::startParticles()
 {
+	waitForPrebuild();
+
 	// Only start a new particle when the time is right and there are enough dead (inactive) particles.
-	if (startTimer_ == 0 && particlesAlive_ < maxParticles_)
+	if (startCountdown_ == 0 && particlesAlive_ < maxParticles_)
 	{
-		// Number of particles to start in this batch...
-		for (int i(0); i < startParticles_; ++i)
-		{
-			if (particlesAlive_ < maxParticles_) startSingleParticle(findNextDeadParticle());
-		}
+		// Number of particles to start in this batch (as many as there are dead particles)...
+		int first = particlesAlive_;
+		startBatch(first, allocateParticles(startParticles_));
 
 		// Reset the start timer for the next batch of particles.
-		startTimer_ = startInterval_;
+		startCountdown_ = startIntervalSteps_;
 	}
-	else
+	else if (startCountdown_ >= 0)
 	{
-		// Otherwise decrease the start timer.
-		--startTimer_;
+		// Otherwise count down (once below zero the count stays there).
+		--startCountdown_;
 	}
 }
 
-		
\ No newline at end of file
+// virtual function
+bool ParticleSystem::startsParticles() const
+{
+	// the count down is only reset when it reaches zero, once it is below zero no batch is started any more
+	return startCountdown_ >= 0;
+}
+
+void ParticleSystem::prebuildBatch()
+{
+	waitForPrebuild();
+	discardPrebuiltBatch();
+
+	// the system is not active, so nothing else uses the particle store or the random numbers until the batch is started
+	if (leaseFirst_ >= 0) return;
+
+	auto build = [this] {
+		int count = std::max(std::min(startParticles_, maxParticles_), 0);
+		if (count == 0) return;
+
+		// start the batch as the first one of the system, but into a store of its own
+		prebuilt_.allocate(count);
+		particles_.attach(prebuilt_, 0, count);
+		startParticleBatch(0, count);
+		particles_.release();
+
+		prebuiltCount_ = count;
+	};
+
+	if (jobSystem_) jobSystem_ -> submit(build, &prebuilding_);
+	else build();
+}
+
+void ParticleSystem::waitForPrebuild() const
+{
+	if (jobSystem_) jobSystem_ -> wait(&prebuilding_);
+}
+
+void ParticleSystem::discardPrebuiltBatch()
+{
+	prebuilt_.release();
+	prebuiltCount_ = 0;
+}
+
+void ParticleSystem::startBatch(int first, int count)
+{
+	if (prebuiltCount_ == 0 || first != 0 || count != prebuiltCount_)
+	{
+		// (a batch prebuilt for other particles is of no use any more)
+		discardPrebuiltBatch();
+		startParticleBatch(first, count);
+		return;
+	}
+
+	// every particle of a batch starts at the origin of the system
+	particles_.copy(prebuilt_, 0, count);
+	std::fill(particles_.positionX_, particles_.positionX_ + count, origin_.x);
+	std::fill(particles_.positionY_, particles_.positionY_ + count, origin_.y);
+	std::fill(particles_.positionZ_, particles_.positionZ_ + count, origin_.z);
+	std::fill(particles_.previousX_, particles_.previousX_ + count, origin_.x);
+	std::fill(particles_.previousY_, particles_.previousY_ + count, origin_.y);
+	std::fill(particles_.previousZ_, particles_.previousZ_ + count, origin_.z);
+	std::fill(particles_.originX_, particles_.originX_ + count, origin_.x);
+	std::fill(particles_.originY_, particles_.originY_ + count, origin_.y);
+	std::fill(particles_.originZ_, particles_.originZ_ + count, origin_.z);
+
+	discardPrebuiltBatch();
+}
+
+// virtual function
+void ParticleSystem::startParticleBatch(int first, int count)
+{
+	for (int p = first; p < first + count; ++p)
+	{
+		startSingleParticle(p);
+	}
+}
@@ -5,11 +5,17 @@ The base class for all particle systems. Mostly copied from the blackboard examp
 #ifndef PARTICLE_SYSTEM_H
 #define PARTICLE_SYSTEM_H
 
-#include <d3dx9.h>		// Direct 3D library (for all Direct 3D funtions).
-#include <vector>
-#include <algorithm>
-#include <functional>
+#include "Direct3DTypes.h"
 #include "ParticleData.h"
+#include "ParticleStore.h"
+#include "VertexRing.h"
+#include "RenderBackend.h"
+#include "ParticlePool.h"
+#include "RandomEngine.h"
+#include "JobSystem.h"
+#include "SimulationClock.h"
+#include "Snapshot.h"
+#include <vector>
 #include "Helpers.h"
 
 class ParticleSystem
@@ -19,44 +25,92 @@ public:
 	int startParticles_;					// Number of particles to start in each batch.
 
 	int particlesAlive_;					// The number of particles that are currently alive.
-	int maxLifetime_;					    // The start age of each particle (count down from this, kill particle when zero).
+	float maxLifetime_;					    // The start age of each particle in seconds (count down from this, kill particle when zero).
 
-	LPDIRECT3DTEXTURE9 particleTexture_;	// The texture for the points.				
+	RenderTexture particleTexture_;			// The texture for the points (loaded by the render backend).				
 	D3DXVECTOR3 origin_;					// Vectors for origin of the particle system.
 
-	int startTimer_;						// Count-down timer, start another particle when zero.		
-	int startInterval_;		     			// Interval between starting a new particle (used to initialise 'start_timer_').
-	float timeIncrement_;					// Used to increase the value of 'time'for each particle - used to calculate vertical position.
+	int startCountdown_;					// Count-down in simulation steps, start another batch when zero (below zero: never again).
+	int startIntervalSteps_;				// Steps between two batches (used to initialise 'startCountdown_'), below zero for a single batch.
+	float timeIncrement_;					// Used to increase the value of 'time' for each particle in every simulation step - used to calculate vertical position.
 
 	float maxParticleSize_;					// Size of the point.
 
 	ParticleSystem(void);
-	~ParticleSystem(void);
-	HRESULT initialise(LPDIRECT3DDEVICE9 device);
-	virtual void update(void) = 0;			// Specific implementations to provide this - this is to update the positions of the particles.
+	virtual ~ParticleSystem(void);
+	HRESULT initialise(RenderBackend* renderBackend, VertexRing* vertexRing, ParticlePool* particlePool, JobSystem* jobSystem);
+	virtual void update(void) = 0;			// Specific implementations to provide this - this is to update the positions of the particles (one simulation step).
+	void step(void) {++steps_; update();}	// a single simulation step, counted (for the flicker of the points)
+	void emitVertices(float alpha);			// writes the points to the shared vertex buffer, interpolated between the last two steps by 'alpha'
 	virtual void render(void);								
 
-private:
-	
-	class isParticleDead			// This is a private class, only available inside 'PARTICLE_SYSTEM_BASE' - functor to determine if a particle is alive or dead.
-	{	
-		public:	
-			bool operator()(const Particle &p)
-			{
-				return p.lifetime_ == 0;
-			}
-	};
+	// The particles are leased from the pool while the system is active. Returns false if the pool has no room left.
+	bool leaseParticles(void);
+	void returnParticles(void);		// gives the particles back to the pool, all particles die
+	bool hasParticles(void) const {return leaseFirst_ >= 0;}
+
+	// A system is idle once all its particles died and it won't start any new ones (until it is reset). Idle systems
+	// need neither be updated, nor written to the vertex buffer, nor rendered.
+	bool isIdle(void) const {return particlesAlive_ == 0 && !startsParticles();}
+
+	// Starts the particles of the first batch ahead of time (on a worker if there is a job system) into a store of
+	// their own, while the system is not active yet. The first batch started later on is copied from there instead
+	// (and placed at the origin the system has by then). The random numbers are taken in the same order as without.
+	void prebuildBatch(void);
+	// until the batch is built (every method using the store, the random numbers or the batch calls it first)
+	void waitForPrebuild(void) const;
+
+	void seedRandom(unsigned int seed) {random_.seed(seed); flickerSeed_ = ~seed;}	// the same seed gives the same particles every time
+
+	// Everything the next simulation steps depend on: the lease, the living particles, the timers and the random
+	// numbers. Restoring needs the system to be initialised (with the pool the state was saved from) first.
+	virtual void saveState(Snapshot& snapshot) const;
+	virtual void restoreState(Snapshot& snapshot);
 
 protected:
-	std::vector<Particle>	particles_;
-	LPDIRECT3DVERTEXBUFFER9 points_;  // Vertex buffer for the points.
-	LPDIRECT3DDEVICE9		renderTarget_;
-		
-	std::vector<Particle>::iterator findNextDeadParticle();
+	ParticleStore			particles_;			// attached to the leased range of the pool
+	ParticlePool*			particlePool_;
+	int						leaseFirst_;		// the first particle of the pool leased by this system, -1 if none
+	VertexRing*				vertexRing_;		// the vertex buffer shared by all particle systems
+	int						vertexOffset_;		// the range of the shared vertex buffer holding the points of this system
+	int						vertexCount_;
+	unsigned int			vertexFrame_;		// the frame of the vertex ring the range is valid for
+	RenderBackend*			renderBackend_;		// draws the points (may be NULL if the system is never rendered)
+	std::vector<int>		diedParticles_;		// indices of the particles that died during the current update
+	RandomEngine			random_;			// all randomness of the simulation of this system comes from here
+	RandomEngine			flickerRandom_;		// used while rendering only, seeded anew from the step (so the frame rate changes neither the simulation nor the flicker)
+	unsigned int			flickerSeed_;
+	unsigned int			steps_;				// the simulation steps taken
+	JobSystem*				jobSystem_;			// large systems are updated in chunks on several threads (may be NULL)
+	std::vector<float>		flicker_;			// random size factors for the points, created in one go for every update
+	ParticleStore			prebuilt_;			// the first batch, started ahead of time
+	int						prebuiltCount_;
+	mutable JobSystem::Counter	prebuilding_;	// the job building the batch (waited for by saveState as well)
+
+	// The living particles are always packed at the front of the store (indices 0 to particlesAlive_ - 1).
+	int allocateParticle();			// appends a particle (in O(1)) and counts it as alive, returns -1 if all particles are alive
+	int allocateParticles(int count);	// appends up to 'count' particles behind the living ones, returns how many
+	void releaseParticles(const int* died, int count);	// removes the dead particles given by their (ascending) indices
 	virtual void startParticles();
+	virtual bool startsParticles() const;	// whether startParticles may still start particles in a later step
+	void startBatch(int first, int count);	// starts the particles just allocated, using the prebuilt batch if there is one
+	void discardPrebuiltBatch(void);
+	bool hasVertices() const;		// whether there are points to draw in the current frame
+
+	// reserves the range of the vertex ring for 'count' points (and their flicker) in the current frame
+	POINTVERTEX* reservePoints(int count);
+	// Writes the points of the particles [first, first + count) to their place in the range reserved for all of them
+	// (using non-temporal stores, the caller has to fence them). Particles that have just died are written with a size
+	// and a colour of zero.
+	void writePoints(POINTVERTEX* points, int first, int count, float alpha);
+	void writePoint(POINTVERTEX* point, int i, float alpha);
+
+	// Specific implemention to define to policy for starting/creating a single particle (given by its index).
+	virtual void startSingleParticle(int p) = 0;
 
-	// Specific implemention to define to policy for starting/creating a single particle.
-	virtual void startSingleParticle(std::vector<Particle>::iterator &) = 0;
+	// Starts the particles [first, first + count) that have just been allocated together. By default every particle is
+	// started on its own, systems can override this to initialise the whole batch at once.
+	virtual void startParticleBatch(int first, int count);
 };
 
 #endif
\ No newline at end of file
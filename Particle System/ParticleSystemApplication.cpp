@@ -9,12 +9,14 @@ In this file, DirectX is set up and the different rockets/particle systems are c
 #include "Rocket.h"
 #include "Helpers.h"
 #include <vector>
-#include "EffectStar.h"
-#include "EffectCone.h"
-#include "EffectMultiSphere.h"
-#include "EffectRays.h"
+#include "Show.h"
 #include <thread>
-#include "FireworksTimer.h"
+#include <stdio.h>
+#include <time.h>
+#include "JobSystem.h"
+#include "SimulationClock.h"
+#include "LaunchScheduler.h"
+#include "D3D9RenderBackend.h"
 
 using namespace std;
 
@@ -24,38 +26,31 @@ using namespace std;
 
 LPDIRECT3D9             d3d = NULL;	// Used to create the device
 LPDIRECT3DDEVICE9       device = NULL;	// The rendering device
+RenderBackend*          renderBackend = NULL;	// draws the particle systems with the device
 
-// these particle systems are the effects that will be shown as the rockets explode
-EffectSphere effectSpheres[6];
-EffectStar effectStars[5];
-EffectCone effectCones[2];
-EffectMultiSphere effectMultiSpheres[1];
-EffectRays effectRays[1];
+// the rockets of the show with their particle systems, created from the show file
+Show show;
+const char* showFile = "Fireworks.show";
+const char* compiledShowFile = "Fireworks.showbin";	// the compiled form of the show file, rebuilt when that changes
 
-// these particle systems are the same for every rocket
-Projectile projectiles[15];		// the projectile particle system fires just a single particle depicting the actual rocket
-ProjectileTrace traces[15];		// the projectile trace simulates spark of the rocket's jet/thruster
+// the particles of all particle systems, leased by the systems while they are active
+ParticlePool particlePool;
+int particleBudget = 32 * 1024;	// the most particles alive at the same time (see the statistics reported on exit)
 
-// each rocket hold three particle systems: a Projectile, a ProjectileTrace and an effect
-Rocket rockets[15];
+// the vertex buffer all particle systems write their points to
+VertexRing vertexRing;
 
-// start times for the different rockets, will be used by the FireworksTimer
-float rocketStartTimes[15] = { 2000.0f,
-							  4000.0f, 4000.0f, 4000.0f, 4000.0f,
-							  6000.0f, 6500.0f, 7000.0f, 7500.0f, 8000.0f,
-							  10000.0f, 10000.0f, 10000.0f,
-							  12000.0f,
-							  16000.0f };
+// updates the rockets in parallel
+JobSystem jobSystem;
 
-int numberOfRockets = 15;
+// decides how many simulation steps are run for each rendered frame
+SimulationClock simulationClock;
 
-// pointers to the different textures that can be used for the point sprites
-LPDIRECT3DTEXTURE9	particle_circle = NULL;		// mostly used
-LPDIRECT3DTEXTURE9	particle_star = NULL;		// rarely used
-LPDIRECT3DTEXTURE9	particle_diamond = NULL;		// currently not used 
+// fires the rockets at their start times (on the simulation clock) and starts the show over when all have been fired
+LaunchScheduler launchScheduler;
 
-// used for communication with the timer thread
-bool doRun; // set to false whent he application is about to shut down
+// the textures used for the point sprites, in the order they are listed in the show
+vector<RenderTexture> particleTextures;
 
 //---------------------------------------------------------------------------------------------------------------------------------
 // Initialise Direct 3D.
@@ -104,6 +99,8 @@ HRESULT SetupD3D(HWND hWnd)
 	// Enable the Z buffer, since we're dealing with 3D geometry.
 	device->SetRenderState(D3DRS_ZENABLE, D3DZB_TRUE);
 
+	renderBackend = new D3D9RenderBackend(device);
+
 	return S_OK;
 }
 
@@ -114,11 +111,16 @@ HRESULT SetupD3D(HWND hWnd)
 
 void CleanUp()
 {
+	show.clear();
+	vertexRing.release();
+	for (size_t i = 0; i < particleTextures.size(); ++i)
+	{
+		renderBackend->releaseTexture(particleTextures[i]);
+	}
+	particleTextures.clear();
+	SAFE_DELETE(renderBackend);
 	SAFE_RELEASE(device);
 	SAFE_RELEASE(d3d);
-	SAFE_RELEASE(particle_circle);
-	SAFE_RELEASE(particle_star);
-	SAFE_RELEASE(particle_diamond);
 }
 
 //-----------------------------------------------------------------------------
@@ -200,10 +202,7 @@ void render()
 		device->SetRenderState(D3DRS_LIGHTING, FALSE);
 
 		// Render the rockets
-		for (int i = 0; i < numberOfRockets; ++i)
-		{
-			rockets[i].render();
-		}
+		show.render();
 
 		device->EndScene();
 	}
@@ -222,9 +221,6 @@ LRESULT WINAPI MsgProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	{
 	case WM_DESTROY:
 	{
-		// terminate the timer thread
-		doRun = false;
-
 		PostQuitMessage(0);
 		return 0;
 	}
@@ -251,9 +247,6 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int)
 		hWnd, 35/*DWMWINDOWATTRIBUTE::DWMWA_CAPTION_COLOR*/,
 		&bkColor, sizeof(COLORREF));
 
-	// seed the random number generator
-	seedRandomNumberGenerator();
-
 	// Initialize Direct3D
 	if (SUCCEEDED(SetupD3D(hWnd)))
 	{
@@ -271,9 +264,16 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int)
 			// initialise the different particle systems that will be used in the scene
 			SetupParticleSystems();
 
-			// start the timer that will fire the rockets at predefined times
-			doRun = true;
-			thread timer = thread(FireworksTimer(&rockets[0], numberOfRockets), &rocketStartTimes[0], &doRun);
+			// one worker thread less than there are cores, the main thread helps with the updates
+			jobSystem.start(-1);
+
+			// fire the rockets at predefined times
+			show.schedule(launchScheduler, 0);
+
+			// the real time passed between two frames is measured with the performance counter
+			LARGE_INTEGER frequency, lastFrame, thisFrame;
+			QueryPerformanceFrequency(&frequency);
+			QueryPerformanceCounter(&lastFrame);
 
 			// Enter the message loop
 			MSG msg;
@@ -289,19 +289,42 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int)
 				{
 					SetupViewMatrices();
 
-					// update the rockets
-					for (int i = 0; i < numberOfRockets; ++i)
+					QueryPerformanceCounter(&thisFrame);
+					float elapsed = static_cast<float>(thisFrame.QuadPart - lastFrame.QuadPart) / frequency.QuadPart;
+					lastFrame = thisFrame;
+
+					// run as many simulation steps as have become due since the last frame
+					int steps = simulationClock.advance(elapsed);
+					long long firstStep = simulationClock.steps() - steps;
+					vertexRing.beginFrame();
+					for (int step = 0; step < steps; ++step)
 					{
-						rockets[i].update();
+						// fire the commands of the show that are due at the start of the step (only the main thread
+						// touches the rockets between two steps)
+						launchScheduler.advance((firstStep + step) * SCHEDULER_TICKS_PER_SECOND / SIMULATION_STEPS_PER_SECOND,
+												[](const RocketCommand& command, long long tick) {show.execute(command, tick, launchScheduler);});
+
+						// the effects write their points during the last step already
+						if (step + 1 < steps) show.update();
+						else show.updateAndEmit(simulationClock.alpha());
 					}
 
+					// write the points of all other rockets to the vertex ring, in between the last two steps
+					show.emitVertices(simulationClock.alpha());
+					vertexRing.endFrame();
+
 					// render the scene
 					render();
 				}
 			}
 
-			// wait for timer thread to finish
-			timer.join();
+			jobSystem.stop();
+
+			// report the usage of the particle pool, so the budget can be adjusted to the show
+			char statistics[128];
+			sprintf_s(statistics, "particle pool: %d of %d particles used at most, %d failed leases\n",
+					  particlePool.highWaterMark(), particlePool.capacity(), particlePool.failedLeases());
+			OutputDebugString(statistics);
 		}
 	}
 
@@ -313,524 +336,39 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int)
 
 
 //-----------------------------------------------------------------------------
-// Initialise the parameters for the particle system.
+// Create the rockets and particle systems of the show.
 
 void SetupParticleSystems()
 {
-	D3DXCreateTextureFromFile(device, "particle_circle.png", &particle_circle);
-	D3DXCreateTextureFromFile(device, "particle_star.png", &particle_star);
-	D3DXCreateTextureFromFile(device, "particle_diamond.png", &particle_diamond);
-
-	//----------------------------------------------------------------------------------------
-	// setup projectiles
-
-	// set all parameters of the projectiles to default values
-	for (int i = 0; i < numberOfRockets; ++i)
+	// use the compiled show if it is up to date, otherwise read the show file and compile it for the next start
+	ShowDescription description;
+	if (FAILED(description.loadBinary(compiledShowFile, showFile)))
 	{
-		projectiles[i].baseColour_ = D3DXCOLOR(1.0f, 1.0f, 1.0f, 1.0f);
-		projectiles[i].launchAngle_ = 0.0f;
-		projectiles[i].launchVelocity_ = 90.0f;
-		projectiles[i].maxParticles_ = 1;
-		projectiles[i].origin_ = D3DXVECTOR3(0, 0, 0);
-		projectiles[i].startInterval_ = 1;
-		projectiles[i].startTimer_ = 0;
-		projectiles[i].timeIncrement_ = 0.08f;
-		projectiles[i].maxLifetime_ = 90;
-		projectiles[i].startParticles_ = 1;
-		projectiles[i].maxParticleSize_ = 16.0f;
-		projectiles[i].particleTexture_ = particle_circle;
+		if (FAILED(description.loadText(showFile)))
+		{
+			OutputDebugString(description.error());
+			OutputDebugString("\n");
+			return;
+		}
+		description.saveBinary(compiledShowFile);
 	}
 
-	// manually adjust launch angles and lifetime for the rockets
-
-	// effect spheres
-	projectiles[1].launchAngle_ = 0;
-	projectiles[1].maxLifetime_ = 90;
-
-	projectiles[1].launchAngle_ = 15;
-	projectiles[1].maxLifetime_ = 80;
-
-	projectiles[2].launchAngle_ = 5;
-	projectiles[2].maxLifetime_ = 85;
-
-	projectiles[3].launchAngle_ = -5;
-	projectiles[3].maxLifetime_ = 90;
-
-	projectiles[4].launchAngle_ = -15;
-	projectiles[4].maxLifetime_ = 95;
-
-	// effect stars
-	projectiles[5].launchAngle_ = 30;
-	projectiles[5].maxLifetime_ = 80;
-
-	projectiles[6].launchAngle_ = -10;
-	projectiles[6].maxLifetime_ = 90;
-
-	projectiles[7].launchAngle_ = 10;
-	projectiles[7].maxLifetime_ = 90;
-
-	projectiles[8].launchAngle_ = -30;
-	projectiles[8].maxLifetime_ = 80;
-
-	projectiles[9].launchAngle_ = 0;
-	projectiles[9].maxLifetime_ = 110;
-
-	// cones
-	projectiles[10].launchAngle_ = 20;
-	projectiles[10].maxLifetime_ = 90;
-
-	projectiles[11].launchAngle_ = -20;
-	projectiles[11].maxLifetime_ = 90;
-
-	// rays
-	projectiles[12].launchAngle_ = 0;
-	projectiles[12].maxLifetime_ = 100;
-
-	// multisphere
-	projectiles[13].launchAngle_ = 0;
-	projectiles[13].maxLifetime_ = 100;
-
-	// sphere
-	projectiles[14].launchAngle_ = 0;
-	projectiles[14].maxLifetime_ = 90;
-
-	//----------------------------------------------------------------------------------------
-	// setup projectile traces
-
-	// set all parameters of the projectile traces to default values
-	for (int i = 0; i < numberOfRockets; ++i)
+	for (int i = 0; i < description.textureCount(); ++i)
 	{
-		traces[i].baseColour_ = D3DXCOLOR(1.0f, 0.5f, 0.0f, 1.0f);
-		traces[i].launchVelocity_ = 10.0f;
-		traces[i].maxParticles_ = 300 * 2;
-		traces[i].origin_ = D3DXVECTOR3(0, 0, 0);
-		traces[i].startInterval_ = 0;
-		traces[i].startTimer_ = 0;
-		traces[i].timeIncrement_ = 0.08f;
-		traces[i].maxLifetime_ = 5 * 2;
-		traces[i].startParticles_ = 1;
-		traces[i].maxParticleSize_ = 4.0f;
-		traces[i].particleTexture_ = particle_circle;
+		particleTextures.push_back(renderBackend->loadTexture(description.texture(i).file_));
 	}
 
-	//-------------------------------------------------------------------------------
-	// effect spheres
-
-	effectSpheres[0].fadeOutTime_ = 30 * 4;
-	effectSpheres[0].maxColourDivergence_.x = 0.0f;
-	effectSpheres[0].maxColourDivergence_.y = 0.5f;
-	effectSpheres[0].maxColourDivergence_.z = 0.25f;
-	effectSpheres[0].maxLifetimeDivergence_ = 5;
-	effectSpheres[0].maxSizeDivergence_ = 5.0f;
-	effectSpheres[0].maxVelocityDivergence_ = 5.0f;
-	effectSpheres[0].baseColour_ = D3DXCOLOR(1.0f, 1.0f, 1.0f, 1.0f);
-	effectSpheres[0].launchVelocity_ = 70.0f;
-	effectSpheres[0].maxParticles_ = 1000 * 2;
-	effectSpheres[0].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectSpheres[0].startInterval_ = 1;
-	effectSpheres[0].startTimer_ = 0;
-	effectSpheres[0].timeIncrement_ = 0.08f;
-	effectSpheres[0].maxLifetime_ = 80 * 2;
-	effectSpheres[0].startParticles_ = 1000 * 2;
-	effectSpheres[0].maxParticleSize_ = 12.0f;
-	effectSpheres[0].particleTexture_ = particle_circle;
-
-	effectSpheres[1].fadeOutTime_ = 15 * 4;
-	effectSpheres[1].maxColourDivergence_.x = 0.25f;
-	effectSpheres[1].maxColourDivergence_.y = 0.5f;
-	effectSpheres[1].maxColourDivergence_.z = 0.25f;
-	effectSpheres[1].maxLifetimeDivergence_ = 5;
-	effectSpheres[1].maxSizeDivergence_ = 5.0f;
-	effectSpheres[1].maxVelocityDivergence_ = 3.0f;
-	effectSpheres[1].baseColour_ = D3DXCOLOR(0.0f, 1.0f, 0.0f, 1.0f);
-	effectSpheres[1].launchVelocity_ = 40.0f;
-	effectSpheres[1].maxParticles_ = 800 * 2;
-	effectSpheres[1].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectSpheres[1].startInterval_ = 1;
-	effectSpheres[1].startTimer_ = 0;
-	effectSpheres[1].timeIncrement_ = 0.08f;
-	effectSpheres[1].maxLifetime_ = 80 * 2;
-	effectSpheres[1].startParticles_ = 800 * 2;
-	effectSpheres[1].maxParticleSize_ = 12.0f;
-	effectSpheres[1].particleTexture_ = particle_circle;
-
-	effectSpheres[2].fadeOutTime_ = 15 * 4;
-	effectSpheres[2].maxColourDivergence_.x = 0.0f;
-	effectSpheres[2].maxColourDivergence_.y = 0.5f;
-	effectSpheres[2].maxColourDivergence_.z = 0.5f;
-	effectSpheres[2].maxLifetimeDivergence_ = 5;
-	effectSpheres[2].maxSizeDivergence_ = 5.0f;
-	effectSpheres[2].maxVelocityDivergence_ = 3.0f;
-	effectSpheres[2].baseColour_ = D3DXCOLOR(0.0f, 1.0f, 1.0f, 1.0f);
-	effectSpheres[2].launchVelocity_ = 40.0f;
-	effectSpheres[2].maxParticles_ = 800 * 2;
-	effectSpheres[2].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectSpheres[2].startInterval_ = 1;
-	effectSpheres[2].startTimer_ = 0;
-	effectSpheres[2].timeIncrement_ = 0.08f;
-	effectSpheres[2].maxLifetime_ = 80 * 2;
-	effectSpheres[2].startParticles_ = 800 * 2;
-	effectSpheres[2].maxParticleSize_ = 12.0f;
-	effectSpheres[2].particleTexture_ = particle_circle;
-
-	effectSpheres[3].fadeOutTime_ = 15 * 4;
-	effectSpheres[3].maxColourDivergence_.x = 0.5f;
-	effectSpheres[3].maxColourDivergence_.y = 0.0f;
-	effectSpheres[3].maxColourDivergence_.z = 0.5f;
-	effectSpheres[3].maxLifetimeDivergence_ = 5;
-	effectSpheres[3].maxSizeDivergence_ = 5.0f;
-	effectSpheres[3].maxVelocityDivergence_ = 3.0f;
-	effectSpheres[3].baseColour_ = D3DXCOLOR(1.0f, 0.0f, 1.0f, 1.0f);
-	effectSpheres[3].launchVelocity_ = 40.0f;
-	effectSpheres[3].maxParticles_ = 800 * 2;
-	effectSpheres[3].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectSpheres[3].startInterval_ = 1;
-	effectSpheres[3].startTimer_ = 0;
-	effectSpheres[3].timeIncrement_ = 0.08f;
-	effectSpheres[3].maxLifetime_ = 80 * 2;
-	effectSpheres[3].startParticles_ = 800 * 2;
-	effectSpheres[3].maxParticleSize_ = 12.0f;
-	effectSpheres[3].particleTexture_ = particle_circle;
-
-	effectSpheres[4].fadeOutTime_ = 15 * 4;
-	effectSpheres[4].maxColourDivergence_.x = 0.5f;
-	effectSpheres[4].maxColourDivergence_.y = 0.5f;
-	effectSpheres[4].maxColourDivergence_.z = 0.0f;
-	effectSpheres[4].maxLifetimeDivergence_ = 5;
-	effectSpheres[4].maxSizeDivergence_ = 5.0f;
-	effectSpheres[4].maxVelocityDivergence_ = 3.0f;
-	effectSpheres[4].baseColour_ = D3DXCOLOR(1.0f, 1.0f, 0.0f, 1.0f);
-	effectSpheres[4].launchVelocity_ = 40.0f;
-	effectSpheres[4].maxParticles_ = 800 * 2;
-	effectSpheres[4].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectSpheres[4].startInterval_ = 1;
-	effectSpheres[4].startTimer_ = 0;
-	effectSpheres[4].timeIncrement_ = 0.08f;
-	effectSpheres[4].maxLifetime_ = 80 * 2;
-	effectSpheres[4].startParticles_ = 800 * 2;
-	effectSpheres[4].maxParticleSize_ = 12.0f;
-	effectSpheres[4].particleTexture_ = particle_circle;
-
-	effectSpheres[5].fadeOutTime_ = 30 * 4;
-	effectSpheres[5].maxColourDivergence_.x = 0.5f;
-	effectSpheres[5].maxColourDivergence_.y = 0.0f;
-	effectSpheres[5].maxColourDivergence_.z = 0.0f;
-	effectSpheres[5].maxLifetimeDivergence_ = 5;
-	effectSpheres[5].maxSizeDivergence_ = 5.0f;
-	effectSpheres[5].maxVelocityDivergence_ = 5.0f;
-	effectSpheres[5].baseColour_ = D3DXCOLOR(1.0f, 1.0f, 1.0f, 1.0f);
-	effectSpheres[5].launchVelocity_ = 70.0f;
-	effectSpheres[5].maxParticles_ = 1000 * 2;
-	effectSpheres[5].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectSpheres[5].startInterval_ = 1;
-	effectSpheres[5].startTimer_ = 0;
-	effectSpheres[5].timeIncrement_ = 0.08f;
-	effectSpheres[5].maxLifetime_ = 80 * 2;
-	effectSpheres[5].startParticles_ = 1000 * 2;
-	effectSpheres[5].maxParticleSize_ = 12.0f;
-	effectSpheres[5].particleTexture_ = particle_circle;
-
-	//--------------------------------------------------------------------------
-	// effect stars
-
-	effectStars[0].fadeOutTime_ = 15 * 4;
-	effectStars[0].maxColourDivergence_.x = 0.75f;
-	effectStars[0].maxColourDivergence_.y = 0.5f;
-	effectStars[0].maxColourDivergence_.z = 0.0f;
-	effectStars[0].maxLifetimeDivergence_ = 5;
-	effectStars[0].maxSizeDivergence_ = 5.0f;
-	effectStars[0].maxVelocityDivergence_ = 20.0f;
-	effectStars[0].numberOfRays_ = 50;
-	effectStars[0].baseColour_ = D3DXCOLOR(1.0f, 1.0f, 1.0f, 1.0f);
-	effectStars[0].launchVelocity_ = 50.0f;
-	effectStars[0].maxParticles_ = 1000 * 2;
-	effectStars[0].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectStars[0].startInterval_ = 1;
-	effectStars[0].startTimer_ = 0;
-	effectStars[0].timeIncrement_ = 0.08f;
-	effectStars[0].maxLifetime_ = 60 * 2;
-	effectStars[0].startParticles_ = 1000 * 2;
-	effectStars[0].maxParticleSize_ = 10.0f;
-	effectStars[0].particleTexture_ = particle_circle;
-
-	effectStars[1].fadeOutTime_ = 15 * 4;
-	effectStars[1].maxColourDivergence_.x = 0.0f;
-	effectStars[1].maxColourDivergence_.y = 0.5f;
-	effectStars[1].maxColourDivergence_.z = 0.75f;
-	effectStars[1].maxLifetimeDivergence_ = 5;
-	effectStars[1].maxSizeDivergence_ = 5.0f;
-	effectStars[1].maxVelocityDivergence_ = 20.0f;
-	effectStars[1].numberOfRays_ = 50;
-	effectStars[1].baseColour_ = D3DXCOLOR(1.0f, 1.0f, 1.0f, 1.0f);
-	effectStars[1].launchVelocity_ = 50.0f;
-	effectStars[1].maxParticles_ = 1000 * 2;
-	effectStars[1].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectStars[1].startInterval_ = 1;
-	effectStars[1].startTimer_ = 0;
-	effectStars[1].timeIncrement_ = 0.08f;
-	effectStars[1].maxLifetime_ = 60 * 2;
-	effectStars[1].startParticles_ = 1000 * 2;
-	effectStars[1].maxParticleSize_ = 10.0f;
-	effectStars[1].particleTexture_ = particle_circle;
-
-	effectStars[2].fadeOutTime_ = 15 * 4;
-	effectStars[2].maxColourDivergence_.x = 0.75f;
-	effectStars[2].maxColourDivergence_.y = 0.0f;
-	effectStars[2].maxColourDivergence_.z = 0.5f;
-	effectStars[2].maxLifetimeDivergence_ = 5;
-	effectStars[2].maxSizeDivergence_ = 5.0f;
-	effectStars[2].maxVelocityDivergence_ = 20.0f;
-	effectStars[2].numberOfRays_ = 50;
-	effectStars[2].baseColour_ = D3DXCOLOR(1.0f, 1.0f, 1.0f, 1.0f);
-	effectStars[2].launchVelocity_ = 50.0f;
-	effectStars[2].maxParticles_ = 1000 * 2;
-	effectStars[2].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectStars[2].startInterval_ = 1;
-	effectStars[2].startTimer_ = 0;
-	effectStars[2].timeIncrement_ = 0.08f;
-	effectStars[2].maxLifetime_ = 60 * 2;
-	effectStars[2].startParticles_ = 1000 * 2;
-	effectStars[2].maxParticleSize_ = 10.0f;
-	effectStars[2].particleTexture_ = particle_circle;
-
-	effectStars[3].fadeOutTime_ = 15 * 4;
-	effectStars[3].maxColourDivergence_.x = 0.0f;
-	effectStars[3].maxColourDivergence_.y = 0.75f;
-	effectStars[3].maxColourDivergence_.z = 0.0f;
-	effectStars[3].maxLifetimeDivergence_ = 5;
-	effectStars[3].maxSizeDivergence_ = 5.0f;
-	effectStars[3].maxVelocityDivergence_ = 20.0f;
-	effectStars[3].numberOfRays_ = 50;
-	effectStars[3].baseColour_ = D3DXCOLOR(1.0f, 1.0f, 1.0f, 1.0f);
-	effectStars[3].launchVelocity_ = 50.0f;
-	effectStars[3].maxParticles_ = 1000 * 2;
-	effectStars[3].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectStars[3].startInterval_ = 1;
-	effectStars[3].startTimer_ = 0;
-	effectStars[3].timeIncrement_ = 0.08f;
-	effectStars[3].maxLifetime_ = 60 * 2;
-	effectStars[3].startParticles_ = 1000 * 2;
-	effectStars[3].maxParticleSize_ = 10.0f;
-	effectStars[3].particleTexture_ = particle_circle;
-
-	effectStars[4].fadeOutTime_ = 15 * 4;
-	effectStars[4].maxColourDivergence_.x = 0.5f;
-	effectStars[4].maxColourDivergence_.y = 0.0f;
-	effectStars[4].maxColourDivergence_.z = 0.0f;
-	effectStars[4].maxLifetimeDivergence_ = 5;
-	effectStars[4].maxSizeDivergence_ = 5.0f;
-	effectStars[4].maxVelocityDivergence_ = 20.0f;
-	effectStars[4].numberOfRays_ = 60;
-	effectStars[4].baseColour_ = D3DXCOLOR(1.0f, 1.0f, 1.0f, 1.0f);
-	effectStars[4].launchVelocity_ = 50.0f;
-	effectStars[4].maxParticles_ = 1000 * 2;
-	effectStars[4].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectStars[4].startInterval_ = 1;
-	effectStars[4].startTimer_ = 0;
-	effectStars[4].timeIncrement_ = 0.08f;
-	effectStars[4].maxLifetime_ = 60 * 2;
-	effectStars[4].startParticles_ = 1000 * 2;
-	effectStars[4].maxParticleSize_ = 10.0f;
-	effectStars[4].particleTexture_ = particle_circle;
-
-	//------------------------------------------------------------------------
-	// effect cones
-
-	effectCones[0].launchAngle = 45.0f;
-	effectCones[0].fadeOutTime_ = 15 * 4;
-	effectCones[0].maxColourDivergence_.x = 0.0f;
-	effectCones[0].maxColourDivergence_.y = 0.5f;
-	effectCones[0].maxColourDivergence_.z = 0.5f;
-	effectCones[0].maxLifetimeDivergence_ = 15;
-	effectCones[0].maxSizeDivergence_ = 5.0f;
-	effectCones[0].maxVelocityDivergence_ = 10.0f;
-	effectCones[0].baseColour_ = D3DXCOLOR(0.0f, 1.0f, 0.0f, 1.0f);
-	effectCones[0].launchVelocity_ = 50.0f;
-	effectCones[0].maxParticles_ = 200 * 2;
-	effectCones[0].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectCones[0].startInterval_ = 1;
-	effectCones[0].startTimer_ = 0;
-	effectCones[0].timeIncrement_ = 0.08f;
-	effectCones[0].maxLifetime_ = 100 * 2;
-	effectCones[0].startParticles_ = 200 * 2;
-	effectCones[0].maxParticleSize_ = 12.0f;
-	effectCones[0].particleTexture_ = particle_star;
-
-	effectCones[1].launchAngle = -45.0f;
-	effectCones[1].fadeOutTime_ = 15 * 4;
-	effectCones[1].maxColourDivergence_.x = 0.0f;
-	effectCones[1].maxColourDivergence_.y = 0.5f;
-	effectCones[1].maxColourDivergence_.z = 0.5f;
-	effectCones[1].maxLifetimeDivergence_ = 15;
-	effectCones[1].maxSizeDivergence_ = 5.0f;
-	effectCones[1].maxVelocityDivergence_ = 10.0f;
-	effectCones[1].baseColour_ = D3DXCOLOR(0.0f, 1.0f, 0.0f, 1.0f);
-	effectCones[1].launchVelocity_ = 50.0f;
-	effectCones[1].maxParticles_ = 200 * 2;
-	effectCones[1].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectCones[1].startInterval_ = 1;
-	effectCones[1].startTimer_ = 0;
-	effectCones[1].timeIncrement_ = 0.08f;
-	effectCones[1].maxLifetime_ = 100 * 2;
-	effectCones[1].startParticles_ = 200 * 2;
-	effectCones[1].maxParticleSize_ = 12.0f;
-	effectCones[1].particleTexture_ = particle_star;
-
-	//-------------------------------------------------------------------------
-	// effect multisphere
-
-	effectMultiSpheres[0].subExplosionSize_ = 100 * 2;
-	effectMultiSpheres[0].subParticleBaseColour_ = D3DXCOLOR(1.0f, 1.0f, 0.0f, 0.0f);;
-	effectMultiSpheres[0].subParticleFadeOutTime_ = 50 * 4;
-	effectMultiSpheres[0].subParticleMaxVelocityDivergence_ = 10.0f;
-	effectMultiSpheres[0].subParticleLaunchVelocity_ = 30.0f;
-	effectMultiSpheres[0].subParticleMaxColourDivergence_.x = 0.25f;
-	effectMultiSpheres[0].subParticleMaxColourDivergence_.y = 0.25f;
-	effectMultiSpheres[0].subParticleMaxColourDivergence_.z = 0.0f;
-	effectMultiSpheres[0].subParticleMaxLifetimeDivergence_ = 5;
-	effectMultiSpheres[0].subParticleMaxLifetime_ = 100;
-	effectMultiSpheres[0].subParticleMaxSizeDivergence_ = 2.0f;
-	effectMultiSpheres[0].subParticleMaxSize_ = 10.0f;
-
-	effectMultiSpheres[0].fadeOutTime_ = 30 * 4;
-	effectMultiSpheres[0].maxColourDivergence_.x = 0.25f;
-	effectMultiSpheres[0].maxColourDivergence_.y = 0.25f;
-	effectMultiSpheres[0].maxColourDivergence_.z = 0.0f;
-	effectMultiSpheres[0].maxLifetimeDivergence_ = 5;
-	effectMultiSpheres[0].maxSizeDivergence_ = 5.0f;
-	effectMultiSpheres[0].maxVelocityDivergence_ = 25.0f;
-
-	effectMultiSpheres[0].baseColour_ = D3DXCOLOR(1.0f, 1.0f, 0.0f, 1.0f);
-	effectMultiSpheres[0].launchVelocity_ = 70.0f;
-	effectMultiSpheres[0].maxParticles_ = 3030 * 2;
-	effectMultiSpheres[0].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectMultiSpheres[0].startInterval_ = 1;
-	effectMultiSpheres[0].startTimer_ = 0;
-	effectMultiSpheres[0].timeIncrement_ = 0.08f;
-	effectMultiSpheres[0].maxLifetime_ = 50 * 2;
-	effectMultiSpheres[0].startParticles_ = 30 * 2;
-	effectMultiSpheres[0].maxParticleSize_ = 15.0f;
-	effectMultiSpheres[0].particleTexture_ = particle_circle;
-
-	//------------------------------------------------------------------------------------
-	// effect rays
-
-	effectRays[0].subParticleBaseColour_ = D3DXCOLOR(1.0f, 1.0f, 1.0f, 1.0f);;
-	effectRays[0].subParticleFadeOutTime_ = 30 * 4;
-	effectRays[0].subParticleMaxVelocityDivergence_ = 0.0f;
-	effectRays[0].subParticleLaunchVelocity_ = 30.0f;
-	effectRays[0].subParticleMaxColourDivergence_.x = 0.5f;
-	effectRays[0].subParticleMaxColourDivergence_.y = 0.5f;
-	effectRays[0].subParticleMaxColourDivergence_.z = 0.5f;
-	effectRays[0].subParticleMaxLifetimeDivergence_ = 0;
-	effectRays[0].subParticleMaxLifetime_ = 30;
-	effectRays[0].subParticleMaxSizeDivergence_ = 0.0f;
-	effectRays[0].subParticleMaxSize_ = 4.0f;
-
-	effectRays[0].fadeOutTime_ = 20 * 4;
-	effectRays[0].maxColourDivergence_.x = 0.0f;
-	effectRays[0].maxColourDivergence_.y = 0.5f;
-	effectRays[0].maxColourDivergence_.z = 0.5f;
-	effectRays[0].maxLifetimeDivergence_ = 5;
-	effectRays[0].maxSizeDivergence_ = 5.0f;
-	effectRays[0].maxVelocityDivergence_ = 25.0f;
-
-	effectRays[0].baseColour_ = D3DXCOLOR(1.0f, 1.0f, 1.0f, 1.0f);
-	effectRays[0].launchVelocity_ = 70.0f;
-	effectRays[0].maxParticles_ = 4650 * 2;
-	effectRays[0].origin_ = D3DXVECTOR3(0, 0, 0);
-	effectRays[0].startInterval_ = 1;
-	effectRays[0].startTimer_ = 0;
-	effectRays[0].timeIncrement_ = 0.08f;
-	effectRays[0].maxLifetime_ = 60 * 2;
-	effectRays[0].startParticles_ = 150 * 2;
-	effectRays[0].maxParticleSize_ = 20.0f;
-	effectRays[0].particleTexture_ = particle_circle;
-
-	//----------------------------------------------------------------------------------
-	// equip rockets
-
-	rockets[0].startPosition_ = D3DXVECTOR3(0, -300, 0);
-	rockets[0].projectile_ = &projectiles[0];
-	rockets[0].trace_ = &traces[0];
-	rockets[0].effect_ = &effectSpheres[0];
-
-	rockets[1].startPosition_ = D3DXVECTOR3(-75, -300, 0);
-	rockets[1].projectile_ = &projectiles[1];
-	rockets[1].trace_ = &traces[1];
-	rockets[1].effect_ = &effectSpheres[1];
-
-	rockets[2].startPosition_ = D3DXVECTOR3(-25, -300, 0);
-	rockets[2].projectile_ = &projectiles[2];
-	rockets[2].trace_ = &traces[2];
-	rockets[2].effect_ = &effectSpheres[2];
-
-	rockets[3].startPosition_ = D3DXVECTOR3(25, -300, 0);
-	rockets[3].projectile_ = &projectiles[3];
-	rockets[3].trace_ = &traces[3];
-	rockets[3].effect_ = &effectSpheres[3];
-
-	rockets[4].startPosition_ = D3DXVECTOR3(75, -300, 0);
-	rockets[4].projectile_ = &projectiles[4];
-	rockets[4].trace_ = &traces[4];
-	rockets[4].effect_ = &effectSpheres[4];
-
-	rockets[5].startPosition_ = D3DXVECTOR3(0, -300, 0);
-	rockets[5].projectile_ = &projectiles[5];
-	rockets[5].trace_ = &traces[5];
-	rockets[5].effect_ = &effectStars[0];
-
-	rockets[6].startPosition_ = D3DXVECTOR3(0, -300, 0);
-	rockets[6].projectile_ = &projectiles[6];
-	rockets[6].trace_ = &traces[6];
-	rockets[6].effect_ = &effectStars[1];
-
-	rockets[7].startPosition_ = D3DXVECTOR3(0, -300, 0);
-	rockets[7].projectile_ = &projectiles[7];
-	rockets[7].trace_ = &traces[7];
-	rockets[7].effect_ = &effectStars[2];
-
-	rockets[8].startPosition_ = D3DXVECTOR3(0, -300, 0);
-	rockets[8].projectile_ = &projectiles[8];
-	rockets[8].trace_ = &traces[8];
-	rockets[8].effect_ = &effectStars[3];
-
-	rockets[9].startPosition_ = D3DXVECTOR3(0, -300, 0);
-	rockets[9].projectile_ = &projectiles[9];
-	rockets[9].trace_ = &traces[9];
-	rockets[9].effect_ = &effectStars[4];
-
-	rockets[10].startPosition_ = D3DXVECTOR3(0, -300, 0);
-	rockets[10].projectile_ = &projectiles[10];
-	rockets[10].trace_ = &traces[10];
-	rockets[10].effect_ = &effectCones[0];
-
-	rockets[11].startPosition_ = D3DXVECTOR3(0, -300, 0);
-	rockets[11].projectile_ = &projectiles[11];
-	rockets[11].trace_ = &traces[11];
-	rockets[11].effect_ = &effectCones[1];
-
-	rockets[12].startPosition_ = D3DXVECTOR3(0, -300, 0);
-	rockets[12].projectile_ = &projectiles[12];
-	rockets[12].trace_ = &traces[12];
-	rockets[12].effect_ = &effectRays[0];
-
-	rockets[13].startPosition_ = D3DXVECTOR3(0, -300, 0);
-	rockets[13].projectile_ = &projectiles[13];
-	rockets[13].trace_ = &traces[13];
-	rockets[13].effect_ = &effectMultiSpheres[0];
-
-	rockets[14].startPosition_ = D3DXVECTOR3(0, -300, 0);
-	rockets[14].projectile_ = &projectiles[14];
-	rockets[14].trace_ = &traces[14];
-	rockets[14].effect_ = &effectSpheres[5];
+	show.build(description, particleTextures);
 
 	//------------------------------------------------------------------------------------
 	// initialise rockets
 
-	for (int i = 0; i < numberOfRockets; ++i)
-	{
-		rockets[i].initialise(device);
-	}
+	// all particles of the pool may be alive (and thus be drawn) in a single frame
+	particlePool.initialise(particleBudget);
+	vertexRing.initialise(renderBackend, particlePool.capacity());
 
-}
\ No newline at end of file
+	show.initialise(renderBackend, &vertexRing, &particlePool, &jobSystem);
+
+	// every rocket gets its own random numbers, derived from the system time (a fixed seed repeats the show exactly)
+	show.seedRandom(static_cast<unsigned int>(time(NULL)));
+}
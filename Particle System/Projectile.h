@@ -11,11 +11,11 @@ Particle system managing a single particle that simulates a rocket.
 class Projectile : public FireworkParticleSystem
 {
 public:
-	Projectile() : FireworkParticleSystem(), launchAngle_(D3DXToRadian(0))
+	Projectile() : FireworkParticleSystem(), launchAngle_(D3DXToRadian(0)), particleMoveDirection_(0, 0, 0), particlePosition_(0, 0, 0)
 	{
 	}
 
-	Projectile(float launchAngle) : FireworkParticleSystem(), launchAngle_(D3DXToRadian(launchAngle))
+	Projectile(float launchAngle) : FireworkParticleSystem(), launchAngle_(D3DXToRadian(launchAngle)), particleMoveDirection_(0, 0, 0), particlePosition_(0, 0, 0)
 	{
 	}
 
@@ -26,7 +26,7 @@ public:
 	// returns a pointer to the single particle's position
 	D3DXVECTOR3* getProjectilePosition()
 	{
-		return &particles_[0].position_;
+		return &particlePosition_;
 	}
 
 	// returns a pointer to the move direction of the particle (velocity with environmental influences)
@@ -37,7 +37,7 @@ public:
 
 	bool isExploded(void)
 	{
-		return particles_[0].lifetime_ == 0;
+		return particles_.lifetime_[0] == 0;
 	}
 
 	virtual void update(void)
@@ -45,59 +45,58 @@ public:
 		// Start particles, if necessary...
 		startParticles();
 
-		// Update the particles that are still alive...
-		for (std::vector<Particle>::iterator p(particles_.begin()); p != particles_.end(); ++p)
+		int* lifetime = particles_.lifetime_;
+		int died = 0;
+
+		// Update the particles that are still alive (they are packed at the front)...
+		for (int i = 0; i < particlesAlive_; ++i)
 		{
-			if (p -> lifetime_ > 0)	// Update only if this particle is alive.
+			// Calculate the new position of the particle...
+			float time = particles_.time_[i];
+
+			particleMoveDirection_.x = (particles_.velocityX_[i] * time);
+			particleMoveDirection_.y = (particles_.velocityY_[i] * time) + (EARTH_GRAVITY * time * time);
+			particleMoveDirection_.z = (particles_.velocityZ_[i] * time);
+
+			particles_.movePosition(i, particleMoveDirection_ + origin_);
+
+			particles_.time_[i] += timeIncrement_;
+			--lifetime[i];
+
+			if (lifetime[i] == 0)	// Has this particle come to the end of it's life?
 			{
-				// Calculate the new position of the particle...
-
-				// Vertical distance.
-				float s = (p -> velocity_.y * p -> time_) + (EARTH_GRAVITY * p -> time_ * p -> time_);
-				
-				particleMoveDirection_.x = (p -> velocity_.x * p -> time_);
-				particleMoveDirection_.y = (p -> velocity_.y * p -> time_) + (EARTH_GRAVITY * p -> time_ * p -> time_);
-				particleMoveDirection_.z = (p -> velocity_.z * p -> time_);
-
-				p -> position_.x = particleMoveDirection_.x + origin_.x;
-				p -> position_.y = particleMoveDirection_.y + origin_.y;
-				p -> position_.z = particleMoveDirection_.z + origin_.z;
-
-				p -> time_ += timeIncrement_;
-				--(p -> lifetime_);
-
-				if (p -> lifetime_ == 0)	// Has this particle come to the end of it's life?
-				{
-					--particlesAlive_;		// If so, terminate it.
-				}
+				diedParticles_[died++] = i;
 			}
 		}
 
-		// Create a pointer to the first vertex in the buffer
-		// Also lock it, so nothing else can touch it while the values are being inserted.
-		POINTVERTEX *points;
-		points_ -> Lock(0, 0, (void**)&points, 0);
+		// terminate the particles that came to the end of their life
+		releaseParticles(&diedParticles_[0], died);
 
-		// Fill the vertex buffers with data...
-		int P(0);
+		// the rocket itself is the single particle of this system (its last position stays in the store when it dies)
+		particlePosition_ = particles_.getPosition(0);
+	}
 
-		// Now update the vertex buffer - after the update has been
-		// performed, just in case this particle has died in the process.
+	virtual void reset(void)
+	{
+		FireworkParticleSystem::reset();
 
-		for (std::vector<Particle>::iterator p(particles_.begin()); p != particles_.end(); ++p)
-		{
-			if (p -> lifetime_ > 0)
-			{
-				points[P].position_.y = p -> position_.y;
-				points[P].position_.x = p -> position_.x;
-				points[P].position_.z = p -> position_.z;
+		// nothing of the last flight is left for the next one
+		particleMoveDirection_ = D3DXVECTOR3(0, 0, 0);
+		particlePosition_ = D3DXVECTOR3(0, 0, 0);
+	}
 
-				points[P].color_ = p -> colour_;
-				++P;
-			}
-		}
+	virtual void saveState(Snapshot& snapshot) const
+	{
+		FireworkParticleSystem::saveState(snapshot);
+		snapshot.write(particleMoveDirection_);
+		snapshot.write(particlePosition_);
+	}
 
-		points_ -> Unlock();
+	virtual void restoreState(Snapshot& snapshot)
+	{
+		FireworkParticleSystem::restoreState(snapshot);
+		snapshot.read(&particleMoveDirection_);
+		snapshot.read(&particlePosition_);
 	}
 
 	// the projectile will be launched by this angle
@@ -105,29 +104,32 @@ public:
 
 private:
 	D3DXVECTOR3 particleMoveDirection_;
+	D3DXVECTOR3 particlePosition_;
 
-	virtual void startSingleParticle(std::vector<Particle>::iterator& p)
+	virtual void startSingleParticle(int p)
 	{
-		if (p == particles_.end()) return;	// Safety net - if there are no dead particles, don't start any new ones...
+		if (p < 0) return;	// Safety net - if there are no dead particles, don't start any new ones...
 
 		// Reset the particle's time (for calculating it's position with s = ut+0.5t*t)
-		p -> time_ = 0;
+		particles_.time_[p] = 0;
+
+		// the rocket starts at the origin (the first step moves it from there)
+		particles_.setPosition(p, origin_);
 
 		float angle = D3DXToRadian(launchAngle_ + 90.0f);
 
 		// calculate the particle's horizontal and depth components.
-		p -> velocity_.x = launchVelocity_ * (float)cos(angle);
-		p -> velocity_.y = launchVelocity_ * (float)sin(angle);
-		p -> velocity_.z = 0;	// projectiles only fly in the x and y directions
+		// projectiles only fly in the x and y directions
+		particles_.setVelocity(p, D3DXVECTOR3(launchVelocity_ * (float)cos(angle), launchVelocity_ * (float)sin(angle), 0));
 
 		// set the colour for the particle
-		getRandomColour(&(p->colour_));
+		D3DXCOLOR colour;
+		getRandomColour(&colour);
+		particles_.setColour(p, colour);
 		// set lifetime 
-		p -> lifetime_ = getRandomLifetime();
+		particles_.lifetime_[p] = getRandomLifetime();
 		// set particle size
-		p -> size_ = getRandomSize();
-
-		++particlesAlive_;
+		particles_.size_[p] = getRandomSize();
 	}
 };
 
@@ -25,72 +25,53 @@ public:
 		// Start particles, if necessary...
 		startParticles();
 
-		// Update the particles that are still alive...
-		for (std::vector<Particle>::iterator p(particles_.begin()); p != particles_.end(); ++p)
-		{
-			if (p -> lifetime_ > 0)	// Update only if this particle is alive.
-			{
-				// Calculate the new position of the particle...
-
-				// Vertical distance.
-				float s = (p -> velocity_.y * p -> time_) + (EARTH_GRAVITY * p -> time_ * p -> time_);
-
-				// the position is calculated in relation to the particle's origin
-				p -> position_.y = s + p -> origin_.y;									
-				p -> position_.x = (p -> velocity_.x * p -> time_) + p -> origin_.x;
-				p -> position_.z = (p -> velocity_.z * p -> time_) + p -> origin_.z;
+		int* lifetime = particles_.lifetime_;
+		float* time = particles_.time_;
 
-				p -> time_ += timeIncrement_;
-				--(p -> lifetime_);
+		int died = 0;
 
-				if (p -> lifetime_ == 0)	// Has this particle come to the end of it's life?
-				{
-					--particlesAlive_;		// If so, terminate it.
-				}
-			}
-		}
-
-		// move the origin according to the movement of the source object (projectile)
-		origin_ = *(sourceObject_->getProjectilePosition());
+		// Update the particles that are still alive (they are packed at the front)...
+		for (int i = 0; i < particlesAlive_; ++i)
+		{
+			// Calculate the new position of the particle...
 
-		// Create a pointer to the first vertex in the buffer
-		// Also lock it, so nothing else can touch it while the values are being inserted.
-		POINTVERTEX *points;
-		points_ -> Lock(0, 0, (void**)&points, 0);
+			// Vertical distance.
+			float s = (particles_.velocityY_[i] * time[i]) + (EARTH_GRAVITY * time[i] * time[i]);
 
-		// Fill the vertex buffers with data...
-		int P(0);
+			// the position is calculated in relation to the particle's origin
+			particles_.storePreviousPosition(i);
+			particles_.positionY_[i] = s + particles_.originY_[i];
+			particles_.positionX_[i] = (particles_.velocityX_[i] * time[i]) + particles_.originX_[i];
+			particles_.positionZ_[i] = (particles_.velocityZ_[i] * time[i]) + particles_.originZ_[i];
 
-		// Now update the vertex buffer - after the update has been
-		// performed, just in case this particle has died in the process.
+			time[i] += timeIncrement_;
+			--lifetime[i];
 
-		for (std::vector<Particle>::iterator p(particles_.begin()); p != particles_.end(); ++p)
-		{
-			if (p -> lifetime_ > 0)
+			if (lifetime[i] == 0)	// Has this particle come to the end of it's life?
 			{
-				points[P].position_.y = p -> position_.y;
-				points[P].position_.x = p -> position_.x;
-				points[P].position_.z = p -> position_.z;
-
-				points[P].color_ = p -> colour_;
-				++P;
+				diedParticles_[died++] = i;
 			}
 		}
 
-		points_ -> Unlock();
+		// terminate the particles that came to the end of their life
+		releaseParticles(&diedParticles_[0], died);
+
+		// move the origin according to the movement of the source object (projectile)
+		origin_ = *(sourceObject_->getProjectilePosition());
 	}
 
 private:
 	
-	virtual void startSingleParticle(std::vector<Particle>::iterator& p)
+	virtual void startSingleParticle(int p)
 	{
-		if (p == particles_.end()) return;	// Safety net - if there are no dead particles, don't start any new ones...
+		if (p < 0) return;	// Safety net - if there are no dead particles, don't start any new ones...
 
 		// Reset the particle's time (for calculating it's position with s = ut+0.5t*t)
-		p -> time_ = 0;
+		particles_.time_[p] = 0;
 
 		// set the origin for the particle to the current position of the particle system (later on will change)
-		p -> origin_ = origin_;
+		particles_.setOrigin(p, origin_);
+		particles_.setPosition(p, origin_);
 
 		// get the flying direction of the projectile in order to emit the trace particles in the opposite direction
 		D3DXVECTOR3 normalizedSourceDirection;
@@ -98,18 +79,18 @@ private:
 
 		// Now calculate the particle's horizontal and depth components.
 		// Emit the particles in the opposite direction to the direction of the source object
-		p -> velocity_.x = launchVelocity_ * -(normalizedSourceDirection.x);
-		p -> velocity_.y = launchVelocity_ * -(normalizedSourceDirection.y);
-		p -> velocity_.z = launchVelocity_ * -(normalizedSourceDirection.z);
+		particles_.setVelocity(p, D3DXVECTOR3(launchVelocity_ * -(normalizedSourceDirection.x),
+											  launchVelocity_ * -(normalizedSourceDirection.y),
+											  launchVelocity_ * -(normalizedSourceDirection.z)));
 
 		// set the colour for the particle
-		getRandomColour(&(p->colour_));
+		D3DXCOLOR colour;
+		getRandomColour(&colour);
+		particles_.setColour(p, colour);
 		// set lifetime 
-		p -> lifetime_ = getRandomLifetime();
+		particles_.lifetime_[p] = getRandomLifetime();
 		// set particle size
-		p -> size_ = getRandomSize();
-
-		++particlesAlive_;
+		particles_.size_[p] = getRandomSize();
 	}
 };
 
@@ -0,0 +1,124 @@
+#include "RandomEngine.h"
+#include <emmintrin.h>	// SSE2
+
+
+// multiplier turning the upper 24 bits of a random number into a float in [0, 1)
+static const float RANDOM_TO_UNIT = 1.0f / 16777216.0f;
+
+// splitmix32, used to spread a single seed over the state words
+static unsigned int splitMix(unsigned int& x)
+{
+	unsigned int z = (x += 0x9E3779B9u);
+
+	z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+	z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+	return z ^ (z >> 16);
+}
+
+static inline unsigned int rotateLeft(unsigned int x, int k)
+{
+	return (x << k) | (x >> (32 - k));
+}
+
+static inline __m128i rotateLeft(__m128i x, int k)
+{
+	return _mm_or_si128(_mm_slli_epi32(x, k), _mm_srli_epi32(x, 32 - k));
+}
+
+RandomEngine::RandomEngine(unsigned int seed)
+{
+	this -> seed(seed);
+}
+
+void RandomEngine::seed(unsigned int seed)
+{
+	unsigned int x = seed;
+
+	// splitmix never gives four zero words in a row, so the state is always valid
+	for (int i = 0; i < 4; ++i) state_[i] = splitMix(x);
+	for (int i = 0; i < 16; ++i) lanes_[i] = splitMix(x);
+}
+
+unsigned int RandomEngine::next(void)
+{
+	unsigned int result = state_[0] + state_[3];
+	unsigned int t = state_[1] << 9;
+
+	state_[2] ^= state_[0];
+	state_[3] ^= state_[1];
+	state_[1] ^= state_[2];
+	state_[0] ^= state_[3];
+	state_[2] ^= t;
+	state_[3] = rotateLeft(state_[3], 11);
+
+	return result;
+}
+
+unsigned int RandomEngine::number(unsigned int a, unsigned int b)
+{
+	if (b <= a) return a;
+
+	// the upper bits are the better ones for xoshiro128+
+	return a + static_cast<unsigned int>((static_cast<unsigned long long>(next()) * (b - a)) >> 32);
+}
+
+float RandomEngine::uniform(float lo, float hi)
+{
+	return lo + static_cast<float>(next() >> 8) * RANDOM_TO_UNIT * (hi - lo);
+}
+
+void RandomEngine::fill(float* out, int n, float lo, float hi)
+{
+	__m128i s0 = _mm_loadu_si128(reinterpret_cast<__m128i*>(lanes_));
+	__m128i s1 = _mm_loadu_si128(reinterpret_cast<__m128i*>(lanes_ + 4));
+	__m128i s2 = _mm_loadu_si128(reinterpret_cast<__m128i*>(lanes_ + 8));
+	__m128i s3 = _mm_loadu_si128(reinterpret_cast<__m128i*>(lanes_ + 12));
+
+	const __m128 scale = _mm_set1_ps(RANDOM_TO_UNIT * (hi - lo));
+	const __m128 offset = _mm_set1_ps(lo);
+
+	for (int i = 0; i < n; i += 4)
+	{
+		// the same steps as next(), for four states at once
+		__m128i result = _mm_add_epi32(s0, s3);
+		__m128i t = _mm_slli_epi32(s1, 9);
+
+		s2 = _mm_xor_si128(s2, s0);
+		s3 = _mm_xor_si128(s3, s1);
+		s1 = _mm_xor_si128(s1, s2);
+		s0 = _mm_xor_si128(s0, s3);
+		s2 = _mm_xor_si128(s2, t);
+		s3 = rotateLeft(s3, 11);
+
+		// the upper 24 bits fit into a float without rounding
+		__m128 values = _mm_add_ps(offset, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(result, 8)), scale));
+
+		if (i + 4 <= n)
+		{
+			_mm_storeu_ps(out + i, values);
+		}
+		else
+		{
+			float rest[4];
+			_mm_storeu_ps(rest, values);
+			for (int j = i; j < n; ++j) out[j] = rest[j - i];
+		}
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes_), s0);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes_ + 4), s1);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes_ + 8), s2);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes_ + 12), s3);
+}
+
+void RandomEngine::saveState(Snapshot& snapshot) const
+{
+	snapshot.write(state_);
+	snapshot.write(lanes_);
+}
+
+void RandomEngine::restoreState(Snapshot& snapshot)
+{
+	snapshot.read(&state_);
+	snapshot.read(&lanes_);
+}
@@ -0,0 +1,38 @@
+/*
+A small random number generator (xoshiro128+) to replace rand(). Every particle system owns one, so systems can be
+updated from different threads and a show seeded with the same numbers always looks the same.
+*/
+
+#ifndef RANDOM_ENGINE_H
+#define RANDOM_ENGINE_H
+
+#include "Snapshot.h"
+
+class RandomEngine
+{
+public:
+	RandomEngine(unsigned int seed = 1);
+
+	void seed(unsigned int seed);		// restarts the sequence, the same seed always gives the same numbers
+
+	unsigned int next(void);			// a random 32 bit number
+
+	// returns a random integer number in the range [a, b) (a if the range is empty)
+	unsigned int number(unsigned int a, unsigned int b);
+
+	// returns a random float in the range [lo, hi)
+	float uniform(float lo, float hi);
+
+	// fills 'out' with 'n' random floats in the range [lo, hi), 4 at a time (SSE2)
+	void fill(float* out, int n, float lo, float hi);
+
+	// continues the sequence from where it was when the state was saved
+	void saveState(Snapshot& snapshot) const;
+	void restoreState(Snapshot& snapshot);
+
+private:
+	unsigned int state_[4];		// state for the single numbers
+	unsigned int lanes_[16];	// four independent states for the bulk numbers, interleaved word by word for SSE2
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "RecordingRenderBackend.h"
+
+
+RecordingRenderBackend::RecordingRenderBackend(RenderBackend* target) : target_(target), texture_(NULL), calls_(NULL)
+{
+	resetStatistics();
+}
+
+RecordingRenderBackend::~RecordingRenderBackend(void)
+{
+}
+
+void RecordingRenderBackend::resetStatistics(void)
+{
+	ZeroMemory(&statistics_, sizeof(statistics_));
+}
+
+RenderTexture RecordingRenderBackend::loadTexture(const char* file)
+{
+	return target_ -> loadTexture(file);
+}
+
+void RecordingRenderBackend::releaseTexture(RenderTexture texture)
+{
+	target_ -> releaseTexture(texture);
+}
+
+HRESULT RecordingRenderBackend::createVertexStream(int capacity)
+{
+	return target_ -> createVertexStream(capacity);
+}
+
+void RecordingRenderBackend::releaseVertexStream(void)
+{
+	target_ -> releaseVertexStream();
+}
+
+POINTVERTEX* RecordingRenderBackend::lockVertices(int first, int count, bool discard)
+{
+	++statistics_.locks_;
+	if (discard) ++statistics_.discards_;
+
+	if (calls_)
+	{
+		RenderCall call = {LockCall, first, count, discard};
+		calls_ -> push_back(call);
+	}
+
+	return target_ -> lockVertices(first, count, discard);
+}
+
+void RecordingRenderBackend::unlockVertices(int written)
+{
+	statistics_.bytesUploaded_ += static_cast<long long>(written) * sizeof(POINTVERTEX);
+
+	if (calls_)
+	{
+		RenderCall call = {UnlockCall, 0, written, false};
+		calls_ -> push_back(call);
+	}
+
+	target_ -> unlockVertices(written);
+}
+
+void RecordingRenderBackend::bindPoints(PointShading shading, RenderTexture texture, float size)
+{
+	++statistics_.binds_;
+	if (statistics_.binds_ == 1 || texture != texture_) ++statistics_.textureChanges_;
+	texture_ = texture;
+
+	target_ -> bindPoints(shading, texture, size);
+}
+
+void RecordingRenderBackend::unbindPoints(void)
+{
+	target_ -> unbindPoints();
+}
+
+void RecordingRenderBackend::drawPoints(int first, int count)
+{
+	++statistics_.draws_;
+	statistics_.pointsDrawn_ += count;
+
+	if (calls_)
+	{
+		RenderCall call = {DrawCall, first, count, false};
+		calls_ -> push_back(call);
+	}
+
+	target_ -> drawPoints(first, count);
+}
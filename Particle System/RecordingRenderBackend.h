@@ -0,0 +1,75 @@
+/*
+A render backend that passes everything on to another backend and counts what is submitted: the locks of the vertex
+stream, the bytes written to it, the state and texture changes and the points drawn. Put in front of the Direct 3D
+backend it shows the cost of the render submission, put in front of the null backend it does so without a device.
+The locks and draws can also be logged one by one, to check the ranges and lock flags the vertex ring uses.
+*/
+
+#ifndef RECORDING_RENDER_BACKEND_H
+#define RECORDING_RENDER_BACKEND_H
+
+#include "RenderBackend.h"
+#include <vector>
+
+struct RenderStatistics
+{
+	int locks_;						// locks of the vertex stream
+	int discards_;					// locks that gave up the contents of the stream
+	long long bytesUploaded_;		// bytes written to the vertex stream
+	int binds_;						// calls of bindPoints
+	int textureChanges_;			// binds with another texture than the one before
+	int draws_;						// calls of drawPoints
+	long long pointsDrawn_;
+};
+
+// a call of the vertex stream or of drawPoints, as written to the call log
+enum RenderCallType
+{
+	LockCall,		// first_ and count_ of the range locked, with or without discarding the stream
+	UnlockCall,		// count_ is the number of points written
+	DrawCall		// first_ and count_ of the points drawn
+};
+
+struct RenderCall
+{
+	RenderCallType type_;
+	int first_;
+	int count_;
+	bool discard_;
+};
+
+class RecordingRenderBackend : public RenderBackend
+{
+public:
+	RecordingRenderBackend(RenderBackend* target);		// the target is not owned by the recording backend
+	virtual ~RecordingRenderBackend(void);
+
+	virtual RenderTexture loadTexture(const char* file);
+	virtual void releaseTexture(RenderTexture texture);
+
+	virtual HRESULT createVertexStream(int capacity);
+	virtual void releaseVertexStream(void);
+	virtual POINTVERTEX* lockVertices(int first, int count, bool discard);
+	virtual void unlockVertices(int written);
+
+	virtual void bindPoints(PointShading shading, RenderTexture texture, float size);
+	virtual void unbindPoints(void);
+	virtual void drawPoints(int first, int count);
+
+	const RenderStatistics& statistics(void) const {return statistics_;}
+	void resetStatistics(void);
+
+	// appends the locks, unlocks and draws to 'calls' from now on (NULL stops it), to check the order and the ranges
+	void recordCalls(std::vector<RenderCall>* calls) {calls_ = calls;}
+
+private:
+	RenderBackend* target_;
+	RenderStatistics statistics_;
+	RenderTexture texture_;			// the texture of the last bind
+	std::vector<RenderCall>* calls_;	// the call log (NULL if the calls are only counted)
+
+	RecordingRenderBackend(const RecordingRenderBackend&);
+	RecordingRenderBackend& operator=(const RecordingRenderBackend&);
+};
+
+#endif
@@ -0,0 +1,48 @@
+/*
+The interface between the particle systems and the graphics API. All the particle systems need is a vertex stream
+shared by all of them, the states and texture for drawing their point sprites and the drawing of a range of points.
+The same simulation can thus be drawn with Direct 3D, drawn on the CPU (without any GPU), not be drawn at all (to
+profile the simulation on its own) or be recorded (to measure what is submitted to the driver).
+*/
+
+#ifndef RENDER_BACKEND_H
+#define RENDER_BACKEND_H
+
+#include "Direct3DTypes.h"
+#include "ParticleData.h"
+
+// how the point sprites of a particle system are coloured
+enum PointShading
+{
+	TexturedPoints,		// colour and alpha are taken from the texture
+	ColouredPoints		// the colour of the vertex, its alpha modulated by the alpha of the texture
+};
+
+// a texture loaded by a render backend, only meaningful to the backend that loaded it
+typedef void* RenderTexture;
+
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend(void) {}
+
+	virtual RenderTexture loadTexture(const char* file) = 0;	// returns NULL if the texture could not be loaded
+	virtual void releaseTexture(RenderTexture texture) = 0;
+
+	// the vertex stream shared by all particle systems, with room for 'capacity' points
+	virtual HRESULT createVertexStream(int capacity) = 0;
+	virtual void releaseVertexStream(void) = 0;
+
+	// maps the points [first, first + count) of the stream for writing, returns NULL if that fails. With 'discard' the
+	// previous contents of the whole stream are given up, otherwise points drawn before must not be written to.
+	virtual POINTVERTEX* lockVertices(int first, int count, bool discard) = 0;
+	virtual void unlockVertices(int written) = 0;	// 'written' points have been written from the start of the range
+
+	// sets the states and the texture for drawing point sprites, 'size' is used for points without a size of their own
+	// (0 leaves it as it is)
+	virtual void bindPoints(PointShading shading, RenderTexture texture, float size) = 0;
+	virtual void unbindPoints(void) = 0;			// restores the states changed by bindPoints
+	virtual void drawPoints(int first, int count) = 0;
+};
+
+#endif
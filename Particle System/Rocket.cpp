@@ -1,12 +1,12 @@
 #include "Rocket.h"
 
 
-Rocket::Rocket(D3DXVECTOR3 startPosition, Projectile* projectile, ProjectileTrace* trace, FireworkParticleSystem* effect) : startPosition_(startPosition), state_(Ready), projectile_(projectile), trace_(trace), effect_(effect)
+Rocket::Rocket(D3DXVECTOR3 startPosition, Projectile* projectile, ProjectileTrace* trace, FireworkParticleSystem* effect) : startPosition_(startPosition), projectile_(projectile), trace_(trace), effect_(effect), state_(Ready)
 {
 
 }
 
-Rocket::Rocket() : state_(Ready), projectile_(nullptr), trace_(nullptr), effect_(nullptr)
+Rocket::Rocket() : projectile_(nullptr), trace_(nullptr), effect_(nullptr), state_(Ready)
 {
 }
 
@@ -17,36 +17,75 @@ Rocket::~Rocket(void)
 // starts the rocket
 void Rocket::fire(void)
 {
+	if (state_ != Ready) return;
 	state_ = Flying;
+
+	// the explosion is built while the rocket is flying, so it only needs to be copied when the rocket explodes
+	effect_->prebuildBatch();
 }
 
-// called every frame
+// called for every simulation step
 void Rocket::update(void)
 {
+	step(false, 0);
+}
+
+void Rocket::updateAndEmit(float alpha)
+{
+	step(true, alpha);
+}
+
+void Rocket::step(bool emit, float alpha)
+{
+	// The particle systems only hold particles of the pool while they are needed. If the pool has no room left, the
+	// launch (or the explosion) is delayed until other rockets have given back their particles.
 	switch(state_)
 	{
+	case Ready:
+		// (the particles of the last run have been given back by the reset)
+		break;
 	case Flying:
-		projectile_->update();
+		if(!projectile_->leaseParticles() || !trace_->leaseParticles()) break;
+
+		projectile_->step();
+		trace_->step();
 		if(projectile_->isExploded())
 		{
+			effect_->waitForPrebuild();
+
 			// set the origin of the effect to the last position of the projectile
 			effect_->origin_ = *(projectile_->getProjectilePosition());
 			state_ = Exploded;
+
+			// neither the projectile nor the trace are shown after the explosion
+			projectile_->returnParticles();
+			trace_->returnParticles();
 		}
-		trace_->update();
 		break;
 	case Exploded:
-		effect_->update();
+		if(!effect_->leaseParticles()) break;
+
+		if(emit) effect_->updateAndEmit(alpha);
+		else effect_->step();
+
+		// once the last particle died there is nothing left to do, the pool gets the particles back right away
+		if(effect_->isIdle())
+		{
+			effect_->returnParticles();
+			state_ = Finished;
+		}
+		break;
+	case Finished:
 		break;
 	}
 }
 
-void Rocket::initialise(LPDIRECT3DDEVICE9 device)
+void Rocket::initialise(RenderBackend* renderBackend, VertexRing* vertexRing, ParticlePool* particlePool, JobSystem* jobSystem)
 {
 	// initialise the associated particle systems
-	projectile_ -> initialise(device);
-	trace_ -> initialise(device);
-	effect_ -> initialise(device);
+	projectile_ -> initialise(renderBackend, vertexRing, particlePool, jobSystem);
+	trace_ -> initialise(renderBackend, vertexRing, particlePool, jobSystem);
+	effect_ -> initialise(renderBackend, vertexRing, particlePool, jobSystem);
 
 	// some further initialising
 	projectile_ -> origin_ = startPosition_;
@@ -57,6 +96,42 @@ void Rocket::initialise(LPDIRECT3DDEVICE9 device)
 	effect_ -> setProjectile(projectile_);
 }
 
+// seeds the random number engines of the associated particle systems (each one differently)
+void Rocket::seedRandom(unsigned int seed)
+{
+	projectile_ -> seedRandom(hash_numbers(seed, 0));
+	trace_ -> seedRandom(hash_numbers(seed, 1));
+	effect_ -> seedRandom(hash_numbers(seed, 2));
+}
+
+int Rocket::particlesAlive() const
+{
+	return projectile_->particlesAlive_ + trace_->particlesAlive_ + effect_->particlesAlive_;
+}
+
+void Rocket::saveState(Snapshot& snapshot) const
+{
+	snapshot.write(state_);
+
+	projectile_ -> saveState(snapshot);
+	trace_ -> saveState(snapshot);
+	effect_ -> saveState(snapshot);
+}
+
+void Rocket::restoreState(Snapshot& snapshot)
+{
+	snapshot.read(&state_);
+	if (state_ != Ready && state_ != Flying && state_ != Exploded && state_ != Finished)
+	{
+		snapshot.invalidate();
+		state_ = Ready;
+	}
+
+	projectile_ -> restoreState(snapshot);
+	trace_ -> restoreState(snapshot);
+	effect_ -> restoreState(snapshot);
+}
+
 // resets the rocket to be fired another time
 void Rocket::reset()
 {
@@ -71,6 +146,21 @@ void Rocket::reset()
 	effect_ -> origin_ = startPosition_;
 }
 
+// called every frame, before rendering
+void Rocket::emitVertices(float alpha)
+{
+	switch(state_)
+	{
+	case Flying:
+		projectile_->emitVertices(alpha);
+		trace_->emitVertices(alpha);
+		break;
+	case Exploded:
+		effect_->emitVertices(alpha);
+		break;
+	}
+}
+
 // render the particle systems
 void Rocket::render(void)
 {
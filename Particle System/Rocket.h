@@ -15,7 +15,8 @@ enum RocketState
 {
 	Ready,		// the rocket has been created and is ready to be fired
 	Flying,		// the rocket has been fired but not yet exploded
-	Exploded	// the rocket has exploded
+	Exploded,	// the rocket has exploded
+	Finished	// the effect is over and all particles have been given back, the rocket can be reset
 };
 
 class Rocket
@@ -25,11 +26,20 @@ public:
 	Rocket();
 	~Rocket(void);
 
-	void initialise(LPDIRECT3DDEVICE9 device);
+	void initialise(RenderBackend* renderBackend, VertexRing* vertexRing, ParticlePool* particlePool, JobSystem* jobSystem);
 	void fire();
-	void update();
+	void update();						// a single simulation step
+	// the last simulation step of a frame, the effect writes its points while it is stepped ('alpha' as for
+	// emitVertices, the frame of the vertex ring has to be begun)
+	void updateAndEmit(float alpha);
+	void emitVertices(float alpha);		// writes the points of the visible particle systems to the vertex buffer
 	void render();
 	void reset();
+	void seedRandom(unsigned int seed);
+	int particlesAlive() const;			// the particles of all associated systems
+	bool isFinished() const {return state_ == Finished;}
+	void saveState(Snapshot& snapshot) const;
+	void restoreState(Snapshot& snapshot);
 
 	D3DXVECTOR3 startPosition_;			// the current position of the rocket (identical to position of the projectile particle)
 
@@ -37,6 +47,8 @@ public:
 	ProjectileTrace* trace_;			// emitted while the rocket is flying
 	FireworkParticleSystem* effect_;	// started when the rocket explodes
 private:
+	void step(bool emit, float alpha);
+
 	RocketState state_;
 };
 
@@ -0,0 +1,26 @@
+/*
+The commands of a show: what the launch scheduler asks the rockets to do at the times of the show.
+They used to be sent by the fireworks timer from a thread of its own, through a lock-free single-producer/single-consumer
+queue to the simulation. The launch scheduler fires them while the clock is advanced on the simulation thread, between
+two steps, so no command crosses a thread any more and the queue has been removed.
+*/
+
+#ifndef ROCKET_COMMAND_H
+#define ROCKET_COMMAND_H
+
+// what the simulation is asked to do
+enum RocketCommandType
+{
+	FireRocket,		// launch the rocket
+	ResetRocket,	// put the rocket back to be fired again
+	LoopShow,		// start the show over
+	StopShow		// take all rockets off the scene at once, they are reset
+};
+
+struct RocketCommand
+{
+	RocketCommandType type_;
+	int rocket_;			// index of the rocket the command is meant for (unused for StopShow)
+};
+
+#endif
@@ -0,0 +1,306 @@
+#include "Show.h"
+#include "EffectStar.h"
+#include "EffectCone.h"
+#include "EffectMultiSphere.h"
+#include "EffectRays.h"
+
+
+Show::Show(void) : loopPause_(0), jobSystem_(NULL)
+{
+}
+
+Show::~Show(void)
+{
+	clear();
+}
+
+void Show::clear(void)
+{
+	for (size_t i = 0; i < systems_.size(); ++i)
+	{
+		delete systems_[i];
+	}
+	systems_.clear();
+	rockets_.clear();
+	launchTimes_.clear();
+	finished_.clear();
+	loopPause_ = 0;
+}
+
+HRESULT Show::build(const ShowDescription& description, const std::vector<RenderTexture>& textures)
+{
+	clear();
+
+	if (static_cast<int>(textures.size()) < description.textureCount()) return E_INVALIDARG;
+
+	int rocketCount = description.rocketCount();
+	rockets_.resize(rocketCount);
+	launchTimes_.resize(rocketCount);
+	systems_.reserve(rocketCount * 3);
+	loopPause_ = description.loopPause();
+
+	// every rocket gets systems of its own, even if it shares their parameters with other rockets
+	for (int i = 0; i < rocketCount; ++i)
+	{
+		const RocketRecord& record = description.rocket(i);
+		const SystemRecord& projectile = description.system(record.projectile_);
+		const SystemRecord& trace = description.system(record.trace_);
+		const SystemRecord& effect = description.system(record.effect_);
+
+		Rocket& rocket = rockets_[i];
+		rocket.startPosition_ = D3DXVECTOR3(record.position_[0], record.position_[1], record.position_[2]);
+		rocket.projectile_ = static_cast<Projectile*>(createSystem(projectile, projectile.texture_ >= 0 ? textures[projectile.texture_] : NULL));
+		rocket.trace_ = static_cast<ProjectileTrace*>(createSystem(trace, trace.texture_ >= 0 ? textures[trace.texture_] : NULL));
+		rocket.effect_ = createSystem(effect, effect.texture_ >= 0 ? textures[effect.texture_] : NULL);
+
+		launchTimes_[i] = record.launchTime_;
+	}
+
+	return S_OK;
+}
+
+FireworkParticleSystem* Show::createSystem(const SystemRecord& record, RenderTexture texture)
+{
+	FireworkParticleSystem* system = NULL;
+
+	switch (record.type_)
+	{
+	case ProjectileSystem:
+	{
+		Projectile* projectile = new Projectile();
+		projectile->launchAngle_ = record.launchAngle_;
+		system = projectile;
+		break;
+	}
+	case TraceSystem:
+		system = new ProjectileTrace();
+		break;
+	case SphereSystem:
+		system = new EffectSphere();
+		break;
+	case StarSystem:
+	{
+		EffectStar* star = new EffectStar();
+		star->numberOfRays_ = record.numberOfRays_;
+		system = star;
+		break;
+	}
+	case ConeSystem:
+	{
+		EffectCone* cone = new EffectCone();
+		cone->launchAngle = record.launchAngle_;
+		system = cone;
+		break;
+	}
+	case MultiSphereSystem:
+	{
+		EffectMultiSphere* multiSphere = new EffectMultiSphere();
+		multiSphere->subExplosionSize_ = record.subExplosionSize_;
+		multiSphere->subParticleMaxSize_ = record.subParticleMaxSize_;
+		multiSphere->subParticleLaunchVelocity_ = record.subParticleLaunchVelocity_;
+		multiSphere->subParticleBaseColour_ = D3DXCOLOR(record.subParticleBaseColour_);
+		multiSphere->subParticleFadeOutTime_ = record.subParticleFadeOutTime_;
+		multiSphere->subParticleMaxColourDivergence_ = D3DXVECTOR3(record.subParticleMaxColourDivergence_);
+		multiSphere->subParticleMaxLifetimeDivergence_ = record.subParticleMaxLifetimeDivergence_;
+		multiSphere->subParticleMaxSizeDivergence_ = record.subParticleMaxSizeDivergence_;
+		multiSphere->subParticleMaxVelocityDivergence_ = record.subParticleMaxVelocityDivergence_;
+		multiSphere->subParticleMaxLifetime_ = record.subParticleMaxLifetime_;
+		system = multiSphere;
+		break;
+	}
+	case RaysSystem:
+	{
+		EffectRays* rays = new EffectRays();
+		rays->subParticleMaxSize_ = record.subParticleMaxSize_;
+		rays->subParticleLaunchVelocity_ = record.subParticleLaunchVelocity_;
+		rays->subParticleBaseColour_ = D3DXCOLOR(record.subParticleBaseColour_);
+		rays->subParticleFadeOutTime_ = record.subParticleFadeOutTime_;
+		rays->subParticleMaxColourDivergence_ = D3DXVECTOR3(record.subParticleMaxColourDivergence_);
+		rays->subParticleMaxLifetimeDivergence_ = record.subParticleMaxLifetimeDivergence_;
+		rays->subParticleMaxSizeDivergence_ = record.subParticleMaxSizeDivergence_;
+		rays->subParticleMaxVelocityDivergence_ = record.subParticleMaxVelocityDivergence_;
+		rays->subParticleMaxLifetime_ = record.subParticleMaxLifetime_;
+		system = rays;
+		break;
+	}
+	}
+
+	// the parameters all systems have in common
+	system->maxParticles_ = record.maxParticles_;
+	system->startParticles_ = record.startParticles_;
+	system->maxLifetime_ = record.maxLifetime_;
+	system->startIntervalSteps_ = record.startInterval_ < 0 ? -1 : secondsToSteps(record.startInterval_);
+	system->startCountdown_ = 0;
+	system->timeIncrement_ = record.timeIncrement_;
+	system->maxParticleSize_ = record.maxParticleSize_;
+	system->particleTexture_ = texture;
+	system->baseColour_ = D3DXCOLOR(record.baseColour_);
+	system->fadeOutTime_ = record.fadeOutTime_;
+	system->maxColourDivergence_ = D3DXVECTOR3(record.maxColourDivergence_);
+	system->maxLifetimeDivergence_ = record.maxLifetimeDivergence_;
+	system->maxSizeDivergence_ = record.maxSizeDivergence_;
+	system->maxVelocityDivergence_ = record.maxVelocityDivergence_;
+	system->launchVelocity_ = record.launchVelocity_;
+
+	systems_.push_back(system);
+	return system;
+}
+
+void Show::initialise(RenderBackend* renderBackend, VertexRing* vertexRing, ParticlePool* particlePool, JobSystem* jobSystem)
+{
+	jobSystem_ = jobSystem;
+	for (size_t i = 0; i < rockets_.size(); ++i)
+	{
+		rockets_[i].initialise(renderBackend, vertexRing, particlePool, jobSystem);
+	}
+}
+
+void Show::seedRandom(unsigned int seed)
+{
+	for (size_t i = 0; i < rockets_.size(); ++i)
+	{
+		rockets_[i].seedRandom(hash_numbers(seed, static_cast<unsigned int>(i)));
+	}
+}
+
+void Show::setMotion(ParticleMotion motion)
+{
+	for (size_t i = 0; i < systems_.size(); ++i)
+	{
+		systems_[i] -> setMotion(motion);
+	}
+}
+
+void Show::schedule(LaunchScheduler& scheduler, long long start)
+{
+	long long millisecond = SCHEDULER_TICKS_PER_SECOND / 1000;
+	float end = 0;
+
+	for (int i = 0; i < rocketCount(); ++i)
+	{
+		RocketCommand fire = {FireRocket, i};
+		scheduler.schedule(start + static_cast<long long>(launchTimes_[i] * millisecond), fire);
+
+		if (launchTimes_[i] > end) end = launchTimes_[i];
+	}
+
+	// wait for some time and prepare for another run of the firework
+	long long loop = start + static_cast<long long>((end + loopPause_) * millisecond);
+	for (int i = 0; i < rocketCount(); ++i)
+	{
+		RocketCommand reset = {ResetRocket, i};
+		scheduler.schedule(loop, reset);
+	}
+
+	RocketCommand again = {LoopShow, -1};
+	scheduler.schedule(loop, again);
+}
+
+void Show::execute(const RocketCommand& command, long long tick, LaunchScheduler& scheduler)
+{
+	switch (command.type_)
+	{
+	case FireRocket:
+		rockets_[command.rocket_].fire();
+		break;
+	case ResetRocket:
+		rockets_[command.rocket_].reset();
+		break;
+	case LoopShow:
+		schedule(scheduler, tick);
+		break;
+	case StopShow:
+		// the show is over, take all rockets off the scene
+		for (size_t i = 0; i < rockets_.size(); ++i)
+		{
+			rockets_[i].reset();
+		}
+		break;
+	}
+}
+
+void Show::update(void)
+{
+	step(false, 0);
+}
+
+void Show::updateAndEmit(float alpha)
+{
+	step(true, alpha);
+}
+
+void Show::step(bool emit, float alpha)
+{
+	// the projectile of a rocket is always updated before its trace (the explosions being prebuilt meanwhile are not
+	// waited for, every effect waits for its own batch before it is touched)
+	JobSystem::Counter counter(0);
+	for (size_t i = 0; i < rockets_.size(); ++i)
+	{
+		Rocket* rocket = &rockets_[i];
+		if (jobSystem_) jobSystem_ -> submit([rocket, emit, alpha] {if (emit) rocket->updateAndEmit(alpha); else rocket->update();}, &counter);
+		else if (emit) rocket->updateAndEmit(alpha);
+		else rocket->update();
+	}
+	if (jobSystem_) jobSystem_ -> wait(&counter);
+
+	// recycle the rockets that are done instead of keeping them until the show loops
+	finished_.clear();
+	for (size_t i = 0; i < rockets_.size(); ++i)
+	{
+		if (!rockets_[i].isFinished()) continue;
+
+		finished_.push_back(static_cast<int>(i));
+		rockets_[i].reset();
+	}
+}
+
+void Show::emitVertices(float alpha)
+{
+	JobSystem::Counter counter(0);
+	for (size_t i = 0; i < rockets_.size(); ++i)
+	{
+		Rocket* rocket = &rockets_[i];
+		if (jobSystem_) jobSystem_ -> submit([rocket, alpha] {rocket->emitVertices(alpha);}, &counter);
+		else rocket->emitVertices(alpha);
+	}
+	if (jobSystem_) jobSystem_ -> wait(&counter);
+}
+
+void Show::render(void)
+{
+	for (size_t i = 0; i < rockets_.size(); ++i)
+	{
+		rockets_[i].render();
+	}
+}
+
+int Show::particlesAlive(void) const
+{
+	int alive = 0;
+	for (size_t i = 0; i < rockets_.size(); ++i)
+	{
+		alive += rockets_[i].particlesAlive();
+	}
+	return alive;
+}
+
+void Show::saveState(Snapshot& snapshot) const
+{
+	snapshot.write(rocketCount());
+	for (size_t i = 0; i < rockets_.size(); ++i)
+	{
+		rockets_[i].saveState(snapshot);
+	}
+}
+
+void Show::restoreState(Snapshot& snapshot)
+{
+	int rockets = 0;
+	snapshot.read(&rockets);
+	if (rockets != rocketCount()) snapshot.invalidate();
+
+	for (size_t i = 0; i < rockets_.size() && snapshot.valid(); ++i)
+	{
+		rockets_[i].restoreState(snapshot);
+	}
+}
@@ -0,0 +1,68 @@
+/*
+The rockets of a show and their particle systems, created from a show description.
+*/
+
+#ifndef SHOW_H
+#define SHOW_H
+
+#include "ShowDescription.h"
+#include "Rocket.h"
+#include "LaunchScheduler.h"
+#include <vector>
+
+class Show
+{
+public:
+	Show(void);
+	~Show(void);
+
+	// creates the rockets and their particle systems, 'textures' holds the loaded texture for every texture of the
+	// description (the show does not take ownership)
+	HRESULT build(const ShowDescription& description, const std::vector<RenderTexture>& textures);
+	void clear(void);		// deletes all rockets and particle systems
+
+	void initialise(RenderBackend* renderBackend, VertexRing* vertexRing, ParticlePool* particlePool, JobSystem* jobSystem);
+	void seedRandom(unsigned int seed);		// every rocket gets its own numbers derived from the seed
+	void setMotion(ParticleMotion motion);	// for all effects that support it (see FireworkParticleSystem::setMotion)
+
+	// queues the launches of all rockets relative to 'start' (in ticks of the scheduler), followed by the reset of the
+	// rockets and the next run of the show
+	void schedule(LaunchScheduler& scheduler, long long start);
+	// carries out a single command for the rockets, 'tick' is the time it was meant for
+	void execute(const RocketCommand& command, long long tick, LaunchScheduler& scheduler);
+
+	void update(void);					// a single simulation step of all rockets (every rocket is a job of its own)
+	void updateAndEmit(float alpha);	// the last step of a frame, see Rocket::updateAndEmit
+
+	// the rockets that finished during the last update, they have been reset already and are ready to be fired again
+	const std::vector<int>& finishedRockets(void) const {return finished_;}
+	void emitVertices(float alpha);		// writes the points of all rockets to the vertex ring
+	void render(void);
+	int particlesAlive(void) const;
+
+	// the state of all rockets (the scheduler, the clock and the particle pool are saved on their own), a show can only
+	// be restored from a snapshot of the same show, if restoring fails the show has to be built again
+	void saveState(Snapshot& snapshot) const;
+	void restoreState(Snapshot& snapshot);
+
+	int rocketCount(void) const {return static_cast<int>(rockets_.size());}
+	Rocket& rocket(int i) {return rockets_[i];}
+	float launchTime(int i) const {return launchTimes_[i];}		// in milliseconds from the start of the show
+	float loopPause(void) const {return loopPause_;}				// in milliseconds after the last launch
+
+private:
+	void step(bool emit, float alpha);
+	FireworkParticleSystem* createSystem(const SystemRecord& record, RenderTexture texture);
+
+	std::vector<Rocket> rockets_;
+	std::vector<float> launchTimes_;
+	std::vector<FireworkParticleSystem*> systems_;	// owned by the show
+	std::vector<int> finished_;
+	float loopPause_;
+	JobSystem* jobSystem_;
+
+	Show(const Show&);
+	Show& operator=(const Show&);
+};
+
+#endif
@@ -0,0 +1,564 @@
+#include "ShowDescription.h"
+#include "SimulationClock.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stddef.h>		// offsetof
+#include <string>
+#include <map>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+//-----------------------------------------------------------------------------
+// binary form
+
+static const char SHOW_FILE_MAGIC[4] = {'F', 'W', 'S', 'H'};
+static const unsigned int SHOW_FILE_VERSION = 1;
+
+// the records follow the header in the order textures, systems, rockets
+struct ShowFileHeader
+{
+	char magic_[4];
+	unsigned int version_;
+	unsigned int recordSizes_[3];		// the size of the three record types, files written by other builds are refused
+	int textureCount_;
+	int systemCount_;
+	int rocketCount_;
+	unsigned int textureOffset_;		// in bytes from the start of the file
+	unsigned int systemOffset_;
+	unsigned int rocketOffset_;
+	float loopPause_;
+	unsigned long long sourceSize_;		// the text file the show was compiled from
+	unsigned long long sourceTime_;
+};
+
+// size and last write time of a file, to tell whether a binary show is older than its text file
+static bool fileStamp(const char* file, unsigned long long* size, unsigned long long* time)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(file, GetFileExInfoStandard, &attributes)) return false;
+
+	*size = (static_cast<unsigned long long>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+	*time = (static_cast<unsigned long long>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat attributes;
+	if (stat(file, &attributes) != 0) return false;
+
+	*size = static_cast<unsigned long long>(attributes.st_size);
+	*time = static_cast<unsigned long long>(attributes.st_mtime);
+#endif
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// text form
+
+static const char* SYSTEM_TYPE_NAMES[SYSTEM_TYPES] = {"projectile", "trace", "sphere", "star", "cone", "multisphere", "rays"};
+
+// the keys that can be given inside a system block and where their values go
+struct SystemField
+{
+	const char* key_;
+	size_t offset_;
+	int values_;
+	bool integer_;
+};
+
+static const SystemField SYSTEM_FIELDS[] =
+{
+	{"particles",				offsetof(SystemRecord, maxParticles_),						1, true},
+	{"batch",					offsetof(SystemRecord, startParticles_),					1, true},
+	{"lifetime",				offsetof(SystemRecord, maxLifetime_),						1, false},
+	{"interval",				offsetof(SystemRecord, startInterval_),						1, false},
+	{"timeIncrement",			offsetof(SystemRecord, timeIncrement_),						1, false},
+	{"size",					offsetof(SystemRecord, maxParticleSize_),					1, false},
+	{"colour",					offsetof(SystemRecord, baseColour_),						4, false},
+	{"fadeOut",					offsetof(SystemRecord, fadeOutTime_),						1, false},
+	{"colourDivergence",		offsetof(SystemRecord, maxColourDivergence_),				3, false},
+	{"lifetimeDivergence",		offsetof(SystemRecord, maxLifetimeDivergence_),				1, false},
+	{"sizeDivergence",			offsetof(SystemRecord, maxSizeDivergence_),					1, false},
+	{"velocityDivergence",		offsetof(SystemRecord, maxVelocityDivergence_),				1, false},
+	{"velocity",				offsetof(SystemRecord, launchVelocity_),					1, false},
+	{"angle",					offsetof(SystemRecord, launchAngle_),						1, false},
+	{"rays",					offsetof(SystemRecord, numberOfRays_),						1, true},
+	{"subExplosion",			offsetof(SystemRecord, subExplosionSize_),					1, true},
+	{"subSize",					offsetof(SystemRecord, subParticleMaxSize_),				1, false},
+	{"subVelocity",				offsetof(SystemRecord, subParticleLaunchVelocity_),			1, false},
+	{"subColour",				offsetof(SystemRecord, subParticleBaseColour_),				4, false},
+	{"subFadeOut",				offsetof(SystemRecord, subParticleFadeOutTime_),			1, false},
+	{"subColourDivergence",		offsetof(SystemRecord, subParticleMaxColourDivergence_),	3, false},
+	{"subLifetimeDivergence",	offsetof(SystemRecord, subParticleMaxLifetimeDivergence_),	1, false},
+	{"subSizeDivergence",		offsetof(SystemRecord, subParticleMaxSizeDivergence_),		1, false},
+	{"subVelocityDivergence",	offsetof(SystemRecord, subParticleMaxVelocityDivergence_),	1, false},
+	{"subLifetime",				offsetof(SystemRecord, subParticleMaxLifetime_),			1, false},
+};
+
+// reads the values of a field from the rest of a line, returns false if there are not enough of them
+static bool readField(const SystemField& field, const char* values, SystemRecord* system)
+{
+	char* target = reinterpret_cast<char*>(system) + field.offset_;
+
+	for (int i = 0; i < field.values_; ++i)
+	{
+		char* end;
+		if (field.integer_)
+			reinterpret_cast<int*>(target)[i] = static_cast<int>(strtol(values, &end, 10));
+		else
+			reinterpret_cast<float*>(target)[i] = static_cast<float>(strtod(values, &end));
+
+		if (end == values) return false;
+		values = end;
+	}
+	return true;
+}
+
+// the values of a system nothing has been said about
+static void defaultSystem(SystemRecord* system, int type)
+{
+	ZeroMemory(system, sizeof(SystemRecord));
+
+	system->type_ = type;
+	system->texture_ = -1;
+	system->startInterval_ = SIMULATION_STEP;
+	system->timeIncrement_ = 0.08f;
+	system->maxParticleSize_ = 1.0f;
+	system->baseColour_[0] = system->baseColour_[1] = system->baseColour_[2] = system->baseColour_[3] = 1.0f;
+}
+
+
+//-----------------------------------------------------------------------------
+
+ShowDescription::ShowDescription(void) : mapping_(NULL), mappingSize_(0)
+#ifdef _WIN32
+	, mappingHandle_(NULL)
+#endif
+{
+	error_[0] = 0;
+	clear();
+}
+
+ShowDescription::~ShowDescription(void)
+{
+	clear();
+}
+
+void ShowDescription::clear(void)
+{
+	if (mapping_)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(mapping_);
+		CloseHandle(mappingHandle_);
+		mappingHandle_ = NULL;
+#else
+		munmap(mapping_, mappingSize_);
+#endif
+	}
+	mapping_ = NULL;
+	mappingSize_ = 0;
+
+	textureStore_.clear();
+	systemStore_.clear();
+	rocketStore_.clear();
+
+	textures_ = NULL;
+	systems_ = NULL;
+	rockets_ = NULL;
+	textureCount_ = systemCount_ = rocketCount_ = 0;
+	loopPause_ = 4000.0f;
+	sourceSize_ = sourceTime_ = 0;
+}
+
+HRESULT ShowDescription::fail(const char* format, ...)
+{
+	va_list arguments;
+	va_start(arguments, format);
+	vsnprintf(error_, sizeof(error_), format, arguments);
+	va_end(arguments);
+
+	return E_FAIL;
+}
+
+HRESULT ShowDescription::loadText(const char* file)
+{
+	clear();
+	error_[0] = 0;
+
+	FILE* input = fopen(file, "r");
+	if (!input) return fail("%s: cannot be opened", file);
+	fileStamp(file, &sourceSize_, &sourceTime_);
+
+	std::map<std::string, int> textureNames;
+	std::map<std::string, int> systemNames;
+
+	enum {TopLevel, InSystem, InRocket} block = TopLevel;
+	char line[512];
+	int lineNumber = 0;
+	HRESULT result = S_OK;
+
+	while (SUCCEEDED(result) && fgets(line, sizeof(line), input))
+	{
+		++lineNumber;
+
+		// everything behind a '#' is a comment
+		char* comment = strchr(line, '#');
+		if (comment) *comment = 0;
+
+		char key[64], name[64], value[64];
+		int consumed = 0;
+		if (sscanf(line, " %63s%n", key, &consumed) != 1) continue;
+		const char* rest = line + consumed;
+
+		if (block == TopLevel)
+		{
+			if (strcmp(key, "texture") == 0)
+			{
+				TextureRecord texture;
+				ZeroMemory(&texture, sizeof(texture));
+				if (sscanf(rest, " %63s %63s", name, texture.file_) != 2)
+				{
+					result = fail("%s(%d): expected 'texture <name> <file>'", file, lineNumber);
+					break;
+				}
+				textureNames[name] = static_cast<int>(textureStore_.size());
+				textureStore_.push_back(texture);
+			}
+			else if (strcmp(key, "pause") == 0)
+			{
+				if (sscanf(rest, " %f", &loopPause_) != 1) result = fail("%s(%d): expected 'pause <milliseconds>'", file, lineNumber);
+			}
+			else if (strcmp(key, "system") == 0)
+			{
+				// system <name> <type> [like <system>]
+				char like[64], base[64];
+				int values = sscanf(rest, " %63s %63s %63s %63s", name, value, like, base);
+				if (values != 2 && !(values == 4 && strcmp(like, "like") == 0))
+				{
+					result = fail("%s(%d): expected 'system <name> <type> [like <system>]'", file, lineNumber);
+					break;
+				}
+
+				int type = 0;
+				while (type < SYSTEM_TYPES && strcmp(value, SYSTEM_TYPE_NAMES[type]) != 0) ++type;
+				if (type == SYSTEM_TYPES)
+				{
+					result = fail("%s(%d): unknown system type '%s'", file, lineNumber, value);
+					break;
+				}
+
+				SystemRecord system;
+				defaultSystem(&system, type);
+				if (values == 4)
+				{
+					if (systemNames.find(base) == systemNames.end())
+					{
+						result = fail("%s(%d): unknown system '%s'", file, lineNumber, base);
+						break;
+					}
+					system = systemStore_[systemNames[base]];
+					system.type_ = type;
+				}
+
+				systemNames[name] = static_cast<int>(systemStore_.size());
+				systemStore_.push_back(system);
+				block = InSystem;
+			}
+			else if (strcmp(key, "rocket") == 0)
+			{
+				RocketRecord rocket;
+				ZeroMemory(&rocket, sizeof(rocket));
+				rocket.projectile_ = rocket.trace_ = rocket.effect_ = -1;
+				if (sscanf(rest, " %f", &rocket.launchTime_) != 1)
+				{
+					result = fail("%s(%d): expected 'rocket <launch time in milliseconds>'", file, lineNumber);
+					break;
+				}
+
+				rocketStore_.push_back(rocket);
+				block = InRocket;
+			}
+			else
+			{
+				result = fail("%s(%d): unknown keyword '%s'", file, lineNumber, key);
+			}
+		}
+		else if (strcmp(key, "end") == 0)
+		{
+			if (block == InRocket)
+			{
+				const RocketRecord& rocket = rocketStore_.back();
+				if (rocket.projectile_ < 0 || rocket.trace_ < 0 || rocket.effect_ < 0)
+				{
+					result = fail("%s(%d): a rocket needs a projectile, a trace and an effect", file, lineNumber);
+				}
+			}
+			block = TopLevel;
+		}
+		else if (block == InSystem)
+		{
+			SystemRecord& system = systemStore_.back();
+
+			if (strcmp(key, "texture") == 0)
+			{
+				if (sscanf(rest, " %63s", name) != 1 || textureNames.find(name) == textureNames.end())
+				{
+					result = fail("%s(%d): unknown texture", file, lineNumber);
+					break;
+				}
+				system.texture_ = textureNames[name];
+				continue;
+			}
+
+			const int fields = sizeof(SYSTEM_FIELDS) / sizeof(SYSTEM_FIELDS[0]);
+			int field = 0;
+			while (field < fields && strcmp(key, SYSTEM_FIELDS[field].key_) != 0) ++field;
+
+			if (field == fields)
+				result = fail("%s(%d): unknown system parameter '%s'", file, lineNumber, key);
+			else if (!readField(SYSTEM_FIELDS[field], rest, &system))
+				result = fail("%s(%d): '%s' needs %d value(s)", file, lineNumber, key, SYSTEM_FIELDS[field].values_);
+		}
+		else
+		{
+			RocketRecord& rocket = rocketStore_.back();
+
+			if (strcmp(key, "position") == 0)
+			{
+				if (sscanf(rest, " %f %f %f", &rocket.position_[0], &rocket.position_[1], &rocket.position_[2]) != 3)
+					result = fail("%s(%d): expected 'position <x> <y> <z>'", file, lineNumber);
+				continue;
+			}
+
+			// the systems of the rocket must be of the right type
+			int* target = NULL;
+			bool typeMatches = false;
+			if (sscanf(rest, " %63s", name) == 1 && systemNames.find(name) != systemNames.end())
+			{
+				int type = systemStore_[systemNames[name]].type_;
+				if (strcmp(key, "projectile") == 0)
+				{
+					target = &rocket.projectile_;
+					typeMatches = type == ProjectileSystem;
+				}
+				else if (strcmp(key, "trace") == 0)
+				{
+					target = &rocket.trace_;
+					typeMatches = type == TraceSystem;
+				}
+				else if (strcmp(key, "effect") == 0)
+				{
+					target = &rocket.effect_;
+					typeMatches = type != ProjectileSystem && type != TraceSystem;
+				}
+			}
+
+			if (target && typeMatches)
+				*target = systemNames[name];
+			else
+				result = fail("%s(%d): expected 'projectile', 'trace' or 'effect' followed by a system of that kind", file, lineNumber);
+		}
+	}
+
+	fclose(input);
+
+	if (SUCCEEDED(result) && block != TopLevel) result = fail("%s: 'end' missing at the end of the file", file);
+
+	if (FAILED(result))
+	{
+		clear();
+		return result;
+	}
+
+	textureCount_ = static_cast<int>(textureStore_.size());
+	systemCount_ = static_cast<int>(systemStore_.size());
+	rocketCount_ = static_cast<int>(rocketStore_.size());
+	textures_ = textureCount_ ? &textureStore_[0] : NULL;
+	systems_ = systemCount_ ? &systemStore_[0] : NULL;
+	rockets_ = rocketCount_ ? &rocketStore_[0] : NULL;
+
+	HRESULT valid = validate();
+	if (FAILED(valid)) clear();
+	return valid;
+}
+
+HRESULT ShowDescription::saveBinary(const char* file)
+{
+	ShowFileHeader header;
+	ZeroMemory(&header, sizeof(header));
+
+	memcpy(header.magic_, SHOW_FILE_MAGIC, sizeof(header.magic_));
+	header.version_ = SHOW_FILE_VERSION;
+	header.recordSizes_[0] = sizeof(TextureRecord);
+	header.recordSizes_[1] = sizeof(SystemRecord);
+	header.recordSizes_[2] = sizeof(RocketRecord);
+	header.textureCount_ = textureCount_;
+	header.systemCount_ = systemCount_;
+	header.rocketCount_ = rocketCount_;
+	header.textureOffset_ = sizeof(ShowFileHeader);
+	header.systemOffset_ = header.textureOffset_ + textureCount_ * sizeof(TextureRecord);
+	header.rocketOffset_ = header.systemOffset_ + systemCount_ * sizeof(SystemRecord);
+	header.loopPause_ = loopPause_;
+	header.sourceSize_ = sourceSize_;
+	header.sourceTime_ = sourceTime_;
+
+	FILE* output = fopen(file, "wb");
+	if (!output) return fail("%s: cannot be written", file);
+
+	bool written = fwrite(&header, sizeof(header), 1, output) == 1;
+	if (textureCount_) written = written && fwrite(textures_, sizeof(TextureRecord), textureCount_, output) == static_cast<size_t>(textureCount_);
+	if (systemCount_) written = written && fwrite(systems_, sizeof(SystemRecord), systemCount_, output) == static_cast<size_t>(systemCount_);
+	if (rocketCount_) written = written && fwrite(rockets_, sizeof(RocketRecord), rocketCount_, output) == static_cast<size_t>(rocketCount_);
+
+	if (fclose(output) != 0) written = false;
+	return written ? S_OK : fail("%s: cannot be written", file);
+}
+
+HRESULT ShowDescription::loadBinary(const char* file, const char* source)
+{
+	clear();
+	error_[0] = 0;
+
+	// map the whole file
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE) return fail("%s: cannot be opened", file);
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(handle, &size);
+	mappingSize_ = static_cast<size_t>(size.QuadPart);
+
+	mappingHandle_ = mappingSize_ ? CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	CloseHandle(handle);	// the mapping keeps the file open
+	if (mappingHandle_) mapping_ = MapViewOfFile(mappingHandle_, FILE_MAP_READ, 0, 0, 0);
+	if (!mapping_)
+	{
+		if (mappingHandle_) CloseHandle(mappingHandle_);
+		mappingHandle_ = NULL;
+		return fail("%s: cannot be mapped", file);
+	}
+#else
+	int handle = open(file, O_RDONLY);
+	if (handle < 0) return fail("%s: cannot be opened", file);
+
+	struct stat attributes;
+	mappingSize_ = fstat(handle, &attributes) == 0 ? static_cast<size_t>(attributes.st_size) : 0;
+	void* view = mappingSize_ ? mmap(NULL, mappingSize_, PROT_READ, MAP_PRIVATE, handle, 0) : MAP_FAILED;
+	close(handle);
+	if (view == MAP_FAILED) return fail("%s: cannot be mapped", file);
+	mapping_ = view;
+#endif
+
+	const char* bytes = static_cast<const char*>(mapping_);
+	const ShowFileHeader* header = reinterpret_cast<const ShowFileHeader*>(bytes);
+
+	if (mappingSize_ < sizeof(ShowFileHeader) || memcmp(header->magic_, SHOW_FILE_MAGIC, sizeof(header->magic_)) != 0 ||
+		header->version_ != SHOW_FILE_VERSION || header->recordSizes_[0] != sizeof(TextureRecord) ||
+		header->recordSizes_[1] != sizeof(SystemRecord) || header->recordSizes_[2] != sizeof(RocketRecord))
+	{
+		clear();
+		return fail("%s: not a show compiled by this version", file);
+	}
+
+	// the records have to lie within the file
+	if (header->textureCount_ < 0 || header->systemCount_ < 0 || header->rocketCount_ < 0 ||
+		header->textureOffset_ + static_cast<unsigned long long>(header->textureCount_) * sizeof(TextureRecord) > mappingSize_ ||
+		header->systemOffset_ + static_cast<unsigned long long>(header->systemCount_) * sizeof(SystemRecord) > mappingSize_ ||
+		header->rocketOffset_ + static_cast<unsigned long long>(header->rocketCount_) * sizeof(RocketRecord) > mappingSize_ ||
+		(header->textureOffset_ | header->systemOffset_ | header->rocketOffset_) % sizeof(int) != 0)
+	{
+		clear();
+		return fail("%s: the file is damaged", file);
+	}
+
+	if (source)
+	{
+		unsigned long long size, time;
+		if (!fileStamp(source, &size, &time) || size != header->sourceSize_ || time != header->sourceTime_)
+		{
+			clear();
+			return fail("%s: out of date, %s has changed", file, source);
+		}
+	}
+
+	textures_ = reinterpret_cast<const TextureRecord*>(bytes + header->textureOffset_);
+	systems_ = reinterpret_cast<const SystemRecord*>(bytes + header->systemOffset_);
+	rockets_ = reinterpret_cast<const RocketRecord*>(bytes + header->rocketOffset_);
+	textureCount_ = header->textureCount_;
+	systemCount_ = header->systemCount_;
+	rocketCount_ = header->rocketCount_;
+	loopPause_ = header->loopPause_;
+	sourceSize_ = header->sourceSize_;
+	sourceTime_ = header->sourceTime_;
+
+	HRESULT result = validate();
+	if (FAILED(result)) clear();
+	return result;
+}
+
+HRESULT ShowDescription::setRockets(const RocketRecord* rockets, int count)
+{
+	// the rockets may be the current ones
+	std::vector<RocketRecord> replacement(rockets, rockets + count);
+
+	// the records of a mapped file are read only, so the show takes copies of them before the file is closed
+	std::vector<TextureRecord> textures(textures_, textures_ + textureCount_);
+	std::vector<SystemRecord> systems(systems_, systems_ + systemCount_);
+	float loopPause = loopPause_;
+
+	clear();
+	textureStore_.swap(textures);
+	systemStore_.swap(systems);
+	rocketStore_.swap(replacement);
+	loopPause_ = loopPause;
+
+	textureCount_ = static_cast<int>(textureStore_.size());
+	systemCount_ = static_cast<int>(systemStore_.size());
+	rocketCount_ = static_cast<int>(rocketStore_.size());
+	textures_ = textureCount_ ? &textureStore_[0] : NULL;
+	systems_ = systemCount_ ? &systemStore_[0] : NULL;
+	rockets_ = rocketCount_ ? &rocketStore_[0] : NULL;
+
+	error_[0] = 0;
+	HRESULT valid = validate();
+	if (FAILED(valid)) clear();
+	return valid;
+}
+
+HRESULT ShowDescription::validate(void)
+{
+	for (int i = 0; i < systemCount_; ++i)
+	{
+		const SystemRecord& system = systems_[i];
+		if (system.type_ < 0 || system.type_ >= SYSTEM_TYPES || system.texture_ < -1 || system.texture_ >= textureCount_ ||
+			system.maxParticles_ < 1 || system.startParticles_ < 0)
+		{
+			return fail("system %d is invalid", i);
+		}
+	}
+
+	for (int i = 0; i < rocketCount_; ++i)
+	{
+		const RocketRecord& rocket = rockets_[i];
+		if (rocket.projectile_ < 0 || rocket.projectile_ >= systemCount_ || systems_[rocket.projectile_].type_ != ProjectileSystem ||
+			rocket.trace_ < 0 || rocket.trace_ >= systemCount_ || systems_[rocket.trace_].type_ != TraceSystem ||
+			rocket.effect_ < 0 || rocket.effect_ >= systemCount_ ||
+			systems_[rocket.effect_].type_ == ProjectileSystem || systems_[rocket.effect_].type_ == TraceSystem)
+		{
+			return fail("rocket %d is invalid", i);
+		}
+	}
+
+	for (int i = 0; i < textureCount_; ++i)
+	{
+		if (memchr(textures_[i].file_, 0, SHOW_FILE_NAME_LENGTH) == NULL) return fail("texture %d is invalid", i);
+	}
+
+	return S_OK;
+}
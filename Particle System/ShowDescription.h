@@ -0,0 +1,137 @@
+/*
+Describes a fireworks show: the textures, the parameters of every particle system and the rockets with their launch
+times. A show is written as a text file (see Fireworks.show) and can be compiled into a binary file that holds the same
+records as they are laid out in memory. The binary file is mapped into memory and used as it is, without any parsing.
+*/
+
+#ifndef SHOW_DESCRIPTION_H
+#define SHOW_DESCRIPTION_H
+
+#include "Direct3DTypes.h"
+#include <vector>
+
+// the kinds of particle systems a show can be made of
+enum SystemType
+{
+	ProjectileSystem,
+	TraceSystem,
+	SphereSystem,
+	StarSystem,
+	ConeSystem,
+	MultiSphereSystem,
+	RaysSystem,
+	SYSTEM_TYPES
+};
+
+const int SHOW_FILE_NAME_LENGTH = 64;
+
+struct TextureRecord
+{
+	char file_[SHOW_FILE_NAME_LENGTH];
+};
+
+// the parameters of a particle system (every rocket using it gets a system of its own), times are in seconds
+struct SystemRecord
+{
+	int type_;							// SystemType
+	int texture_;						// index of the texture, -1 for none
+	int maxParticles_;
+	int startParticles_;
+	float maxLifetime_;
+	float startInterval_;
+	float timeIncrement_;
+	float maxParticleSize_;
+	float baseColour_[4];
+	float fadeOutTime_;
+	float maxColourDivergence_[3];
+	float maxLifetimeDivergence_;
+	float maxSizeDivergence_;
+	float maxVelocityDivergence_;
+	float launchVelocity_;
+	float launchAngle_;					// projectiles and cones (in degrees)
+	int numberOfRays_;					// stars
+
+	// sub particles of multi spheres and rays
+	int subExplosionSize_;
+	float subParticleMaxSize_;
+	float subParticleLaunchVelocity_;
+	float subParticleBaseColour_[4];
+	float subParticleFadeOutTime_;
+	float subParticleMaxColourDivergence_[3];
+	float subParticleMaxLifetimeDivergence_;
+	float subParticleMaxSizeDivergence_;
+	float subParticleMaxVelocityDivergence_;
+	float subParticleMaxLifetime_;
+};
+
+struct RocketRecord
+{
+	float launchTime_;					// in milliseconds from the start of the show
+	float position_[3];					// the start position
+	int projectile_;					// indices of the systems
+	int trace_;
+	int effect_;
+};
+
+class ShowDescription
+{
+public:
+	ShowDescription(void);
+	~ShowDescription(void);
+
+	HRESULT loadText(const char* file);
+
+	// writes the show in its binary form
+	HRESULT saveBinary(const char* file);
+	// maps a binary show into memory, if 'source' is given the binary is only used if it was compiled from the current
+	// version of that text file
+	HRESULT loadBinary(const char* file, const char* source = NULL);
+
+	void clear(void);
+
+	// replaces the rockets of the show (keeping the textures and systems), e.g. to derive variations of a show
+	HRESULT setRockets(const RocketRecord* rockets, int count);
+
+	int textureCount(void) const {return textureCount_;}
+	int systemCount(void) const {return systemCount_;}
+	int rocketCount(void) const {return rocketCount_;}
+	const TextureRecord& texture(int i) const {return textures_[i];}
+	const SystemRecord& system(int i) const {return systems_[i];}
+	const RocketRecord& rocket(int i) const {return rockets_[i];}
+	float loopPause(void) const {return loopPause_;}	// in milliseconds, after the last launch until the show starts over
+
+	const char* error(void) const {return error_;}		// describes why loading failed
+
+private:
+	HRESULT fail(const char* format, ...);
+	HRESULT validate(void);			// checks that all indices are in range
+
+	// the records, either owned (loaded from text) or pointing into the mapped file
+	const TextureRecord* textures_;
+	const SystemRecord* systems_;
+	const RocketRecord* rockets_;
+	int textureCount_;
+	int systemCount_;
+	int rocketCount_;
+	float loopPause_;
+
+	std::vector<TextureRecord> textureStore_;
+	std::vector<SystemRecord> systemStore_;
+	std::vector<RocketRecord> rocketStore_;
+
+	unsigned long long sourceSize_;		// identifies the version of the text file the show was loaded from
+	unsigned long long sourceTime_;
+
+	void* mapping_;						// the view of the mapped binary file (NULL if loaded from text)
+	size_t mappingSize_;
+#ifdef _WIN32
+	HANDLE mappingHandle_;
+#endif
+
+	char error_[256];
+
+	ShowDescription(const ShowDescription&);
+	ShowDescription& operator=(const ShowDescription&);
+};
+
+#endif
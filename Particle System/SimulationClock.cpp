@@ -0,0 +1,49 @@
+#include "SimulationClock.h"
+
+
+SimulationClock::SimulationClock(int maxSteps) : maxSteps_(maxSteps)
+{
+	reset();
+}
+
+void SimulationClock::reset(void)
+{
+	accumulator_ = 0;
+	steps_ = 0;
+}
+
+int SimulationClock::advance(float elapsedSeconds)
+{
+	if (elapsedSeconds > 0) accumulator_ += elapsedSeconds;
+
+	int steps = 0;
+	while (accumulator_ >= SIMULATION_STEP && steps < maxSteps_)
+	{
+		accumulator_ -= SIMULATION_STEP;
+		++steps;
+	}
+
+	// drop the time that could not be simulated
+	if (accumulator_ >= SIMULATION_STEP) accumulator_ = 0;
+
+	steps_ += steps;
+	return steps;
+}
+
+void SimulationClock::saveState(Snapshot& snapshot) const
+{
+	snapshot.write(accumulator_);
+	snapshot.write(steps_);
+}
+
+void SimulationClock::restoreState(Snapshot& snapshot)
+{
+	snapshot.read(&accumulator_);
+	snapshot.read(&steps_);
+
+	if (!(accumulator_ >= 0 && accumulator_ < SIMULATION_STEP) || steps_ < 0)
+	{
+		snapshot.invalidate();
+		reset();
+	}
+}
@@ -0,0 +1,44 @@
+/*
+Decouples the simulation from the frame rate. The simulation always advances in steps of the same length, the clock
+collects the real time that has passed and tells how many steps are due for a frame. What is left over (less than a
+step) is used to interpolate the rendered positions between the last two steps.
+*/
+
+#ifndef SIMULATION_CLOCK_H
+#define SIMULATION_CLOCK_H
+
+#include "Snapshot.h"
+
+// the length of a single simulation step in seconds
+const int SIMULATION_STEPS_PER_SECOND = 60;
+const float SIMULATION_STEP = 1.0f / SIMULATION_STEPS_PER_SECOND;
+
+// converts a duration into the number of simulation steps it lasts
+inline int secondsToSteps(float seconds)
+{
+	return static_cast<int>(seconds / SIMULATION_STEP + 0.5f);
+}
+
+class SimulationClock
+{
+public:
+	// at most 'maxSteps' are run per frame, if the machine can't keep up the simulation slows down instead of stalling
+	SimulationClock(int maxSteps = 8);
+
+	void reset(void);
+
+	int advance(float elapsedSeconds);	// adds the real time passed since the last frame, returns the number of steps to run
+	float alpha(void) const {return accumulator_ / SIMULATION_STEP;}	// how far the frame is between the last two steps (0 to 1)
+	double time(void) const {return static_cast<double>(steps_) * SIMULATION_STEP;}	// the simulated time in seconds
+	long long steps(void) const {return steps_;}
+
+	void saveState(Snapshot& snapshot) const;
+	void restoreState(Snapshot& snapshot);
+
+private:
+	int maxSteps_;
+	float accumulator_;		// the time passed that has not been simulated yet
+	long long steps_;		// the number of steps simulated so far
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "Snapshot.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+
+static const char SNAPSHOT_FILE_MAGIC[4] = {'F', 'W', 'S', 'S'};
+static const unsigned int SNAPSHOT_FILE_VERSION = 4;
+
+// the state follows the header
+struct SnapshotFileHeader
+{
+	char magic_[4];
+	unsigned int version_;
+	unsigned long long size_;		// of the state in bytes
+};
+
+Snapshot::Snapshot(void) : position_(0), valid_(true)
+{
+	error_[0] = 0;
+}
+
+void Snapshot::clear(void)
+{
+	// the memory is kept, so taking snapshots over and over again does not allocate
+	data_.clear();
+	position_ = 0;
+	valid_ = true;
+}
+
+void Snapshot::rewind(void)
+{
+	position_ = 0;
+	valid_ = true;
+}
+
+void Snapshot::write(const void* data, size_t size)
+{
+	if (size == 0) return;
+
+	size_t end = data_.size();
+	data_.resize(end + size);
+	memcpy(&data_[end], data, size);
+}
+
+void Snapshot::read(void* data, size_t size)
+{
+	if (size == 0) return;
+
+	if (!valid_ || size > data_.size() - position_)
+	{
+		memset(data, 0, size);
+		valid_ = false;
+		return;
+	}
+
+	memcpy(data, &data_[position_], size);
+	position_ += size;
+}
+
+HRESULT Snapshot::fail(const char* format, ...)
+{
+	va_list arguments;
+	va_start(arguments, format);
+	vsnprintf(error_, sizeof(error_), format, arguments);
+	va_end(arguments);
+
+	return E_FAIL;
+}
+
+HRESULT Snapshot::save(const char* file)
+{
+	SnapshotFileHeader header;
+	ZeroMemory(&header, sizeof(header));
+
+	memcpy(header.magic_, SNAPSHOT_FILE_MAGIC, sizeof(header.magic_));
+	header.version_ = SNAPSHOT_FILE_VERSION;
+	header.size_ = data_.size();
+
+	FILE* output = fopen(file, "wb");
+	if (!output) return fail("%s: cannot be written", file);
+
+	bool written = fwrite(&header, sizeof(header), 1, output) == 1;
+	if (!data_.empty()) written = written && fwrite(&data_[0], data_.size(), 1, output) == 1;
+
+	if (fclose(output) != 0) written = false;
+	return written ? S_OK : fail("%s: cannot be written", file);
+}
+
+HRESULT Snapshot::load(const char* file)
+{
+	clear();
+	error_[0] = 0;
+
+	FILE* input = fopen(file, "rb");
+	if (!input) return fail("%s: cannot be opened", file);
+
+	SnapshotFileHeader header;
+	if (fread(&header, sizeof(header), 1, input) != 1 || memcmp(header.magic_, SNAPSHOT_FILE_MAGIC, sizeof(header.magic_)) != 0 ||
+		header.version_ != SNAPSHOT_FILE_VERSION)
+	{
+		fclose(input);
+		return fail("%s: not a snapshot written by this version", file);
+	}
+
+	// the size is checked against the file before any memory is taken for it
+	long start = ftell(input);
+	fseek(input, 0, SEEK_END);
+	long end = ftell(input);
+	fseek(input, start, SEEK_SET);
+	if (start < 0 || end < start || header.size_ != static_cast<unsigned long long>(end - start))
+	{
+		fclose(input);
+		return fail("%s: the file is damaged", file);
+	}
+
+	data_.resize(static_cast<size_t>(header.size_));
+	bool read = data_.empty() || fread(&data_[0], data_.size(), 1, input) == 1;
+	fclose(input);
+
+	if (!read)
+	{
+		clear();
+		return fail("%s: cannot be read", file);
+	}
+
+	return S_OK;
+}
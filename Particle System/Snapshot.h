@@ -0,0 +1,53 @@
+/*
+The complete state of a running simulation in binary form, to continue it later from exactly the same point (to seek
+within a show). The parts of the simulation write their state one after the other and read it back in the same order,
+values are stored as they are laid out in memory. A snapshot can only be restored into the show it was taken from and
+snapshot files written by another version are refused.
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "Direct3DTypes.h"
+#include <vector>
+
+class Snapshot
+{
+public:
+	Snapshot(void);
+
+	void clear(void);		// empties the snapshot to take a new one
+	void rewind(void);		// starts reading from the beginning
+
+	void write(const void* data, size_t size);
+	template <class T> void write(const T& value) {write(&value, sizeof(T));}
+
+	// reading beyond the end gives zeros and marks the snapshot as broken
+	void read(void* data, size_t size);
+	template <class T> void read(T* value) {read(value, sizeof(T));}
+
+	// called by the parts of the simulation if the state read does not fit them (e.g. from another show)
+	void invalidate(void) {valid_ = false;}
+	bool valid(void) const {return valid_;}
+
+	HRESULT save(const char* file);
+	HRESULT load(const char* file);
+
+	size_t size(void) const {return data_.size();}
+	const void* data(void) const {return data_.empty() ? NULL : &data_[0];}		// the state written so far
+	const char* error(void) const {return error_;}		// describes why saving or loading failed
+
+private:
+	HRESULT fail(const char* format, ...);
+
+	std::vector<char> data_;
+	size_t position_;				// where the next value is read from
+	bool valid_;
+
+	char error_[256];
+
+	Snapshot(const Snapshot&);
+	Snapshot& operator=(const Snapshot&);
+};
+
+#endif
@@ -0,0 +1,347 @@
+#include "SoftwareRenderBackend.h"
+#include <emmintrin.h>	// SSE2
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+
+// number of points projected and sorted into the tiles by a single job
+static const int SPRITE_CHUNK_SIZE = 4096;
+
+
+SoftwareRenderBackend::SoftwareRenderBackend(int width, int height, JobSystem* jobSystem) : width_(width), height_(height),
+	tilesX_((width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE), tilesY_((height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE),
+	jobSystem_(jobSystem), shading_(ColouredPoints), texture_(NULL)
+{
+	image_.create(width, height, 0xff000000);
+
+	white_.width_ = white_.height_ = 1;
+	white_.alpha_.assign(1, 1.0f);
+	white_.red_.assign(1, 1.0f);
+	white_.green_.assign(1, 1.0f);
+	white_.blue_.assign(1, 1.0f);
+	texture_ = &white_;
+
+	// the view of the application
+	setCamera(D3DXVECTOR3(0.0f, 0.0f, -700.0f), D3DXVECTOR3(0.0f, 0.0f, 0.0f), D3DXVECTOR3(0.0f, 1.0f, 0.0f), D3DX_PI / 4, 1.0f, 800.0f);
+}
+
+SoftwareRenderBackend::~SoftwareRenderBackend(void)
+{
+}
+
+RenderTexture SoftwareRenderBackend::loadTexture(const char* file)
+{
+	Image image;
+	if (FAILED(image.load(file)) || image.width() == 0 || image.height() == 0) return NULL;
+
+	Texture* texture = new Texture();
+	texture->width_ = image.width();
+	texture->height_ = image.height();
+
+	size_t texels = static_cast<size_t>(image.width()) * image.height();
+	texture->alpha_.resize(texels);
+	texture->red_.resize(texels);
+	texture->green_.resize(texels);
+	texture->blue_.resize(texels);
+	for (size_t i = 0; i < texels; ++i)
+	{
+		DWORD texel = image.pixels()[i];
+		texture->alpha_[i] = (texel >> 24) / 255.0f;
+		texture->red_[i] = ((texel >> 16) & 0xff) / 255.0f;
+		texture->green_[i] = ((texel >> 8) & 0xff) / 255.0f;
+		texture->blue_[i] = (texel & 0xff) / 255.0f;
+	}
+
+	return texture;
+}
+
+void SoftwareRenderBackend::releaseTexture(RenderTexture texture)
+{
+	delete static_cast<Texture*>(texture);
+}
+
+HRESULT SoftwareRenderBackend::createVertexStream(int capacity)
+{
+	vertices_.assign(capacity, POINTVERTEX());
+	return S_OK;
+}
+
+void SoftwareRenderBackend::releaseVertexStream(void)
+{
+	vertices_.clear();
+	batches_.clear();
+}
+
+POINTVERTEX* SoftwareRenderBackend::lockVertices(int first, int count, bool discard)
+{
+	if (first < 0 || first + count > static_cast<int>(vertices_.size())) return NULL;
+	return &vertices_[0] + first;
+}
+
+void SoftwareRenderBackend::unlockVertices(int written)
+{
+}
+
+void SoftwareRenderBackend::bindPoints(PointShading shading, RenderTexture texture, float size)
+{
+	shading_ = shading;
+	texture_ = texture ? static_cast<const Texture*>(texture) : &white_;
+}
+
+void SoftwareRenderBackend::unbindPoints(void)
+{
+}
+
+void SoftwareRenderBackend::drawPoints(int first, int count)
+{
+	Batch batch = {shading_, texture_, first, count, 0};
+	batches_.push_back(batch);
+}
+
+void SoftwareRenderBackend::setCamera(const D3DXVECTOR3& eye, const D3DXVECTOR3& lookAt, const D3DXVECTOR3& up, float fieldOfView, float nearPlane, float farPlane)
+{
+	// the axes of the view space (left handed, like D3DXMatrixLookAtLH)
+	eye_ = eye;
+	D3DXVECTOR3 forward = lookAt - eye;
+	D3DXVec3Normalize(&forward_, &forward);
+	D3DXVECTOR3 right;
+	D3DXVec3Cross(&right, &up, &forward_);
+	D3DXVec3Normalize(&right_, &right);
+	D3DXVec3Cross(&up_, &forward_, &right_);
+
+	// the projection (like D3DXMatrixPerspectiveFovLH)
+	yScale_ = 1.0f / tanf(fieldOfView / 2);
+	xScale_ = yScale_ * height_ / width_;
+	near_ = nearPlane;
+	far_ = farPlane;
+}
+
+void SoftwareRenderBackend::rasterise(void)
+{
+	int points = 0;
+	for (size_t i = 0; i < batches_.size(); ++i)
+	{
+		batches_[i].sprite_ = points;
+		points += batches_[i].count_;
+	}
+
+	int chunks = (points + SPRITE_CHUNK_SIZE - 1) / SPRITE_CHUNK_SIZE;
+	int tiles = tilesX_ * tilesY_;
+	sprites_.resize(points);
+	if (static_cast<int>(bins_.size()) < chunks * tiles) bins_.resize(chunks * tiles);
+
+	// project the points and sort them into the tiles, then draw the tiles (every tile reads the bins of all chunks)
+	if (jobSystem_)
+	{
+		JobSystem::Counter sprites(0);
+		for (int c = 0; c < chunks; ++c)
+		{
+			jobSystem_ -> submit([this, c] {setupSprites(c);}, &sprites);
+		}
+		jobSystem_ -> wait(&sprites);
+
+		JobSystem::Counter tilesDrawn(0);
+		for (int t = 0; t < tiles; ++t)
+		{
+			jobSystem_ -> submit([this, t] {drawTile(t);}, &tilesDrawn);
+		}
+		jobSystem_ -> wait(&tilesDrawn);
+	}
+	else
+	{
+		for (int c = 0; c < chunks; ++c) setupSprites(c);
+		for (int t = 0; t < tiles; ++t) drawTile(t);
+	}
+
+	batches_.clear();
+}
+
+void SoftwareRenderBackend::setupSprites(int chunk)
+{
+	int tiles = tilesX_ * tilesY_;
+	for (int t = 0; t < tiles; ++t)
+	{
+		bins_[chunk * tiles + t].clear();
+	}
+
+	int first = chunk * SPRITE_CHUNK_SIZE;
+	int end = std::min(first + SPRITE_CHUNK_SIZE, static_cast<int>(sprites_.size()));
+
+	// the batch holding the first sprite of the chunk
+	int b = 0;
+	while (b + 1 < static_cast<int>(batches_.size()) && batches_[b + 1].sprite_ <= first) ++b;
+
+	for (int i = first; i < end; ++i)
+	{
+		while (i >= batches_[b].sprite_ + batches_[b].count_) ++b;
+		const Batch& batch = batches_[b];
+		const POINTVERTEX& vertex = vertices_[batch.first_ + (i - batch.sprite_)];
+
+		Sprite& sprite = sprites_[i];
+		sprite.batch_ = b;
+		sprite.x0_ = sprite.x1_ = sprite.y0_ = sprite.y1_ = 0;
+
+		// into view space, points in front of the near or behind the far plane are not drawn
+		D3DXVECTOR3 offset = vertex.position_ - eye_;
+		float x = D3DXVec3Dot(&offset, &right_);
+		float y = D3DXVec3Dot(&offset, &up_);
+		float z = D3DXVec3Dot(&offset, &forward_);
+		if (z < near_ || z > far_) continue;
+
+		// the size shrinks with the distance to the eye (the point scale of the Direct 3D backend)
+		float size = height_ * vertex.size_ / sqrtf(x * x + y * y + z * z);
+		if (size > SOFTWARE_MAX_POINT_SIZE) size = SOFTWARE_MAX_POINT_SIZE;
+		if (!(size > 0)) continue;
+
+		float centreX = (x * xScale_ / z + 1.0f) * 0.5f * width_;
+		float centreY = (1.0f - y * yScale_ / z) * 0.5f * height_;
+		sprite.left_ = centreX - 0.5f * size;
+		sprite.top_ = centreY - 0.5f * size;
+		sprite.uScale_ = batch.texture_->width_ / size;
+		sprite.vScale_ = batch.texture_->height_ / size;
+
+		// a pixel is covered if its centre lies within the square
+		float x0 = ceilf(sprite.left_ - 0.5f), x1 = ceilf(sprite.left_ + size - 0.5f);
+		float y0 = ceilf(sprite.top_ - 0.5f), y1 = ceilf(sprite.top_ + size - 0.5f);
+		if (x1 <= 0 || y1 <= 0 || x0 >= width_ || y0 >= height_) continue;
+
+		sprite.x0_ = std::max(0, static_cast<int>(x0));
+		sprite.y0_ = std::max(0, static_cast<int>(y0));
+		sprite.x1_ = std::min(width_, static_cast<int>(x1));
+		sprite.y1_ = std::min(height_, static_cast<int>(y1));
+		if (sprite.x0_ >= sprite.x1_ || sprite.y0_ >= sprite.y1_) continue;
+
+		DWORD colour = vertex.color_;
+		sprite.colour_[0] = ((colour >> 16) & 0xff) / 255.0f;
+		sprite.colour_[1] = ((colour >> 8) & 0xff) / 255.0f;
+		sprite.colour_[2] = (colour & 0xff) / 255.0f;
+		sprite.colour_[3] = (colour >> 24) / 255.0f;
+
+		for (int ty = sprite.y0_ / SOFTWARE_TILE_SIZE; ty <= (sprite.y1_ - 1) / SOFTWARE_TILE_SIZE; ++ty)
+		{
+			for (int tx = sprite.x0_ / SOFTWARE_TILE_SIZE; tx <= (sprite.x1_ - 1) / SOFTWARE_TILE_SIZE; ++tx)
+			{
+				bins_[chunk * tiles + ty * tilesX_ + tx].push_back(i);
+			}
+		}
+	}
+}
+
+void SoftwareRenderBackend::drawTile(int tile)
+{
+	// the colour of the tile while it is drawn, one plane per channel
+	alignas(16) float red[SOFTWARE_TILE_SIZE * SOFTWARE_TILE_SIZE];
+	alignas(16) float green[SOFTWARE_TILE_SIZE * SOFTWARE_TILE_SIZE];
+	alignas(16) float blue[SOFTWARE_TILE_SIZE * SOFTWARE_TILE_SIZE];
+	memset(red, 0, sizeof(red));
+	memset(green, 0, sizeof(green));
+	memset(blue, 0, sizeof(blue));
+
+	int tileX = (tile % tilesX_) * SOFTWARE_TILE_SIZE;
+	int tileY = (tile / tilesX_) * SOFTWARE_TILE_SIZE;
+	int tileWidth = std::min(SOFTWARE_TILE_SIZE, width_ - tileX);
+	int tileHeight = std::min(SOFTWARE_TILE_SIZE, height_ - tileY);
+
+	const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	int tiles = tilesX_ * tilesY_;
+	int chunks = (static_cast<int>(sprites_.size()) + SPRITE_CHUNK_SIZE - 1) / SPRITE_CHUNK_SIZE;
+	for (int c = 0; c < chunks; ++c)
+	{
+		const std::vector<int>& bin = bins_[c * tiles + tile];
+		for (size_t s = 0; s < bin.size(); ++s)
+		{
+			const Sprite& sprite = sprites_[bin[s]];
+			const Batch& batch = batches_[sprite.batch_];
+			const Texture& texture = *batch.texture_;
+			bool textured = batch.shading_ == TexturedPoints;
+
+			// the part of the sprite within the tile (in tile coordinates)
+			int x0 = std::max(sprite.x0_, tileX) - tileX;
+			int x1 = std::min(sprite.x1_, tileX + tileWidth) - tileX;
+			int y0 = std::max(sprite.y0_, tileY) - tileY;
+			int y1 = std::min(sprite.y1_, tileY + tileHeight) - tileY;
+
+			// texture coordinates of the pixel centres, clamped to the texture
+			const __m128 uOffset = _mm_set1_ps(tileX + 0.5f - sprite.left_);
+			const __m128 uScale = _mm_set1_ps(sprite.uScale_);
+			const __m128 uMax = _mm_set1_ps(static_cast<float>(texture.width_ - 1));
+			const __m128 first = _mm_set1_ps(static_cast<float>(x0));
+			const __m128 last = _mm_set1_ps(static_cast<float>(x1));
+
+			const __m128 vertexRed = _mm_set1_ps(sprite.colour_[0]);
+			const __m128 vertexGreen = _mm_set1_ps(sprite.colour_[1]);
+			const __m128 vertexBlue = _mm_set1_ps(sprite.colour_[2]);
+			const __m128 vertexAlpha = _mm_set1_ps(sprite.colour_[3]);
+
+			for (int y = y0; y < y1; ++y)
+			{
+				int v = static_cast<int>((tileY + y + 0.5f - sprite.top_) * sprite.vScale_);
+				v = std::min(std::max(v, 0), texture.height_ - 1);
+				const float* texelAlpha = &texture.alpha_[v * texture.width_];
+				const float* texelRed = &texture.red_[v * texture.width_];
+				const float* texelGreen = &texture.green_[v * texture.width_];
+				const float* texelBlue = &texture.blue_[v * texture.width_];
+
+				float* r = red + y * SOFTWARE_TILE_SIZE;
+				float* g = green + y * SOFTWARE_TILE_SIZE;
+				float* b = blue + y * SOFTWARE_TILE_SIZE;
+
+				// 4 pixels at a time from the aligned start, pixels outside of the sprite get an alpha of 0
+				for (int x = x0 & ~3; x < x1; x += 4)
+				{
+					__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+					__m128 inside = _mm_and_ps(_mm_cmpge_ps(px, first), _mm_cmplt_ps(px, last));
+
+					__m128 u = _mm_mul_ps(_mm_add_ps(px, uOffset), uScale);
+					u = _mm_min_ps(_mm_max_ps(u, zero), uMax);
+					alignas(16) int texel[4];
+					_mm_store_si128(reinterpret_cast<__m128i*>(texel), _mm_cvttps_epi32(u));
+
+					__m128 alpha = _mm_setr_ps(texelAlpha[texel[0]], texelAlpha[texel[1]], texelAlpha[texel[2]], texelAlpha[texel[3]]);
+					__m128 sourceRed, sourceGreen, sourceBlue;
+					if (textured)
+					{
+						// colour and alpha of the texture
+						sourceRed = _mm_setr_ps(texelRed[texel[0]], texelRed[texel[1]], texelRed[texel[2]], texelRed[texel[3]]);
+						sourceGreen = _mm_setr_ps(texelGreen[texel[0]], texelGreen[texel[1]], texelGreen[texel[2]], texelGreen[texel[3]]);
+						sourceBlue = _mm_setr_ps(texelBlue[texel[0]], texelBlue[texel[1]], texelBlue[texel[2]], texelBlue[texel[3]]);
+					}
+					else
+					{
+						// colour of the vertex, alpha of the texture modulated by the alpha of the vertex
+						sourceRed = vertexRed;
+						sourceGreen = vertexGreen;
+						sourceBlue = vertexBlue;
+						alpha = _mm_mul_ps(alpha, vertexAlpha);
+					}
+					alpha = _mm_and_ps(alpha, inside);
+
+					// source * alpha + destination * (1 - alpha)
+					__m128 destination = _mm_load_ps(r + x);
+					_mm_store_ps(r + x, _mm_add_ps(destination, _mm_mul_ps(_mm_sub_ps(sourceRed, destination), alpha)));
+					destination = _mm_load_ps(g + x);
+					_mm_store_ps(g + x, _mm_add_ps(destination, _mm_mul_ps(_mm_sub_ps(sourceGreen, destination), alpha)));
+					destination = _mm_load_ps(b + x);
+					_mm_store_ps(b + x, _mm_add_ps(destination, _mm_mul_ps(_mm_sub_ps(sourceBlue, destination), alpha)));
+				}
+			}
+		}
+	}
+
+	// into the image, with 8 bits per channel
+	for (int y = 0; y < tileHeight; ++y)
+	{
+		DWORD* pixel = image_.pixels() + static_cast<size_t>(tileY + y) * width_ + tileX;
+		for (int x = 0; x < tileWidth; ++x)
+		{
+			int i = y * SOFTWARE_TILE_SIZE + x;
+			DWORD r = static_cast<DWORD>(red[i] * 255.0f + 0.5f);
+			DWORD g = static_cast<DWORD>(green[i] * 255.0f + 0.5f);
+			DWORD b = static_cast<DWORD>(blue[i] * 255.0f + 0.5f);
+			pixel[x] = 0xff000000 | (r << 16) | (g << 8) | b;
+		}
+	}
+}
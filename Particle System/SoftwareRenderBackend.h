@@ -0,0 +1,114 @@
+/*
+Draws the particle systems on the CPU, for previews and reference images on machines without a GPU. The points are
+drawn the way the Direct 3D backend draws them: as point sprites of the size given by their vertices (scaled by their
+distance to the camera), textured with point sampling and alpha blended into the image without a Z buffer.
+The draw calls of a frame are collected and drawn by rasterise(). The points are projected and sorted into square
+tiles of the image, then the tiles are drawn in parallel (4 pixels at a time with SSE2). Every tile draws its points in
+the order they were submitted, so the image does not depend on the number of threads.
+*/
+
+#ifndef SOFTWARE_RENDER_BACKEND_H
+#define SOFTWARE_RENDER_BACKEND_H
+
+#include "RenderBackend.h"
+#include "JobSystem.h"
+#include "Image.h"
+#include <vector>
+
+// the width and height of the tiles in pixels (a multiple of the SIMD width)
+const int SOFTWARE_TILE_SIZE = 64;
+
+// points are never drawn larger than this (in pixels), like the maximum point size of a graphics card
+const float SOFTWARE_MAX_POINT_SIZE = 256.0f;
+
+class SoftwareRenderBackend : public RenderBackend
+{
+public:
+	SoftwareRenderBackend(int width, int height, JobSystem* jobSystem = NULL);	// without a job system the tiles are drawn one by one
+	virtual ~SoftwareRenderBackend(void);
+
+	virtual RenderTexture loadTexture(const char* file);
+	virtual void releaseTexture(RenderTexture texture);
+
+	virtual HRESULT createVertexStream(int capacity);
+	virtual void releaseVertexStream(void);
+	virtual POINTVERTEX* lockVertices(int first, int count, bool discard);
+	virtual void unlockVertices(int written);
+
+	virtual void bindPoints(PointShading shading, RenderTexture texture, float size);
+	virtual void unbindPoints(void);
+	virtual void drawPoints(int first, int count);
+
+	// the camera looks from 'eye' at 'lookAt' with a perspective projection (the camera of the application by default)
+	void setCamera(const D3DXVECTOR3& eye, const D3DXVECTOR3& lookAt, const D3DXVECTOR3& up, float fieldOfView, float nearPlane, float farPlane);
+
+	void rasterise(void);		// clears the image and draws all points drawn since the last call into it
+	const Image& image(void) const {return image_;}
+
+private:
+	// the texels as one plane per channel, from 0 to 1
+	struct Texture
+	{
+		int width_;
+		int height_;
+		std::vector<float> alpha_;
+		std::vector<float> red_;
+		std::vector<float> green_;
+		std::vector<float> blue_;
+	};
+
+	struct Batch
+	{
+		PointShading shading_;
+		const Texture* texture_;
+		int first_;					// the points in the vertex stream
+		int count_;
+		int sprite_;				// the first sprite made of the points
+	};
+
+	// a point projected to the image
+	struct Sprite
+	{
+		float left_;				// the square covered by the point (in pixels)
+		float top_;
+		float uScale_;				// texels per pixel
+		float vScale_;
+		int x0_, y0_, x1_, y1_;		// the pixels covered (x1 and y1 excluded), empty if the point is not visible
+		float colour_[4];			// red, green, blue and alpha of the vertex
+		int batch_;
+	};
+
+	void setupSprites(int chunk);	// projects the points of a chunk and sorts them into the tiles
+	void drawTile(int tile);
+
+	int width_;
+	int height_;
+	int tilesX_;
+	int tilesY_;
+	JobSystem* jobSystem_;
+	Image image_;
+
+	std::vector<POINTVERTEX> vertices_;		// the vertex stream
+	Texture white_;							// used for points drawn without a texture
+
+	PointShading shading_;					// the current binding
+	const Texture* texture_;
+	std::vector<Batch> batches_;			// the draw calls of the current frame
+
+	std::vector<Sprite> sprites_;
+	std::vector<std::vector<int> > bins_;	// the sprites of every chunk overlapping every tile (in submission order)
+
+	D3DXVECTOR3 eye_;						// the camera
+	D3DXVECTOR3 right_;
+	D3DXVECTOR3 up_;
+	D3DXVECTOR3 forward_;
+	float xScale_;
+	float yScale_;
+	float near_;
+	float far_;
+
+	SoftwareRenderBackend(const SoftwareRenderBackend&);
+	SoftwareRenderBackend& operator=(const SoftwareRenderBackend&);
+};
+
+#endif
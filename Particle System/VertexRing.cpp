@@ -0,0 +1,88 @@
+#include "VertexRing.h"
+
+
+VertexRing::VertexRing(void) : backend_(NULL), capacity_(0), frameBudget_(0), tail_(0), frameStart_(0), discard_(true), vertices_(NULL), frame_(0)
+{
+}
+
+
+VertexRing::~VertexRing(void)
+{
+	release();
+}
+
+HRESULT VertexRing::initialise(RenderBackend* backend, int frameBudget)
+{
+	release();
+
+	// room for two frames, so most frames can be appended without discarding the stream
+	backend_ = backend;
+	frameBudget_ = frameBudget;
+	capacity_ = 2 * frameBudget;
+	if (capacity_ == 0) return S_OK;
+
+	if (FAILED(backend_ -> createVertexStream(capacity_)))
+	{
+		capacity_ = 0;
+		return E_FAIL; // Return if the vertex stream could not be created.
+	}
+
+	return S_OK;
+}
+
+void VertexRing::release(void)
+{
+	if (vertices_) backend_ -> unlockVertices(tail_ - frameStart_);
+	vertices_ = NULL;
+
+	if (backend_ && capacity_ > 0) backend_ -> releaseVertexStream();
+	capacity_ = 0;
+	tail_ = frameStart_ = 0;
+	discard_ = true;
+}
+
+void VertexRing::beginFrame(void)
+{
+	++frame_;
+
+	// start over (and let the driver hand out fresh memory) if the worst case frame does not fit behind the last one,
+	// the discard stays pending until the stream actually gets locked
+	if (tail_ + frameBudget_ > capacity_)
+	{
+		tail_ = 0;
+		discard_ = true;
+	}
+
+	frameStart_ = tail_;
+}
+
+void VertexRing::endFrame(void)
+{
+	if (vertices_)
+	{
+		backend_ -> unlockVertices(tail_ - frameStart_);
+		vertices_ = NULL;
+
+		// the following frames are appended behind this one
+		discard_ = false;
+	}
+}
+
+POINTVERTEX* VertexRing::append(int count, int* offset)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if (capacity_ == 0 || tail_ + count > frameStart_ + frameBudget_) return NULL;
+
+	// lock on the first append only, frames without any particles don't touch the stream at all
+	if (vertices_ == NULL)
+	{
+		vertices_ = backend_ -> lockVertices(frameStart_, frameBudget_, discard_);
+		if (vertices_ == NULL) return NULL;
+	}
+
+	*offset = tail_;
+	tail_ += count;
+
+	return vertices_ + (*offset - frameStart_);
+}
@@ -0,0 +1,51 @@
+/*
+A single dynamic vertex stream shared by all particle systems of the scene (created by the render backend).
+The systems append their vertices every frame and get back the range (offset and count) they have to draw. The stream
+is locked at most once per frame: without overwriting while the next frame still fits behind the data of the previous
+one, and discarding it (starting over at the beginning) when it does not. So the ranges handed out never overlap with
+anything the GPU may still be reading.
+*/
+
+#ifndef VERTEX_RING_H
+#define VERTEX_RING_H
+
+#include "RenderBackend.h"
+#include <mutex>
+
+class VertexRing
+{
+public:
+	VertexRing(void);
+	~VertexRing(void);
+
+	// creates the stream, 'frameBudget' is the maximum number of vertices appended during a single frame
+	HRESULT initialise(RenderBackend* backend, int frameBudget);
+	void release(void);
+
+	void beginFrame(void);		// to be called before the particle systems are updated
+	void endFrame(void);		// to be called after the particle systems have been updated (and before rendering)
+
+	// reserves room for 'count' vertices in the current frame, returns NULL if there is no room (or no stream)
+	// (may be called by several threads at once)
+	POINTVERTEX* append(int count, int* offset);
+
+	int frameVertices(void) const {return tail_ - frameStart_;}		// the number of vertices appended in the current frame
+	unsigned int frame(void) const {return frame_;}		// ranges are only valid during the frame they were appended in
+
+private:
+	RenderBackend* backend_;
+	int capacity_;				// size of the stream in vertices
+	int frameBudget_;
+	int tail_;					// the next free vertex
+	int frameStart_;			// the vertex the current frame started at
+	bool discard_;				// whether the stream is discarded when it is locked in the current frame
+	POINTVERTEX* vertices_;		// the locked memory (starting at 'frameStart_'), NULL while the stream is not locked
+	unsigned int frame_;
+	std::mutex mutex_;			// guards the tail and the lock of the stream
+
+	// the stream is owned by the ring, so it must not be copied
+	VertexRing(const VertexRing&);
+	VertexRing& operator=(const VertexRing&);
+};
+
+#endif